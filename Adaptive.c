@@ -0,0 +1,237 @@
+// Implementation of the Adaptive module (FGK algorithm)
+// Nodes live in arrays indexed by their node number. Numbers increase with
+// weight (the sibling property), the root has the highest number and new
+// nodes are spawned from the not-yet-transmitted (NYT) node downwards.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "Adaptive.h"
+#include "Alloc.h"
+#include "BitIO.h"
+
+#define MAX_NODES (2 * ADAPTIVE_NUM_SYMBOLS + 1) // every symbol plus the NYT node
+#define ROOT (MAX_NODES - 1)
+#define SYMBOL_BITS 9
+#define CHUNK_SIZE 65536
+
+static const char MAGIC[4] = {'H', 'U', 'F', 'A'};
+
+// Structs definition
+struct adaptiveTree {
+    int64_t weight[MAX_NODES];
+    int parent[MAX_NODES];
+    int left[MAX_NODES];    // -1 for leaves and the NYT node
+    int right[MAX_NODES];
+    int symbol[MAX_NODES];  // -1 for internal nodes and the NYT node
+    int leafOf[ADAPTIVE_NUM_SYMBOLS]; // -1 until the symbol is first seen
+    int nyt;
+};
+
+// Helper functions
+static void update(AdaptiveTree t, int symbol);
+static void swapNodes(AdaptiveTree t, int i, int j);
+static void writePath(AdaptiveTree t, BitWriter bw, int node);
+
+// Returns a new tree containing only the NYT node
+AdaptiveTree AdaptiveTreeNew(void) {
+    AdaptiveTree t = AllocMalloc(ALLOC_TREE, sizeof(struct adaptiveTree));
+
+    for (int i = 0; i < ADAPTIVE_NUM_SYMBOLS; i++) {
+        t->leafOf[i] = -1;
+    }
+    t->nyt = ROOT;
+    t->weight[ROOT] = 0;
+    t->parent[ROOT] = -1;
+    t->left[ROOT] = t->right[ROOT] = -1;
+    t->symbol[ROOT] = -1;
+    return t;
+}
+
+// Frees the tree
+void AdaptiveTreeFree(AdaptiveTree t) {
+    AllocFree(ALLOC_TREE, t);
+}
+
+// Writes the code of the symbol, followed by the raw symbol if it is new
+void AdaptiveEncodeSymbol(AdaptiveTree t, BitWriter bw, int symbol) {
+    if (t->leafOf[symbol] == -1) {
+        writePath(t, bw, t->nyt);
+        BitWriterWrite(bw, symbol, SYMBOL_BITS);
+    } else {
+        writePath(t, bw, t->leafOf[symbol]);
+    }
+    update(t, symbol);
+}
+
+// Walks down from the root to a leaf or the NYT node
+int AdaptiveDecodeSymbol(AdaptiveTree t, BitReader br) {
+    int node = ROOT;
+    while (t->left[node] != -1) {
+        int bit = BitReaderReadBit(br);
+        if (bit < 0) {
+            return -1;
+        }
+        node = bit ? t->right[node] : t->left[node];
+    }
+
+    int symbol = t->symbol[node];
+    if (node == t->nyt) {
+        uint32_t bits;
+        if (!BitReaderRead(br, SYMBOL_BITS, &bits) || bits >= ADAPTIVE_NUM_SYMBOLS) {
+            return -1;
+        }
+        symbol = bits;
+    }
+    update(t, symbol);
+    return symbol;
+}
+
+// Encodes a whole stream, terminated by the end of stream symbol
+uint64_t AdaptiveEncodeStream(FILE *in, FILE *out) {
+    AdaptiveTree t = AdaptiveTreeNew();
+    BitWriter bw = BitWriterNew(out);
+    for (int i = 0; i < 4; i++) {
+        BitWriterWrite(bw, (unsigned char)MAGIC[i], 8);
+    }
+
+    // read() returns whatever a pipe has available instead of waiting for a
+    // full chunk, so output keeps pace with a slow producer
+    unsigned char *chunk = AllocMalloc(ALLOC_IO, CHUNK_SIZE);
+    uint64_t numBytes = 0;
+    ssize_t n;
+    while ((n = read(fileno(in), chunk, CHUNK_SIZE)) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            AdaptiveEncodeSymbol(t, bw, chunk[i]);
+        }
+        numBytes += n;
+        BitWriterSync(bw);
+    }
+    AdaptiveEncodeSymbol(t, bw, ADAPTIVE_EOF);
+
+    AllocFree(ALLOC_IO, chunk);
+    BitWriterFree(bw);
+    AdaptiveTreeFree(t);
+    return numBytes;
+}
+
+// Decodes a whole stream up to the end of stream symbol
+bool AdaptiveDecodeStream(FILE *in, FILE *out) {
+    BitReader br = BitReaderNew(in);
+    bool ok = true;
+    for (int i = 0; i < 4 && ok; i++) {
+        uint32_t byte;
+        ok = BitReaderRead(br, 8, &byte) && byte == (unsigned char)MAGIC[i];
+    }
+
+    AdaptiveTree t = AdaptiveTreeNew();
+    while (ok) {
+        int symbol = AdaptiveDecodeSymbol(t, br);
+        if (symbol == ADAPTIVE_EOF) {
+            break;
+        }
+        if (symbol < 0) {
+            ok = false;
+            break;
+        }
+        putc(symbol, out);
+    }
+    fflush(out);
+
+    AdaptiveTreeFree(t);
+    BitReaderFree(br);
+    return ok;
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Increments the weight of the symbol's leaf and its ancestors, swapping each
+// node with the highest numbered node of equal weight to keep the sibling property
+static void update(AdaptiveTree t, int symbol) {
+    int node = t->leafOf[symbol];
+
+    // First occurrence: the NYT node gives birth to a new NYT node and a leaf
+    if (node == -1) {
+        int old = t->nyt;
+        int newNyt = old - 2;
+        int leaf = old - 1;
+        t->left[old] = newNyt;
+        t->right[old] = leaf;
+
+        t->weight[newNyt] = 0;
+        t->parent[newNyt] = old;
+        t->left[newNyt] = t->right[newNyt] = -1;
+        t->symbol[newNyt] = -1;
+
+        t->weight[leaf] = 0;
+        t->parent[leaf] = old;
+        t->left[leaf] = t->right[leaf] = -1;
+        t->symbol[leaf] = symbol;
+
+        t->leafOf[symbol] = leaf;
+        t->nyt = newNyt;
+        node = leaf;
+    }
+
+    while (node != -1) {
+        // Nodes of equal weight are numbered contiguously
+        int leader = node;
+        while (leader < ROOT && t->weight[leader + 1] == t->weight[node]) {
+            leader++;
+        }
+        if (leader != node && leader != t->parent[node]) {
+            swapNodes(t, node, leader);
+            node = leader;
+        }
+        t->weight[node]++;
+        node = t->parent[node];
+    }
+}
+
+// Swaps the subtrees at two node numbers, which keep their parents
+static void swapNodes(AdaptiveTree t, int i, int j) {
+    int tmp;
+    tmp = t->symbol[i]; t->symbol[i] = t->symbol[j]; t->symbol[j] = tmp;
+    tmp = t->left[i]; t->left[i] = t->left[j]; t->left[j] = tmp;
+    tmp = t->right[i]; t->right[i] = t->right[j]; t->right[j] = tmp;
+
+    int nodes[2] = {i, j};
+    for (int k = 0; k < 2; k++) {
+        int n = nodes[k];
+        if (t->left[n] != -1) {
+            t->parent[t->left[n]] = n;
+            t->parent[t->right[n]] = n;
+        } else if (t->symbol[n] >= 0) {
+            t->leafOf[t->symbol[n]] = n;
+        } else {
+            t->nyt = n;
+        }
+    }
+}
+
+// Writes the path from the root to the node
+static void writePath(AdaptiveTree t, BitWriter bw, int node) {
+    // Collect the bits leaf to root, then write them root to leaf
+    unsigned char bits[MAX_NODES];
+    int depth = 0;
+    for (int n = node; t->parent[n] != -1; n = t->parent[n]) {
+        bits[depth++] = t->right[t->parent[n]] == n;
+    }
+
+    uint32_t group = 0;
+    int groupBits = 0;
+    while (depth > 0) {
+        group = (group << 1) | bits[--depth];
+        if (++groupBits == 32) {
+            BitWriterWrite(bw, group, 32);
+            group = 0;
+            groupBits = 0;
+        }
+    }
+    if (groupBits > 0) {
+        BitWriterWrite(bw, group, groupBits);
+    }
+}
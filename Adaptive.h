@@ -0,0 +1,55 @@
+// Interface to the Adaptive module, a one-pass (FGK) adaptive huffman coder
+// Encoder and decoder start from the same empty tree and update it after
+// every symbol, so no tree file is needed and the input is read only once
+
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "BitIO.h"
+
+// Symbols are the 256 byte values plus an end of stream marker
+#define ADAPTIVE_EOF 256
+#define ADAPTIVE_NUM_SYMBOLS 257
+
+typedef struct adaptiveTree *AdaptiveTree;
+
+/**
+ * Returns a new adaptive tree containing only the not-yet-transmitted node
+ * The tree must be freed with AdaptiveTreeFree
+ */
+AdaptiveTree AdaptiveTreeNew(void);
+
+/**
+ * Frees all memory allocated to the tree
+ */
+void AdaptiveTreeFree(AdaptiveTree t);
+
+/**
+ * Writes the code of the symbol (0-256) and updates the tree
+ */
+void AdaptiveEncodeSymbol(AdaptiveTree t, BitWriter bw, int symbol);
+
+/**
+ * Reads one symbol and updates the tree
+ * Returns the symbol (0-256), or -1 if the bitstream ended early
+ */
+int AdaptiveDecodeSymbol(AdaptiveTree t, BitReader br);
+
+/**
+ * Encodes everything read from in and writes the bitstream to out
+ * Output is pushed out after every chunk of input, so pipes stream through
+ * Returns the number of input bytes
+ */
+uint64_t AdaptiveEncodeStream(FILE *in, FILE *out);
+
+/**
+ * Decodes a bitstream written by AdaptiveEncodeStream from in to out
+ * Returns false if the stream is not an adaptive encoding or is truncated
+ */
+bool AdaptiveDecodeStream(FILE *in, FILE *out);
+
+#endif
@@ -0,0 +1,216 @@
+// Implementation of the Alloc module
+
+#include <ctype.h>
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+
+// Structs definition
+struct counts {
+    _Atomic uint64_t allocs;
+    _Atomic uint64_t frees;
+    _Atomic uint64_t liveBytes;
+    _Atomic uint64_t peakBytes;
+};
+
+static const char *subsystemNames[ALLOC_NUM_SUBSYSTEMS] = {
+    [ALLOC_COUNTER] = "counter",
+    [ALLOC_TREE] = "tree",
+    [ALLOC_CODE] = "code",
+    [ALLOC_BUFFER] = "buffer",
+    [ALLOC_IO] = "io",
+    [ALLOC_POOL] = "pool",
+};
+
+static size_t libcUsableSize(void *ptr);
+
+static const struct allocator libcAllocator = {malloc, realloc, free, libcUsableSize};
+
+static const struct allocator *allocator = &libcAllocator;
+static _Atomic uint64_t budget = 0;
+static char *program = "";
+// The totals are kept in the last slot
+static struct counts counts[ALLOC_NUM_SUBSYSTEMS + 1];
+
+// Helper functions
+static bool withinBudget(size_t size);
+static void checkBudget(AllocSubsystem sub, size_t size);
+static void *countedMalloc(AllocSubsystem sub, size_t size);
+static void addLive(AllocSubsystem sub, uint64_t added, uint64_t removed);
+static void raisePeak(_Atomic uint64_t *peak, uint64_t live);
+static void outOfMemory(AllocSubsystem sub, size_t size);
+static uint64_t parseBytes(char *s);
+static void report(void);
+
+// Reads the budget and turns on the report from the environment
+void AllocInit(char *progName) {
+    program = progName;
+    char *env = getenv("HUFFMAN_MEM_BUDGET");
+    if (env != NULL && env[0] != '\0') {
+        AllocSetBudget(parseBytes(env));
+    }
+    env = getenv("HUFFMAN_MEM_REPORT");
+    if (env != NULL && env[0] != '\0' && strcmp(env, "0") != 0) {
+        atexit(report);
+    }
+}
+
+void AllocSetAllocator(const struct allocator *a) {
+    allocator = a != NULL ? a : &libcAllocator;
+}
+
+void AllocSetBudget(uint64_t bytes) {
+    atomic_store(&budget, bytes);
+}
+
+void *AllocMalloc(AllocSubsystem sub, size_t size) {
+    checkBudget(sub, size);
+    void *ptr = countedMalloc(sub, size);
+    if (ptr == NULL) {
+        outOfMemory(sub, size);
+    }
+    return ptr;
+}
+
+void *AllocTryMalloc(AllocSubsystem sub, size_t size) {
+    return withinBudget(size) ? countedMalloc(sub, size) : NULL;
+}
+
+// Growing a block counts only the bytes added against the budget
+void *AllocRealloc(AllocSubsystem sub, void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return AllocMalloc(sub, size);
+    }
+    uint64_t oldSize = allocator->usableSize(ptr);
+    if (size > oldSize) {
+        checkBudget(sub, size - oldSize);
+    }
+    void *newPtr = allocator->realloc(ptr, size > 0 ? size : 1);
+    if (newPtr == NULL) {
+        outOfMemory(sub, size);
+    }
+    addLive(sub, allocator->usableSize(newPtr), oldSize);
+    return newPtr;
+}
+
+char *AllocStrdup(AllocSubsystem sub, const char *s) {
+    size_t size = strlen(s) + 1;
+    char *copy = AllocMalloc(sub, size);
+    memcpy(copy, s, size);
+    return copy;
+}
+
+void AllocFree(AllocSubsystem sub, void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    uint64_t size = allocator->usableSize(ptr);
+    allocator->free(ptr);
+    atomic_fetch_add(&counts[sub].frees, 1);
+    atomic_fetch_add(&counts[ALLOC_NUM_SUBSYSTEMS].frees, 1);
+    addLive(sub, 0, size);
+}
+
+void AllocGetStats(AllocSubsystem sub, struct allocStats *stats) {
+    stats->allocs = atomic_load(&counts[sub].allocs);
+    stats->frees = atomic_load(&counts[sub].frees);
+    stats->liveBytes = atomic_load(&counts[sub].liveBytes);
+    stats->peakBytes = atomic_load(&counts[sub].peakBytes);
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+static size_t libcUsableSize(void *ptr) {
+    return malloc_usable_size(ptr);
+}
+
+// Threads allocating at once may each pass the check, so the budget can be
+// overrun by what they allocate together
+static bool withinBudget(size_t size) {
+    uint64_t limit = atomic_load(&budget);
+    return limit == 0 || atomic_load(&counts[ALLOC_NUM_SUBSYSTEMS].liveBytes) + size <= limit;
+}
+
+static void checkBudget(AllocSubsystem sub, size_t size) {
+    if (!withinBudget(size)) {
+        uint64_t limit = atomic_load(&budget);
+        uint64_t live = atomic_load(&counts[ALLOC_NUM_SUBSYSTEMS].liveBytes);
+        fprintf(stderr, "error: memory budget of %llu bytes exceeded: %s needs %zu bytes "
+                "with %llu in use\n", (unsigned long long)limit, subsystemNames[sub],
+                size, (unsigned long long)live);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Allocates and counts the block, or returns NULL
+static void *countedMalloc(AllocSubsystem sub, size_t size) {
+    void *ptr = allocator->malloc(size > 0 ? size : 1);
+    if (ptr != NULL) {
+        atomic_fetch_add(&counts[sub].allocs, 1);
+        atomic_fetch_add(&counts[ALLOC_NUM_SUBSYSTEMS].allocs, 1);
+        addLive(sub, allocator->usableSize(ptr), 0);
+    }
+    return ptr;
+}
+
+// Moves the live bytes of a subsystem and the total, and their peaks
+static void addLive(AllocSubsystem sub, uint64_t added, uint64_t removed) {
+    AllocSubsystem slots[2] = {sub, ALLOC_NUM_SUBSYSTEMS};
+    for (int i = 0; i < 2; i++) {
+        struct counts *c = &counts[slots[i]];
+        uint64_t live = atomic_fetch_add(&c->liveBytes, added - removed) + added - removed;
+        if (added > removed) {
+            raisePeak(&c->peakBytes, live);
+        }
+    }
+}
+
+static void raisePeak(_Atomic uint64_t *peak, uint64_t live) {
+    uint64_t old = atomic_load(peak);
+    while (live > old && !atomic_compare_exchange_weak(peak, &old, live)) {
+    }
+}
+
+static void outOfMemory(AllocSubsystem sub, size_t size) {
+    fprintf(stderr, "error: out of memory (%s needs %zu bytes)\n", subsystemNames[sub], size);
+    exit(EXIT_FAILURE);
+}
+
+// Parses a byte count with an optional K, M or G suffix
+static uint64_t parseBytes(char *s) {
+    char *end;
+    unsigned long long n = strtoull(s, &end, 10);
+    int shift = 0;
+    switch (toupper((unsigned char)*end)) {
+        case 'K': shift = 10; end++; break;
+        case 'M': shift = 20; end++; break;
+        case 'G': shift = 30; end++; break;
+    }
+    if (end == s || *end != '\0' || n == 0) {
+        fprintf(stderr, "error: invalid HUFFMAN_MEM_BUDGET '%s'\n", s);
+        exit(EXIT_FAILURE);
+    }
+    return (uint64_t)n << shift;
+}
+
+// Writes the JSON report to stderr. Bytes still live at exit are leaks.
+static void report(void) {
+    fprintf(stderr, "{\"program\":\"%s\",\"budget_bytes\":%llu,\"memory\":{", program,
+            (unsigned long long)atomic_load(&budget));
+    for (int s = 0; s <= ALLOC_NUM_SUBSYSTEMS; s++) {
+        struct allocStats st;
+        AllocGetStats(s, &st);
+        fprintf(stderr, "%s\"%s\":{\"allocs\":%llu,\"frees\":%llu,\"peak_bytes\":%llu,"
+                "\"leaked_bytes\":%llu}", s == 0 ? "" : ",",
+                s < ALLOC_NUM_SUBSYSTEMS ? subsystemNames[s] : "total",
+                (unsigned long long)st.allocs, (unsigned long long)st.frees,
+                (unsigned long long)st.peakBytes, (unsigned long long)st.liveBytes);
+    }
+    fprintf(stderr, "}}\n");
+}
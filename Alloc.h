@@ -0,0 +1,93 @@
+// Interface to the Alloc module, which counts the heap memory used by each
+// subsystem and can hold the program to a memory budget
+//
+// Every allocation names the subsystem it belongs to. Counts are always
+// kept: allocations, frees, live bytes and the peak of live bytes, per
+// subsystem and in total. Sizes are the usable sizes reported by the
+// allocator, so they include its rounding, and nothing is added to the
+// blocks themselves: memory from AllocMalloc may still be passed to plain
+// free, which only leaves it counted as live.
+//
+// AllocInit reads two environment variables:
+//   HUFFMAN_MEM_BUDGET  a limit on total live bytes, with an optional K, M
+//                       or G suffix; an allocation that would exceed it is
+//                       an error naming the subsystem
+//   HUFFMAN_MEM_REPORT  if set (to anything but "0"), the counts are
+//                       written to stderr as one JSON object at exit, and
+//                       live bytes at that point are leaks
+//
+// All functions may be called from several threads at once.
+
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    ALLOC_COUNTER,  // Counter nodes, tokens and item arrays
+    ALLOC_TREE,     // huffman tree nodes and tokens
+    ALLOC_CODE,     // codebooks, codecs and flat trees
+    ALLOC_BUFFER,   // encoded and decoded text and bits
+    ALLOC_IO,       // file contents and pipeline chunks
+    ALLOC_POOL,     // worker pools, their task queues and batch jobs
+    ALLOC_NUM_SUBSYSTEMS,
+} AllocSubsystem;
+
+/**
+ * The allocator underneath the counts. usableSize must return the size
+ * of a block returned by malloc or realloc.
+ */
+struct allocator {
+    void *(*malloc)(size_t size);
+    void *(*realloc)(void *ptr, size_t size);
+    void (*free)(void *ptr);
+    size_t (*usableSize)(void *ptr);
+};
+
+struct allocStats {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t liveBytes;
+    uint64_t peakBytes;
+};
+
+/**
+ * Reads the budget and report settings from the environment
+ */
+void AllocInit(char *progName);
+
+/**
+ * Replaces the allocator, which is the C library's by default
+ * Must be called before anything is allocated
+ */
+void AllocSetAllocator(const struct allocator *a);
+
+/**
+ * Sets the limit on total live bytes, or removes it if budget is 0
+ */
+void AllocSetBudget(uint64_t budget);
+
+/**
+ * Allocate, resize, duplicate and free memory counted against a subsystem
+ * Running out of memory or over the budget is an error that exits
+ * ptr must have been allocated for the same subsystem
+ */
+void *AllocMalloc(AllocSubsystem sub, size_t size);
+void *AllocRealloc(AllocSubsystem sub, void *ptr, size_t size);
+char *AllocStrdup(AllocSubsystem sub, const char *s);
+void AllocFree(AllocSubsystem sub, void *ptr);
+
+/**
+ * Like AllocMalloc, but returns NULL instead of exiting when out of memory
+ * or over the budget, for callers that can fail one request and carry on
+ */
+void *AllocTryMalloc(AllocSubsystem sub, size_t size);
+
+/**
+ * Gets the counts of a subsystem, or the totals if sub is
+ * ALLOC_NUM_SUBSYSTEMS
+ */
+void AllocGetStats(AllocSubsystem sub, struct allocStats *stats);
+
+#endif
@@ -0,0 +1,487 @@
+// Implementation of the AnsCoder module
+//
+// The table follows the usual tANS construction. A symbol with scaled count
+// n owns n of the L = 2^tableLog slots, spread over the table with a fixed
+// odd step. Encoding a symbol from a state x in [L, 2L) sheds the low bits
+// of x until it falls in [n, 2n), then moves to the symbol's slot of that
+// rank. Decoding a slot gives back the symbol, the number of bits shed and
+// the state they were shed from.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "AnsCoder.h"
+#include "ByteIO.h"
+#include "Counter.h"
+#include "File.h"
+#include "Stats.h"
+#include "Tokenizer.h"
+#include "huffman.h"
+
+static const char MAGIC[4] = {'H', 'U', 'F', 'T'};
+
+#define ANS_CODER_VERSION 1
+#define MIN_TABLE_LOG 5
+#define DEFAULT_TABLE_LOG 12
+// Encoder states stay below 2^16, which the shed bit count relies on
+#define MAX_TABLE_LOG 15
+
+// Structs definition
+struct symbol {
+    char token[MAX_TOKEN_LEN + 1];
+    int len;
+    uint32_t count;             // slots in the table
+};
+
+struct table {
+    int tableLog;
+    int numSymbols;
+    struct symbol *symbols;
+};
+
+struct encodeSymbol {
+    uint32_t deltaNbBits;       // (state + deltaNbBits) >> 16 is the bits to shed
+    int32_t deltaFindState;     // rank of the shed state, offset to its slot
+};
+
+struct decodeEntry {
+    uint16_t newState;          // state before the shed bits are added back
+    uint8_t nbBits;
+    uint8_t tokenLen;
+    char token[MAX_TOKEN_LEN];
+};
+
+struct symbolIndex {
+    int32_t bytes[256];         // symbol of each single byte character, or -1
+    uint64_t *keys;             // multi-byte characters, by open addressing
+    int32_t *values;
+    size_t mask;
+};
+
+struct bitWriter {
+    struct byteBuffer *out;
+    uint64_t acc;
+    int accBits;
+    uint64_t numBits;
+};
+
+struct rankedItem {
+    int64_t freq;
+    int index;
+};
+
+// Helper functions
+static bool fitTable(struct item *items, int numItems, uint64_t total, struct table *t);
+static int compareRanked(const void *a, const void *b);
+static uint16_t *spreadSymbols(struct table *t);
+static uint16_t *symbolsOf(const char *text, size_t len, struct table *t, uint64_t numTokens);
+static void indexSymbols(struct table *t, struct symbolIndex *index);
+static int32_t findSymbol(struct symbolIndex *index, const char *token, int len);
+static uint64_t tokenKey(const char *token, int len);
+static uint64_t encodeSymbols(struct table *t, uint16_t *syms, uint64_t numTokens,
+                              struct byteBuffer *out);
+static struct decodeEntry *decodeTable(struct table *t);
+static uint32_t readBits(const unsigned char *bits, uint64_t pos, int n);
+static int highBit(uint32_t v);
+static void putBits(struct bitWriter *w, uint32_t bits, int n);
+static void flushBits(struct bitWriter *w);
+static bool getTable(struct byteReader *r, struct table *t);
+
+// Counts the text, scales the counts into a table and encodes the text
+// backwards through it
+unsigned char *AnsEncode(const char *text, size_t len, size_t *outLen) {
+    uint64_t numTokens;
+    Counter c = countTextTokens(text, len, &numTokens);
+    int numItems;
+    struct item *items = CounterItems(c, &numItems);
+    CounterFree(c);
+    struct table t;
+    bool ok = fitTable(items, numItems, numTokens, &t);
+    CounterFreeItems(items, numItems);
+    uint16_t *syms = ok ? symbolsOf(text, len, &t, numTokens) : NULL;
+    if (syms == NULL) {
+        AllocFree(ALLOC_CODE, t.symbols);
+        return NULL;
+    }
+
+    struct byteBuffer out = {NULL, 0, 0};
+    ByteBufferPut(&out, MAGIC, sizeof(MAGIC));
+    ByteBufferPutU32(&out, ANS_CODER_VERSION);
+    ByteBufferPutU64(&out, len);
+    ByteBufferPutU32(&out, t.numSymbols);
+    ByteBufferPutU8(&out, t.tableLog);
+    for (int s = 0; s < t.numSymbols; s++) {
+        ByteBufferPutU8(&out, t.symbols[s].len);
+        ByteBufferPut(&out, t.symbols[s].token, t.symbols[s].len);
+        ByteBufferPutU16(&out, t.symbols[s].count);
+    }
+
+    // The bit count goes before the bits, so it is filled in afterwards
+    size_t numBitsAt = out.len;
+    ByteBufferPutU64(&out, 0);
+    StatsBegin(STATS_ENCODE);
+    uint64_t numBits = encodeSymbols(&t, syms, numTokens, &out);
+    StatsEnd(STATS_ENCODE);
+    for (int i = 0; i < 8; i++) {
+        out.data[numBitsAt + i] = numBits >> (8 * i);
+    }
+    StatsAdd(STATS_BYTES_OUT, out.len);
+
+    AllocFree(ALLOC_BUFFER, syms);
+    AllocFree(ALLOC_CODE, t.symbols);
+    *outLen = out.len;
+    return out.data;
+}
+
+// Reads and checks the table, then decodes forwards from the last state the
+// encoder wrote, which must lead back to the state it started from
+char *AnsDecode(const unsigned char *data, size_t len, size_t *textLen) {
+    struct byteReader r = {data, len};
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    uint64_t size;
+    uint64_t numBits;
+    struct table t = {0, 0, NULL};
+    if (!ByteReaderGet(&r, magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            !ByteReaderGetU32(&r, &version) || version != ANS_CODER_VERSION ||
+            !ByteReaderGetU64(&r, &size) || !getTable(&r, &t) ||
+            !ByteReaderGetU64(&r, &numBits) ||
+            numBits / 8 + (numBits % 8 != 0) != r.left ||
+            (size > 0 && (t.numSymbols == 0 || numBits < (uint64_t)t.tableLog))) {
+        AllocFree(ALLOC_CODE, t.symbols);
+        return NULL;
+    }
+
+    // The bits are copied with room past the end, so reads need no bounds
+    unsigned char *bits = AllocMalloc(ALLOC_BUFFER, r.left + 8);
+    memcpy(bits, r.p, r.left);
+    memset(&bits[r.left], 0, 8);
+    StatsAdd(STATS_BYTES_IN, len);
+
+    char *text = AllocMalloc(ALLOC_BUFFER, size + MAX_TOKEN_LEN);
+    bool ok = true;
+    if (size > 0) {
+        struct decodeEntry *table = decodeTable(&t);
+        StatsBegin(STATS_DECODE);
+        uint64_t pos = numBits - t.tableLog;
+        uint32_t state = readBits(bits, pos, t.tableLog);
+        char *out = text;
+        char *end = text + size;
+        while (out < end) {
+            const struct decodeEntry *e = &table[state];
+            memcpy(out, e->token, MAX_TOKEN_LEN);
+            out += e->tokenLen;
+            if (e->nbBits > pos) {
+                ok = false;
+                break;
+            }
+            pos -= e->nbBits;
+            state = e->newState + readBits(bits, pos, e->nbBits);
+        }
+        ok = ok && out == end && pos == 0 && state == 0;
+        StatsEnd(STATS_DECODE);
+        AllocFree(ALLOC_CODE, table);
+    } else {
+        ok = numBits == 0;
+    }
+    AllocFree(ALLOC_BUFFER, bits);
+    AllocFree(ALLOC_CODE, t.symbols);
+    if (!ok) {
+        AllocFree(ALLOC_BUFFER, text);
+        return NULL;
+    }
+    StatsAdd(STATS_BYTES_OUT, size);
+    *textLen = size;
+    return text;
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Scales the counts to add up to the table size. Every symbol keeps at
+// least one slot, and the slots that costs are taken back from the symbols
+// with the most, which lose the least by it. Returns false if a token is
+// empty (a NUL byte) or there are too many symbols for the largest table.
+static bool fitTable(struct item *items, int numItems, uint64_t total, struct table *t) {
+    t->tableLog = DEFAULT_TABLE_LOG;
+    while (t->tableLog < MAX_TABLE_LOG && (1 << t->tableLog) < 4 * numItems) {
+        t->tableLog++;
+    }
+    t->numSymbols = numItems;
+    t->symbols = AllocMalloc(ALLOC_CODE, numItems * sizeof(struct symbol));
+    uint32_t tableSize = 1u << t->tableLog;
+    if (numItems > (int)tableSize) {
+        return false;
+    }
+
+    struct rankedItem *ranked = AllocMalloc(ALLOC_CODE, numItems * sizeof(struct rankedItem));
+    int64_t sum = 0;
+    bool ok = true;
+    for (int i = 0; i < numItems; i++) {
+        struct symbol *s = &t->symbols[i];
+        s->len = strlen(items[i].token);
+        ok = ok && s->len > 0;
+        memcpy(s->token, items[i].token, s->len + 1);
+        uint64_t scaled = ((uint64_t)items[i].freq * tableSize * 2 + total) / (2 * total);
+        s->count = scaled > 0 ? scaled : 1;
+        sum += s->count;
+        ranked[i] = (struct rankedItem){items[i].freq, i};
+    }
+    qsort(ranked, numItems, sizeof(struct rankedItem), compareRanked);
+    if (numItems > 0 && sum < tableSize) {
+        t->symbols[ranked[0].index].count += tableSize - sum;
+        sum = tableSize;
+    }
+    while (sum > tableSize) {
+        for (int i = 0; i < numItems && sum > tableSize; i++) {
+            struct symbol *s = &t->symbols[ranked[i].index];
+            if (s->count > 1) {
+                s->count--;
+                sum--;
+            }
+        }
+    }
+    AllocFree(ALLOC_CODE, ranked);
+    return ok;
+}
+
+// Most frequent first
+static int compareRanked(const void *a, const void *b) {
+    const struct rankedItem *x = a;
+    const struct rankedItem *y = b;
+    if (x->freq != y->freq) {
+        return x->freq > y->freq ? -1 : 1;
+    }
+    return x->index - y->index;
+}
+
+// Returns the symbol in each slot. The step is odd, so it visits every slot
+// of the power of two table once.
+static uint16_t *spreadSymbols(struct table *t) {
+    uint32_t tableSize = 1u << t->tableLog;
+    uint32_t mask = tableSize - 1;
+    uint32_t step = (tableSize >> 1) + (tableSize >> 3) + 3;
+    uint16_t *slots = AllocMalloc(ALLOC_CODE, tableSize * sizeof(uint16_t));
+    uint32_t pos = 0;
+    for (int s = 0; s < t->numSymbols; s++) {
+        for (uint32_t k = 0; k < t->symbols[s].count; k++) {
+            slots[pos] = s;
+            pos = (pos + step) & mask;
+        }
+    }
+    return slots;
+}
+
+// Returns the symbol of every token of the text, or NULL if one is not in
+// the table
+static uint16_t *symbolsOf(const char *text, size_t len, struct table *t, uint64_t numTokens) {
+    struct symbolIndex index;
+    indexSymbols(t, &index);
+    uint16_t *syms = AllocMalloc(ALLOC_BUFFER, (numTokens + 1) * sizeof(uint16_t));
+    uint64_t n = 0;
+    for (size_t i = 0; i < len; n++) {
+        int tokenLen = TokenCharLen((char *)&text[i]);
+        if (i + tokenLen > len) {
+            tokenLen = len - i;
+        }
+        int32_t s = tokenLen == 1 ? index.bytes[(unsigned char)text[i]]
+                                  : findSymbol(&index, &text[i], tokenLen);
+        if (s < 0) {
+            AllocFree(ALLOC_BUFFER, syms);
+            syms = NULL;
+            break;
+        }
+        syms[n] = s;
+        i += tokenLen;
+    }
+    AllocFree(ALLOC_CODE, index.keys);
+    AllocFree(ALLOC_CODE, index.values);
+    return syms;
+}
+
+static void indexSymbols(struct table *t, struct symbolIndex *index) {
+    for (int b = 0; b < 256; b++) {
+        index->bytes[b] = -1;
+    }
+    size_t cap = 16;
+    while (cap < 2 * (size_t)t->numSymbols) {
+        cap *= 2;
+    }
+    index->mask = cap - 1;
+    index->keys = AllocMalloc(ALLOC_CODE, cap * sizeof(uint64_t));
+    index->values = AllocMalloc(ALLOC_CODE, cap * sizeof(int32_t));
+    memset(index->keys, 0, cap * sizeof(uint64_t));
+    for (int s = 0; s < t->numSymbols; s++) {
+        struct symbol *sym = &t->symbols[s];
+        if (sym->len == 1) {
+            index->bytes[(unsigned char)sym->token[0]] = s;
+            continue;
+        }
+        uint64_t key = tokenKey(sym->token, sym->len);
+        size_t slot = (key * UINT64_C(0x9E3779B97F4A7C15) >> 32) & index->mask;
+        while (index->keys[slot] != 0) {
+            slot = (slot + 1) & index->mask;
+        }
+        index->keys[slot] = key;
+        index->values[slot] = s;
+    }
+}
+
+static int32_t findSymbol(struct symbolIndex *index, const char *token, int len) {
+    uint64_t key = tokenKey(token, len);
+    size_t slot = (key * UINT64_C(0x9E3779B97F4A7C15) >> 32) & index->mask;
+    while (index->keys[slot] != 0) {
+        if (index->keys[slot] == key) {
+            return index->values[slot];
+        }
+        slot = (slot + 1) & index->mask;
+    }
+    return -1;
+}
+
+// Packs the length and bytes of a token, which is never 0
+static uint64_t tokenKey(const char *token, int len) {
+    uint64_t key = len;
+    for (int i = 0; i < len; i++) {
+        key |= (uint64_t)(unsigned char)token[i] << (8 * (i + 1));
+    }
+    return key;
+}
+
+// Encodes the symbols last to first, then writes the final state, so the
+// decoder reads the state first and the symbols in order. Returns the
+// number of bits written.
+static uint64_t encodeSymbols(struct table *t, uint16_t *syms, uint64_t numTokens,
+                              struct byteBuffer *out) {
+    if (numTokens == 0) {
+        return 0;
+    }
+    uint32_t tableSize = 1u << t->tableLog;
+    uint16_t *slots = spreadSymbols(t);
+
+    // The slots of each symbol in table order, by rank
+    uint16_t *stateTable = AllocMalloc(ALLOC_CODE, tableSize * sizeof(uint16_t));
+    uint32_t *next = AllocMalloc(ALLOC_CODE, t->numSymbols * sizeof(uint32_t));
+    struct encodeSymbol *enc = AllocMalloc(ALLOC_CODE, t->numSymbols * sizeof(struct encodeSymbol));
+    uint32_t start = 0;
+    for (int s = 0; s < t->numSymbols; s++) {
+        uint32_t n = t->symbols[s].count;
+        uint32_t maxBits = t->tableLog - (n > 1 ? highBit(n - 1) : 0);
+        enc[s].deltaNbBits = (maxBits << 16) - (n << maxBits);
+        enc[s].deltaFindState = (int32_t)start - (int32_t)n;
+        next[s] = start;
+        start += n;
+    }
+    for (uint32_t u = 0; u < tableSize; u++) {
+        stateTable[next[slots[u]]++] = tableSize + u;
+    }
+
+    struct bitWriter w = {out, 0, 0, 0};
+    uint32_t state = tableSize;
+    for (uint64_t i = numTokens; i-- > 0; ) {
+        const struct encodeSymbol *e = &enc[syms[i]];
+        int nbBits = (state + e->deltaNbBits) >> 16;
+        putBits(&w, state & ((1u << nbBits) - 1), nbBits);
+        state = stateTable[(state >> nbBits) + e->deltaFindState];
+    }
+    putBits(&w, state - tableSize, t->tableLog);
+    flushBits(&w);
+
+    AllocFree(ALLOC_CODE, slots);
+    AllocFree(ALLOC_CODE, stateTable);
+    AllocFree(ALLOC_CODE, next);
+    AllocFree(ALLOC_CODE, enc);
+    return w.numBits;
+}
+
+// The k-th slot of a symbol with count n came from the states with
+// n + k in their top bits
+static struct decodeEntry *decodeTable(struct table *t) {
+    uint32_t tableSize = 1u << t->tableLog;
+    uint16_t *slots = spreadSymbols(t);
+    uint32_t *next = AllocMalloc(ALLOC_CODE, t->numSymbols * sizeof(uint32_t));
+    for (int s = 0; s < t->numSymbols; s++) {
+        next[s] = t->symbols[s].count;
+    }
+    struct decodeEntry *table = AllocMalloc(ALLOC_CODE, tableSize * sizeof(struct decodeEntry));
+    for (uint32_t u = 0; u < tableSize; u++) {
+        struct symbol *sym = &t->symbols[slots[u]];
+        uint32_t x = next[slots[u]]++;
+        struct decodeEntry *e = &table[u];
+        e->nbBits = t->tableLog - highBit(x);
+        e->newState = (x << e->nbBits) - tableSize;
+        e->tokenLen = sym->len;
+        memcpy(e->token, sym->token, MAX_TOKEN_LEN);
+    }
+    AllocFree(ALLOC_CODE, slots);
+    AllocFree(ALLOC_CODE, next);
+    return table;
+}
+
+// Returns the n bits from bit pos, least significant first. n is at most
+// MAX_TABLE_LOG, so the bits are within four bytes.
+static uint32_t readBits(const unsigned char *bits, uint64_t pos, int n) {
+    const unsigned char *p = &bits[pos >> 3];
+    uint32_t v = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+                 (uint32_t)p[3] << 24;
+    return (v >> (pos & 7)) & ((1u << n) - 1);
+}
+
+// Position of the highest set bit, v > 0
+static int highBit(uint32_t v) {
+    return 31 - __builtin_clz(v);
+}
+
+// Appends n bits, least significant first
+static void putBits(struct bitWriter *w, uint32_t bits, int n) {
+    w->acc |= (uint64_t)bits << w->accBits;
+    w->accBits += n;
+    w->numBits += n;
+    if (w->accBits >= 32) {
+        ByteBufferPutU32(w->out, (uint32_t)w->acc);
+        w->acc >>= 32;
+        w->accBits -= 32;
+    }
+}
+
+static void flushBits(struct bitWriter *w) {
+    for (; w->accBits > 0; w->accBits -= 8) {
+        ByteBufferPutU8(w->out, w->acc);
+        w->acc >>= 8;
+    }
+}
+
+// Reads the symbols and their counts, which must fill the table exactly
+static bool getTable(struct byteReader *r, struct table *t) {
+    uint32_t numSymbols;
+    unsigned char tableLog;
+    if (!ByteReaderGetU32(r, &numSymbols) || !ByteReaderGet(r, &tableLog, 1) ||
+            tableLog < MIN_TABLE_LOG || tableLog > MAX_TABLE_LOG ||
+            numSymbols > (1u << tableLog) || numSymbols > r->left / 4) {
+        return false;
+    }
+    t->tableLog = tableLog;
+    t->numSymbols = numSymbols;
+    t->symbols = AllocMalloc(ALLOC_CODE, (numSymbols + 1) * sizeof(struct symbol));
+    uint32_t sum = 0;
+    for (uint32_t s = 0; s < numSymbols; s++) {
+        struct symbol *sym = &t->symbols[s];
+        unsigned char len;
+        uint16_t count;
+        if (!ByteReaderGet(r, &len, 1) || len == 0 || len > MAX_TOKEN_LEN) {
+            return false;
+        }
+        memset(sym->token, 0, sizeof(sym->token));
+        if (!ByteReaderGet(r, sym->token, len) || !ByteReaderGetU16(r, &count) || count == 0 ||
+                strlen(sym->token) != len) {
+            return false;
+        }
+        sym->len = len;
+        sym->count = count;
+        sum += count;
+    }
+    return numSymbols == 0 || sum == (1u << tableLog);
+}
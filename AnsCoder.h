@@ -0,0 +1,39 @@
+// Interface to the AnsCoder module, an entropy coder that uses table-based
+// asymmetric numeral systems (tANS) instead of a huffman code
+//
+// The characters are counted into a Counter, as for a huffman tree, and the
+// counts are scaled to add up to the table size, a power of two. Each
+// character then costs close to -log2 of its probability in bits instead of
+// a whole number of bits, which matters most for frequent characters such
+// as the space. The encoder runs over the text backwards, so that the
+// decoder runs forwards with one table lookup and one read of at most
+// tableLog bits per character.
+//
+// Layout (integers little-endian):
+//   "HUFT", u32 version, u64 decoded bytes, u32 numSymbols, u8 tableLog
+//   per symbol: u8 token length, the token bytes and u16 scaled count
+//   u64 encoded bits, then the bits, padded to a whole byte
+
+#ifndef ANS_CODER_H
+#define ANS_CODER_H
+
+#include <stddef.h>
+
+/**
+ * Encodes len bytes of text with a table fitted to its character counts
+ * Returns the encoding and sets *outLen to its length in bytes, or returns
+ * NULL if the text has a NUL byte or more distinct characters than the
+ * largest table holds. The encoding must be freed with
+ * AllocFree(ALLOC_BUFFER, ...)
+ */
+unsigned char *AnsEncode(const char *text, size_t len, size_t *outLen);
+
+/**
+ * Decodes an encoding made by AnsEncode
+ * Returns the text and sets *textLen to its length, or returns NULL if data
+ * is not a complete, well-formed encoding. The text must be freed with
+ * AllocFree(ALLOC_BUFFER, ...)
+ */
+char *AnsDecode(const unsigned char *data, size_t len, size_t *textLen);
+
+#endif
@@ -0,0 +1,181 @@
+// Implementation of the BitIO module
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "Alloc.h"
+#include "BitIO.h"
+
+#define BITIO_BUFFER_SIZE 65536
+
+// Structs definition
+struct bitWriter {
+    FILE *fp;
+    uint64_t acc;       // pending bits, right aligned
+    int accBits;
+    uint64_t numBits;
+    size_t len;
+    unsigned char buffer[BITIO_BUFFER_SIZE];
+};
+
+struct bitReader {
+    FILE *fp;
+    uint64_t acc;       // unread bits, right aligned
+    int accBits;
+    size_t pos;
+    size_t len;
+    unsigned char buffer[BITIO_BUFFER_SIZE];
+};
+
+// Helper functions
+static void writeBuffer(BitWriter bw);
+static bool refill(BitReader br);
+
+// Returns a new bit writer for the given stream
+BitWriter BitWriterNew(FILE *fp) {
+    BitWriter bw = AllocMalloc(ALLOC_IO, sizeof(struct bitWriter));
+    bw->fp = fp;
+    bw->acc = 0;
+    bw->accBits = 0;
+    bw->numBits = 0;
+    bw->len = 0;
+    return bw;
+}
+
+// Appends bits to the accumulator and moves whole bytes into the buffer
+void BitWriterWrite(BitWriter bw, uint32_t bits, int numBits) {
+    bw->acc = (bw->acc << numBits) | (bits & ((UINT64_C(1) << numBits) - 1));
+    bw->accBits += numBits;
+    bw->numBits += numBits;
+    while (bw->accBits >= 8) {
+        bw->accBits -= 8;
+        bw->buffer[bw->len++] = (unsigned char)(bw->acc >> bw->accBits);
+        if (bw->len == BITIO_BUFFER_SIZE) {
+            writeBuffer(bw);
+        }
+    }
+}
+
+// Pads the final byte and writes everything out
+void BitWriterFlush(BitWriter bw) {
+    if (bw->accBits > 0) {
+        bw->buffer[bw->len++] = (unsigned char)(bw->acc << (8 - bw->accBits));
+        bw->accBits = 0;
+    }
+    writeBuffer(bw);
+    fflush(bw->fp);
+}
+
+// Writes out complete bytes while keeping the partial byte pending
+void BitWriterSync(BitWriter bw) {
+    writeBuffer(bw);
+    fflush(bw->fp);
+}
+
+// Returns the number of bits written so far
+uint64_t BitWriterNumBits(BitWriter bw) {
+    return bw->numBits;
+}
+
+// Flushes and frees the writer
+void BitWriterFree(BitWriter bw) {
+    if (bw == NULL) {
+        return;
+    }
+    BitWriterFlush(bw);
+    AllocFree(ALLOC_IO, bw);
+}
+
+// Returns a new bit reader for the given stream
+BitReader BitReaderNew(FILE *fp) {
+    BitReader br = AllocMalloc(ALLOC_IO, sizeof(struct bitReader));
+    br->fp = fp;
+    br->acc = 0;
+    br->accBits = 0;
+    br->pos = 0;
+    br->len = 0;
+    return br;
+}
+
+// Returns the next bit, or -1 at the end of the stream
+int BitReaderReadBit(BitReader br) {
+    if (br->accBits == 0) {
+        if (br->pos == br->len && !refill(br)) {
+            return -1;
+        }
+        br->acc = br->buffer[br->pos++];
+        br->accBits = 8;
+    }
+    br->accBits--;
+    return (br->acc >> br->accBits) & 1;
+}
+
+// Reads numBits bits, most significant first
+bool BitReaderRead(BitReader br, int numBits, uint32_t *bits) {
+    while (br->accBits < numBits) {
+        if (br->pos == br->len && !refill(br)) {
+            return false;
+        }
+        br->acc = (br->acc << 8) | br->buffer[br->pos++];
+        br->accBits += 8;
+    }
+    br->accBits -= numBits;
+    *bits = (uint32_t)((br->acc >> br->accBits) & ((UINT64_C(1) << numBits) - 1));
+    return true;
+}
+
+// Frees the reader
+void BitReaderFree(BitReader br) {
+    AllocFree(ALLOC_IO, br);
+}
+
+// Expands packed bits into '0'/'1' characters
+void BitsToText(const unsigned char *bits, uint64_t numBits, char *text) {
+    for (uint64_t i = 0; i < numBits; i++) {
+        text[i] = ((bits[i >> 3] >> (7 - (i & 7))) & 1) ? '1' : '0';
+    }
+    text[numBits] = '\0';
+}
+
+// Packs '0'/'1' characters into bits, zero padding the last byte
+uint64_t TextToBits(const char *text, unsigned char *bits) {
+    uint64_t numBits = 0;
+    unsigned char byte = 0;
+    for (size_t i = 0; text[i] != '\0'; i++) {
+        if (text[i] != '0' && text[i] != '1') {
+            continue;
+        }
+        byte = (byte << 1) | (text[i] - '0');
+        if ((++numBits & 7) == 0) {
+            bits[(numBits >> 3) - 1] = byte;
+            byte = 0;
+        }
+    }
+    if ((numBits & 7) != 0) {
+        bits[numBits >> 3] = byte << (8 - (numBits & 7));
+    }
+    return numBits;
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Writes the buffered bytes to the stream
+static void writeBuffer(BitWriter bw) {
+    if (bw->len > 0 && fwrite(bw->buffer, 1, bw->len, bw->fp) != bw->len) {
+        fprintf(stderr, "error: failed to write encoding\n");
+        exit(EXIT_FAILURE);
+    }
+    bw->len = 0;
+}
+
+// Reads whatever is available of the stream into the buffer
+// read() is used instead of fread() so a pipe is consumed as data arrives
+static bool refill(BitReader br) {
+    ssize_t n = read(fileno(br->fp), br->buffer, BITIO_BUFFER_SIZE);
+    br->len = n > 0 ? n : 0;
+    br->pos = 0;
+    return br->len > 0;
+}
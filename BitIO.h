@@ -0,0 +1,84 @@
+// Interface to the BitIO module for reading and writing packed bitstreams
+// Bits are packed most significant bit first within each byte
+
+#ifndef BITIO_H
+#define BITIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct bitWriter *BitWriter;
+typedef struct bitReader *BitReader;
+
+/**
+ * Returns a new bit writer that writes to the given stream
+ * The writer must be freed with BitWriterFree, which flushes it first
+ */
+BitWriter BitWriterNew(FILE *fp);
+
+/**
+ * Writes the low numBits bits of bits, most significant first
+ * numBits must be at most 32
+ */
+void BitWriterWrite(BitWriter bw, uint32_t bits, int numBits);
+
+/**
+ * Pads the last partial byte with zero bits and writes out all buffered bytes
+ */
+void BitWriterFlush(BitWriter bw);
+
+/**
+ * Writes out all complete buffered bytes without padding, so that a reader
+ * on the other end of a pipe sees everything but the last partial byte
+ */
+void BitWriterSync(BitWriter bw);
+
+/**
+ * Returns the number of bits written so far, excluding padding
+ */
+uint64_t BitWriterNumBits(BitWriter bw);
+
+/**
+ * Flushes the writer and frees it. The stream is not closed.
+ */
+void BitWriterFree(BitWriter bw);
+
+/**
+ * Returns a new bit reader that reads from the given stream
+ * The reader reads the underlying descriptor directly, so nothing else may
+ * read from the stream while it is in use
+ * The reader must be freed with BitReaderFree
+ */
+BitReader BitReaderNew(FILE *fp);
+
+/**
+ * Returns the next bit, or -1 if the stream has ended
+ */
+int BitReaderReadBit(BitReader br);
+
+/**
+ * Reads numBits bits (at most 32) into *bits, most significant first
+ * Returns false if the stream ended before numBits bits were read
+ */
+bool BitReaderRead(BitReader br, int numBits, uint32_t *bits);
+
+/**
+ * Frees the reader. The stream is not closed.
+ */
+void BitReaderFree(BitReader br);
+
+/**
+ * Writes numBits packed bits to text as '0'/'1' characters, followed by a
+ * null-terminator. text must have room for numBits + 1 characters.
+ */
+void BitsToText(const unsigned char *bits, uint64_t numBits, char *text);
+
+/**
+ * Packs a '0'/'1' string into bits, ignoring any other characters
+ * bits must have room for (strlen(text) + 7) / 8 bytes
+ * Returns the number of bits packed
+ */
+uint64_t TextToBits(const char *text, unsigned char *bits);
+
+#endif
@@ -0,0 +1,436 @@
+// Implementation of the BlockCoder module
+//
+// Trees are kept as canonical code lengths: sorted by length and then by
+// token, the codes are consecutive binary numbers, so the lengths alone
+// fix every code. Encoder and decoder both rebuild the tree from the
+// lengths and code through a HuffmanCodec built from it.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "BlockCoder.h"
+#include "ByteIO.h"
+#include "Counter.h"
+#include "File.h"
+#include "HuffmanCodec.h"
+#include "Stats.h"
+#include "Tokenizer.h"
+#include "huffman.h"
+
+static const char MAGIC[4] = {'H', 'U', 'F', 'B'};
+
+#define BLOCK_CODER_VERSION 1
+#define MAX_CODE_LEN 63
+
+// Structs definition
+struct codeLen {
+    char token[MAX_TOKEN_LEN + 1];
+    int len;
+};
+
+struct blockTree {
+    int numSymbols;
+    struct codeLen *symbols;    // canonical order
+    HuffmanCodec codec;
+    int maxTokenLen;
+};
+
+struct block {
+    uint32_t tree;
+    uint32_t size;
+    uint64_t numBits;
+    uint64_t start;             // offset in the decoded text
+    const unsigned char *bits;
+};
+
+struct blockFile {
+    uint32_t numTrees;
+    struct blockTree *trees;
+    size_t numBlocks;
+    struct block *blocks;
+    uint64_t decodedSize;
+};
+
+// Helper functions
+static size_t blockEnd(const char *text, size_t len, size_t start, size_t blockSize);
+static void fitTree(Counter c, struct blockTree *t);
+static int compareCanonical(const void *a, const void *b);
+static uint64_t treeHeaderBits(struct blockTree *t);
+static uint64_t codedBits(struct blockTree *t, struct item *items, int numItems);
+static HuffmanCodec canonicalCodec(struct blockTree *t);
+static void putTree(struct byteBuffer *b, struct blockTree *t);
+static bool getTree(struct byteReader *r, struct blockTree *t);
+
+// Encodes each block with a new tree or the previous block's, whichever is
+// smaller once the new tree's header is paid for
+unsigned char *BlockEncode(const char *text, size_t len, size_t blockSize, size_t *outLen) {
+    struct byteBuffer trees = {NULL, 0, 0};
+    struct byteBuffer index = {NULL, 0, 0};
+    struct byteBuffer payload = {NULL, 0, 0};
+    uint32_t numTrees = 0;
+    uint32_t numBlocks = 0;
+    struct blockTree prev = {0, NULL, NULL};
+    if (memchr(text, '\0', len) != NULL) {
+        return NULL;
+    }
+
+    for (size_t start = 0; start < len; ) {
+        size_t end = blockEnd(text, len, start, blockSize);
+        uint64_t numTokens;
+        Counter c = countTextTokens(&text[start], end - start, &numTokens);
+        int numItems;
+        struct item *items = CounterItems(c, &numItems);
+
+        struct blockTree fresh;
+        fitTree(c, &fresh);
+        uint64_t freshBits = treeHeaderBits(&fresh) + codedBits(&fresh, items, numItems);
+        uint64_t reuseBits = prev.codec != NULL ? codedBits(&prev, items, numItems) : UINT64_MAX;
+        if (freshBits < reuseBits) {
+            AllocFree(ALLOC_CODE, prev.symbols);
+            CodecFree(prev.codec);
+            prev = fresh;
+            prev.codec = canonicalCodec(&prev);
+            if (prev.codec == NULL) {
+                fprintf(stderr, "error: block tree is too deep\n");
+                exit(EXIT_FAILURE);
+            }
+            putTree(&trees, &prev);
+            numTrees++;
+        } else {
+            AllocFree(ALLOC_CODE, fresh.symbols);
+        }
+
+        CounterFreeItems(items, numItems);
+        CounterFree(c);
+
+        // Encode straight into the payload, which is grown to fit first
+        StatsBegin(STATS_ENCODE);
+        size_t maxBytes = CodecMaxEncodedSize(prev.codec, end - start);
+        if (payload.len + maxBytes > payload.cap) {
+            ByteBufferPut(&payload, NULL, maxBytes);
+            payload.len -= maxBytes;
+        }
+        int64_t numBits = CodecEncode(prev.codec, &text[start], end - start,
+                                      &payload.data[payload.len], maxBytes);
+        StatsEnd(STATS_ENCODE);
+        payload.len += (numBits + 7) / 8;
+
+        ByteBufferPutU32(&index, numTrees - 1);
+        ByteBufferPutU32(&index, end - start);
+        ByteBufferPutU64(&index, numBits);
+        numBlocks++;
+        start = end;
+    }
+    AllocFree(ALLOC_CODE, prev.symbols);
+    CodecFree(prev.codec);
+
+    struct byteBuffer out = {NULL, 0, 0};
+    ByteBufferPut(&out, MAGIC, sizeof(MAGIC));
+    ByteBufferPutU32(&out, BLOCK_CODER_VERSION);
+    ByteBufferPutU32(&out, numTrees);
+    ByteBufferPutU32(&out, numBlocks);
+    ByteBufferPutU64(&out, len);
+    ByteBufferPut(&out, trees.data, trees.len);
+    ByteBufferPut(&out, index.data, index.len);
+    ByteBufferPut(&out, payload.data, payload.len);
+    AllocFree(ALLOC_BUFFER, trees.data);
+    AllocFree(ALLOC_BUFFER, index.data);
+    AllocFree(ALLOC_BUFFER, payload.data);
+    StatsAdd(STATS_BYTES_OUT, out.len);
+
+    *outLen = out.len;
+    return out.data;
+}
+
+// Reads and checks the tree table and the block index, and builds a codec
+// for every tree
+BlockFile BlockFileOpen(const unsigned char *data, size_t len) {
+    struct byteReader r = {data, len};
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    uint32_t numTrees;
+    uint32_t numBlocks;
+    uint64_t decodedSize;
+    if (!ByteReaderGet(&r, magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            !ByteReaderGetU32(&r, &version) || version != BLOCK_CODER_VERSION ||
+            !ByteReaderGetU32(&r, &numTrees) || !ByteReaderGetU32(&r, &numBlocks) ||
+            !ByteReaderGetU64(&r, &decodedSize) || numTrees > r.left) {
+        return NULL;
+    }
+
+    BlockFile bf = AllocMalloc(ALLOC_CODE, sizeof(struct blockFile));
+    bf->numTrees = 0;
+    bf->trees = AllocMalloc(ALLOC_CODE, (numTrees + 1) * sizeof(struct blockTree));
+    bf->numBlocks = numBlocks;
+    bf->blocks = NULL;
+    bf->decodedSize = decodedSize;
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < numTrees; i++) {
+        struct blockTree *t = &bf->trees[i];
+        ok = getTree(&r, t);
+        if (ok) {
+            bf->numTrees++;
+            t->codec = canonicalCodec(t);
+            ok = t->codec != NULL;
+        }
+    }
+
+    // Every block must name a tree, and the blocks must cover the decoded
+    // text and the rest of the data exactly. Every code is at least a bit
+    // long, so a block's bits decode to at most that many of its tree's
+    // longest tokens, which bounds the decoded size by the size of the data.
+    ok = ok && numBlocks <= r.left / 16;
+    if (ok) {
+        bf->blocks = AllocMalloc(ALLOC_CODE, (numBlocks + 1) * sizeof(struct block));
+    }
+    uint64_t start = 0;
+    for (uint32_t i = 0; ok && i < numBlocks; i++) {
+        struct block *b = &bf->blocks[i];
+        ok = ByteReaderGetU32(&r, &b->tree) && ByteReaderGetU32(&r, &b->size) &&
+             ByteReaderGetU64(&r, &b->numBits) && b->tree < numTrees;
+        if (ok) {
+            uint64_t maxTokenLen = bf->trees[b->tree].maxTokenLen;
+            ok = (b->size + maxTokenLen - 1) / maxTokenLen <= b->numBits;
+        }
+        b->start = start;
+        start += b->size;
+    }
+    for (uint32_t i = 0; ok && i < numBlocks; i++) {
+        struct block *b = &bf->blocks[i];
+        uint64_t numBytes = b->numBits / 8 + (b->numBits % 8 != 0);
+        ok = numBytes <= r.left;
+        if (ok) {
+            b->bits = r.p;
+            r.p += numBytes;
+            r.left -= numBytes;
+        }
+    }
+    if (!ok || start != decodedSize || r.left != 0) {
+        BlockFileFree(bf);
+        return NULL;
+    }
+    return bf;
+}
+
+// Frees the trees, their codecs and the index
+void BlockFileFree(BlockFile bf) {
+    if (bf == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < bf->numTrees; i++) {
+        AllocFree(ALLOC_CODE, bf->trees[i].symbols);
+        CodecFree(bf->trees[i].codec);
+    }
+    AllocFree(ALLOC_CODE, bf->trees);
+    AllocFree(ALLOC_CODE, bf->blocks);
+    AllocFree(ALLOC_CODE, bf);
+}
+
+size_t BlockFileNumBlocks(BlockFile bf) {
+    return bf->numBlocks;
+}
+
+uint64_t BlockFileDecodedSize(BlockFile bf) {
+    return bf->decodedSize;
+}
+
+uint64_t BlockFileBlockStart(BlockFile bf, size_t i) {
+    return bf->blocks[i].start;
+}
+
+size_t BlockFileBlockSize(BlockFile bf, size_t i) {
+    return bf->blocks[i].size;
+}
+
+// Decodes one block with its tree's codec
+bool BlockFileDecodeBlock(BlockFile bf, size_t i, char *out) {
+    struct block *b = &bf->blocks[i];
+    HuffmanCodec codec = bf->trees[b->tree].codec;
+    return CodecDecode(codec, b->bits, b->numBits, out, b->size) == (int64_t)b->size;
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Returns the end of the block starting at start, moved back to the start
+// of a character if it would split one
+static size_t blockEnd(const char *text, size_t len, size_t start, size_t blockSize) {
+    if (len - start <= blockSize) {
+        return len;
+    }
+    size_t end = start + blockSize;
+    while (end > start + 1 && (text[end] & 0xC0) == 0x80) {
+        end--;
+    }
+    return end;
+}
+
+// Takes the code lengths of a huffman tree of the counts, in canonical order
+static void fitTree(Counter c, struct blockTree *t) {
+    struct huffmanTree *tree = createHuffmanTreeFromCounter(c);
+    t->numSymbols = CounterNumItems(c);
+    t->symbols = AllocMalloc(ALLOC_CODE, t->numSymbols * sizeof(struct codeLen));
+    t->codec = NULL;
+
+    struct huffmanTree **stack = AllocMalloc(ALLOC_CODE, 2 * t->numSymbols * sizeof(struct huffmanTree *));
+    int *depth = AllocMalloc(ALLOC_CODE, 2 * t->numSymbols * sizeof(int));
+    int top = 0;
+    int n = 0;
+    stack[top] = tree;
+    depth[top++] = 0;
+    while (top > 0) {
+        top--;
+        struct huffmanTree *node = stack[top];
+        int d = depth[top];
+        if (node->left == NULL && node->right == NULL) {
+            strcpy(t->symbols[n].token, node->token);
+            t->symbols[n++].len = d;
+            continue;
+        }
+        stack[top] = node->right;
+        depth[top++] = d + 1;
+        stack[top] = node->left;
+        depth[top++] = d + 1;
+    }
+    AllocFree(ALLOC_CODE, stack);
+    AllocFree(ALLOC_CODE, depth);
+    destroyHuffmanTree(tree);
+    qsort(t->symbols, t->numSymbols, sizeof(struct codeLen), compareCanonical);
+}
+
+static int compareCanonical(const void *a, const void *b) {
+    const struct codeLen *x = a;
+    const struct codeLen *y = b;
+    if (x->len != y->len) {
+        return x->len - y->len;
+    }
+    return strcmp(x->token, y->token);
+}
+
+// The size of the tree in the tree table
+static uint64_t treeHeaderBits(struct blockTree *t) {
+    uint64_t bytes = 4;
+    for (int i = 0; i < t->numSymbols; i++) {
+        bytes += 2 + strlen(t->symbols[i].token);
+    }
+    return 8 * bytes;
+}
+
+// Returns the bits needed to code the counts with the tree, or UINT64_MAX
+// if the tree is missing a token. A lone leaf still costs a bit per token.
+static uint64_t codedBits(struct blockTree *t, struct item *items, int numItems) {
+    uint64_t bits = 0;
+    for (int i = 0; i < numItems; i++) {
+        int s = 0;
+        while (s < t->numSymbols && strcmp(t->symbols[s].token, items[i].token) != 0) {
+            s++;
+        }
+        if (s == t->numSymbols) {
+            return UINT64_MAX;
+        }
+        int len = t->symbols[s].len > 0 ? t->symbols[s].len : 1;
+        bits += (uint64_t)items[i].freq * len;
+    }
+    return bits;
+}
+
+// Rebuilds the tree from its canonical code lengths and returns a codec for
+// it, or NULL if the lengths do not form a complete prefix code
+static HuffmanCodec canonicalCodec(struct blockTree *t) {
+    int n = t->numSymbols;
+    struct huffmanTree *nodes = AllocMalloc(ALLOC_CODE, (2 * n - 1) * sizeof(struct huffmanTree));
+    int used = 1;
+    nodes[0] = (struct huffmanTree){NULL, 0, NULL, NULL};
+    bool ok = n > 1 || t->symbols[0].len == 0;
+    if (n == 1) {
+        nodes[0].token = t->symbols[0].token;
+    }
+
+    // Consecutive codes of each length; the code must still fit in its
+    // length, and the last one must use up the code space exactly
+    uint64_t code = 0;
+    int prevLen = t->symbols[0].len;
+    for (int i = 0; ok && n > 1 && i < n; i++) {
+        int len = t->symbols[i].len;
+        ok = len >= prevLen && len >= 1 && len <= MAX_CODE_LEN;
+        if (!ok) {
+            break;
+        }
+        code <<= len - prevLen;
+        prevLen = len;
+        ok = code < (UINT64_C(1) << len);
+
+        struct huffmanTree *node = &nodes[0];
+        for (int b = len - 1; ok && b >= 0; b--) {
+            struct huffmanTree **child = (code >> b) & 1 ? &node->right : &node->left;
+            if (*child == NULL) {
+                ok = used < 2 * n - 1;
+                if (!ok) {
+                    break;
+                }
+                nodes[used] = (struct huffmanTree){NULL, 0, NULL, NULL};
+                *child = &nodes[used++];
+            }
+            node = *child;
+        }
+        if (ok) {
+            node->token = t->symbols[i].token;
+        }
+        code++;
+    }
+    ok = ok && (n == 1 || code == UINT64_C(1) << prevLen);
+
+    HuffmanCodec codec = ok ? CodecNewFromTree(&nodes[0]) : NULL;
+    AllocFree(ALLOC_CODE, nodes);
+    return codec;
+}
+
+static void putTree(struct byteBuffer *b, struct blockTree *t) {
+    ByteBufferPutU32(b, t->numSymbols);
+    for (int i = 0; i < t->numSymbols; i++) {
+        unsigned char tokenLen = strlen(t->symbols[i].token);
+        unsigned char len = t->symbols[i].len;
+        ByteBufferPut(b, &tokenLen, 1);
+        ByteBufferPut(b, t->symbols[i].token, tokenLen);
+        ByteBufferPut(b, &len, 1);
+    }
+}
+
+// Reads one tree of the table, which must be in canonical order
+static bool getTree(struct byteReader *r, struct blockTree *t) {
+    uint32_t numSymbols;
+    if (!ByteReaderGetU32(r, &numSymbols) || numSymbols == 0 || numSymbols > r->left / 2) {
+        return false;
+    }
+    t->numSymbols = numSymbols;
+    t->symbols = AllocMalloc(ALLOC_CODE, numSymbols * sizeof(struct codeLen));
+    t->codec = NULL;
+    t->maxTokenLen = 1;
+    for (uint32_t i = 0; i < numSymbols; i++) {
+        unsigned char tokenLen;
+        unsigned char len;
+        struct codeLen *s = &t->symbols[i];
+        bool ok = ByteReaderGet(r, &tokenLen, 1) && tokenLen > 0 && tokenLen <= MAX_TOKEN_LEN &&
+                  ByteReaderGet(r, s->token, tokenLen) && ByteReaderGet(r, &len, 1);
+        if (ok) {
+            s->token[tokenLen] = '\0';
+            s->len = len;
+            if (tokenLen > t->maxTokenLen) {
+                t->maxTokenLen = tokenLen;
+            }
+            ok = strlen(s->token) == tokenLen &&
+                 (i == 0 || compareCanonical(&t->symbols[i - 1], s) < 0);
+        }
+        if (!ok) {
+            // The tree is not counted in the file yet, so BlockFileFree
+            // would not free its symbols
+            AllocFree(ALLOC_CODE, t->symbols);
+            t->symbols = NULL;
+            return false;
+        }
+    }
+    return true;
+}
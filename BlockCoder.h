@@ -0,0 +1,68 @@
+// Interface to the BlockCoder module, a block-adaptive encoding in which
+// every block of the input is coded with a tree fitted to that block
+//
+// The input is cut into blocks of about the same size (on character
+// boundaries). Each block either gets a new tree built from its own counts
+// or reuses the tree of the block before it, whichever makes the block and
+// its header smaller. Trees are stored once, as canonical code lengths, in
+// a table at the start of the file, followed by an index giving every
+// block's tree, decoded size and bit count, and then the blocks themselves,
+// each starting on a byte boundary. Any block can be decoded on its own
+// from the table, the index and its own bytes.
+//
+// Layout (integers little-endian):
+//   "HUFB", u32 version, u32 numTrees, u32 numBlocks, u64 original size
+//   per tree:  u32 numSymbols, then per symbol u8 token length, the token
+//              bytes and u8 code length, in canonical order
+//   per block: u32 tree, u32 decoded bytes, u64 encoded bits
+//   the encoded blocks, each padded to a whole byte
+
+#ifndef BLOCK_CODER_H
+#define BLOCK_CODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct blockFile *BlockFile;
+
+/**
+ * Encodes len bytes of text in blocks of about blockSize bytes
+ * Returns the encoding and sets *outLen to its length in bytes, or returns
+ * NULL if the text has a NUL byte, which no tree can hold as a token
+ * The encoding must be freed with AllocFree(ALLOC_BUFFER, ...)
+ */
+unsigned char *BlockEncode(const char *text, size_t len, size_t blockSize, size_t *outLen);
+
+/**
+ * Reads the tree table and block index of an encoding made by BlockEncode
+ * Returns NULL if data is not a complete, well-formed block encoding
+ * data must outlive the block file, which must be freed with BlockFileFree
+ */
+BlockFile BlockFileOpen(const unsigned char *data, size_t len);
+
+/**
+ * Frees the block file. The encoding itself is not freed.
+ */
+void BlockFileFree(BlockFile bf);
+
+/**
+ * Returns the number of blocks, and the size of the whole decoded text
+ */
+size_t BlockFileNumBlocks(BlockFile bf);
+uint64_t BlockFileDecodedSize(BlockFile bf);
+
+/**
+ * Returns where block i starts in the decoded text, and its decoded size
+ */
+uint64_t BlockFileBlockStart(BlockFile bf, size_t i);
+size_t BlockFileBlockSize(BlockFile bf, size_t i);
+
+/**
+ * Decodes block i into out, which must have room for its decoded size
+ * Returns false if the block's bits do not decode to exactly that size
+ * Blocks may be decoded in any order, and by several threads at once
+ */
+bool BlockFileDecodeBlock(BlockFile bf, size_t i, char *out);
+
+#endif
@@ -0,0 +1,399 @@
+// Implementation of the BwtCoder module
+//
+// Rotations are sorted by prefix doubling: once they are ranked by their
+// first h bytes, the ranks of a rotation and of the rotation h bytes on
+// rank it by its first 2h bytes, and a counting sort on the first rank of
+// rotations already in order of the second puts them in that order. It
+// stops when every rank is distinct, or once h covers the block if the
+// block repeats itself, in which case equal rotations may go in any order.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "BlockCoder.h"
+#include "ByteIO.h"
+#include "BwtCoder.h"
+#include "Stats.h"
+
+static const char MAGIC[4] = {'H', 'U', 'F', 'X'};
+
+#define BWT_CODER_VERSION 1
+// The symbols are coded in blocks of this many bytes, each with the tree
+// that suits it
+#define SYMBOL_BLOCK_SIZE (64 << 10)
+#define RUN_A 0
+#define RUN_B 1
+#define MAX_SYMBOL 256
+#define SYMBOL_BASE 0x100
+
+// Structs definition
+struct blockHeader {
+    uint32_t size;
+    uint32_t primary;
+    uint32_t numSymbols;
+};
+
+// Helper functions
+static uint32_t bwt(const unsigned char *block, uint32_t n, unsigned char *last);
+static uint32_t *sortRotations(const unsigned char *block, uint32_t n);
+static uint32_t mtfRle(const unsigned char *last, uint32_t n, struct byteBuffer *out);
+static uint32_t putRun(struct byteBuffer *out, uint32_t run);
+static void putSymbol(struct byteBuffer *out, int symbol);
+static char *decodeSymbols(const unsigned char *data, size_t len, size_t *symbolsLen);
+static bool unMtfRle(const unsigned char *symbols, size_t len, size_t *pos,
+                     uint32_t numSymbols, unsigned char *last, uint32_t n);
+static int getSymbol(const unsigned char *symbols, size_t len, size_t *pos);
+static void unbwt(const unsigned char *last, uint32_t n, uint32_t primary, unsigned char *out);
+
+// Transforms every block into symbols, then codes all the symbols with the
+// block coder
+unsigned char *BwtEncode(const char *text, size_t len, size_t blockSize, size_t *outLen) {
+    struct byteBuffer index = {NULL, 0, 0};
+    struct byteBuffer symbols = {NULL, 0, 0};
+    uint32_t numBlocks = 0;
+    unsigned char *last = AllocMalloc(ALLOC_BUFFER, len < blockSize ? len : blockSize);
+
+    StatsBegin(STATS_TRANSFORM);
+    for (size_t start = 0; start < len; start += blockSize) {
+        uint32_t n = len - start < blockSize ? len - start : blockSize;
+        uint32_t primary = bwt((const unsigned char *)&text[start], n, last);
+        uint32_t numSymbols = mtfRle(last, n, &symbols);
+        ByteBufferPutU32(&index, n);
+        ByteBufferPutU32(&index, primary);
+        ByteBufferPutU32(&index, numSymbols);
+        numBlocks++;
+    }
+    StatsEnd(STATS_TRANSFORM);
+    AllocFree(ALLOC_BUFFER, last);
+
+    size_t codedLen;
+    unsigned char *coded = BlockEncode((char *)symbols.data, symbols.len, SYMBOL_BLOCK_SIZE,
+                                       &codedLen);
+    AllocFree(ALLOC_BUFFER, symbols.data);
+
+    struct byteBuffer out = {NULL, 0, 0};
+    ByteBufferPut(&out, MAGIC, sizeof(MAGIC));
+    ByteBufferPutU32(&out, BWT_CODER_VERSION);
+    ByteBufferPutU32(&out, numBlocks);
+    ByteBufferPutU64(&out, len);
+    ByteBufferPut(&out, index.data, index.len);
+    ByteBufferPut(&out, coded, codedLen);
+    AllocFree(ALLOC_BUFFER, index.data);
+    AllocFree(ALLOC_BUFFER, coded);
+
+    *outLen = out.len;
+    return out.data;
+}
+
+// Reads the block index, decodes the symbols and undoes the transform of
+// each block, which must use up exactly its own symbols
+char *BwtDecode(const unsigned char *data, size_t len, size_t *textLen) {
+    struct byteReader r = {data, len};
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    uint32_t numBlocks;
+    uint64_t size;
+    if (!ByteReaderGet(&r, magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            !ByteReaderGetU32(&r, &version) || version != BWT_CODER_VERSION ||
+            !ByteReaderGetU32(&r, &numBlocks) || !ByteReaderGetU64(&r, &size) ||
+            numBlocks > r.left / 12) {
+        return NULL;
+    }
+
+    struct blockHeader *blocks = AllocMalloc(ALLOC_CODE, (numBlocks + 1) * sizeof(struct blockHeader));
+    uint64_t total = 0;
+    uint32_t maxSize = 0;
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < numBlocks; i++) {
+        struct blockHeader *b = &blocks[i];
+        ok = ByteReaderGetU32(&r, &b->size) && ByteReaderGetU32(&r, &b->primary) &&
+             ByteReaderGetU32(&r, &b->numSymbols) &&
+             b->size > 0 && b->size <= BWT_MAX_BLOCK_SIZE && b->primary < b->size;
+        total += ok ? b->size : 0;
+        maxSize = ok && b->size > maxSize ? b->size : maxSize;
+    }
+    size_t symbolsLen = 0;
+    char *symbols = ok && total == size ? decodeSymbols(r.p, r.left, &symbolsLen) : NULL;
+    if (symbols == NULL) {
+        AllocFree(ALLOC_CODE, blocks);
+        return NULL;
+    }
+
+    char *text = AllocMalloc(ALLOC_BUFFER, size);
+    unsigned char *last = AllocMalloc(ALLOC_BUFFER, maxSize);
+    StatsBegin(STATS_TRANSFORM);
+    size_t pos = 0;
+    uint64_t start = 0;
+    for (uint32_t i = 0; ok && i < numBlocks; i++) {
+        struct blockHeader *b = &blocks[i];
+        ok = unMtfRle((unsigned char *)symbols, symbolsLen, &pos, b->numSymbols, last, b->size);
+        if (ok) {
+            unbwt(last, b->size, b->primary, (unsigned char *)&text[start]);
+        }
+        start += b->size;
+    }
+    StatsEnd(STATS_TRANSFORM);
+    ok = ok && pos == symbolsLen;
+    AllocFree(ALLOC_BUFFER, last);
+    AllocFree(ALLOC_BUFFER, symbols);
+    AllocFree(ALLOC_CODE, blocks);
+    if (!ok) {
+        AllocFree(ALLOC_BUFFER, text);
+        return NULL;
+    }
+    *textLen = size;
+    return text;
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Writes the byte before every rotation of the block, in sorted order, to
+// last, and returns the rank of the block itself
+static uint32_t bwt(const unsigned char *block, uint32_t n, unsigned char *last) {
+    uint32_t *order = sortRotations(block, n);
+    uint32_t primary = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t r = order[i];
+        if (r == 0) {
+            primary = i;
+        }
+        last[i] = block[r > 0 ? r - 1 : n - 1];
+    }
+    AllocFree(ALLOC_BUFFER, order);
+    return primary;
+}
+
+// Returns the start of every rotation of the block, in sorted order
+static uint32_t *sortRotations(const unsigned char *block, uint32_t n) {
+    uint32_t *order = AllocMalloc(ALLOC_BUFFER, n * sizeof(uint32_t));
+    uint32_t *rank = AllocMalloc(ALLOC_BUFFER, n * sizeof(uint32_t));
+    uint32_t *newRank = AllocMalloc(ALLOC_BUFFER, n * sizeof(uint32_t));
+    uint32_t *byNext = AllocMalloc(ALLOC_BUFFER, n * sizeof(uint32_t));
+    uint32_t *count = AllocMalloc(ALLOC_BUFFER, (n > 256 ? n : 256) * sizeof(uint32_t));
+
+    // Order and rank by the first byte
+    memset(count, 0, 256 * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) {
+        count[block[i]]++;
+    }
+    for (int c = 1; c < 256; c++) {
+        count[c] += count[c - 1];
+    }
+    for (uint32_t i = n; i-- > 0; ) {
+        order[--count[block[i]]] = i;
+    }
+    uint32_t numRanks = 1;
+    rank[order[0]] = 0;
+    for (uint32_t i = 1; i < n; i++) {
+        numRanks += block[order[i]] != block[order[i - 1]];
+        rank[order[i]] = numRanks - 1;
+    }
+
+    for (uint32_t h = 1; h < n && numRanks < n; h *= 2) {
+        // The rotations h before those in order are in order of their
+        // second h bytes
+        for (uint32_t i = 0; i < n; i++) {
+            byNext[i] = order[i] >= h ? order[i] - h : order[i] + n - h;
+        }
+        memset(count, 0, numRanks * sizeof(uint32_t));
+        for (uint32_t i = 0; i < n; i++) {
+            count[rank[byNext[i]]]++;
+        }
+        for (uint32_t c = 1; c < numRanks; c++) {
+            count[c] += count[c - 1];
+        }
+        for (uint32_t i = n; i-- > 0; ) {
+            order[--count[rank[byNext[i]]]] = byNext[i];
+        }
+
+        numRanks = 1;
+        newRank[order[0]] = 0;
+        for (uint32_t i = 1; i < n; i++) {
+            uint32_t a = order[i];
+            uint32_t b = order[i - 1];
+            uint32_t aNext = a + h < n ? a + h : a + h - n;
+            uint32_t bNext = b + h < n ? b + h : b + h - n;
+            numRanks += rank[a] != rank[b] || rank[aNext] != rank[bNext];
+            newRank[a] = numRanks - 1;
+        }
+        uint32_t *swap = rank;
+        rank = newRank;
+        newRank = swap;
+    }
+
+    AllocFree(ALLOC_BUFFER, rank);
+    AllocFree(ALLOC_BUFFER, newRank);
+    AllocFree(ALLOC_BUFFER, byNext);
+    AllocFree(ALLOC_BUFFER, count);
+    return order;
+}
+
+// Moves each byte to the front of a list of all bytes and writes its
+// position there, with runs of zeros written as run symbols. Appends one
+// character per symbol and returns the number of symbols.
+static uint32_t mtfRle(const unsigned char *last, uint32_t n, struct byteBuffer *out) {
+    unsigned char list[256];
+    for (int i = 0; i < 256; i++) {
+        list[i] = i;
+    }
+    uint32_t numSymbols = 0;
+    uint32_t run = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        unsigned char b = last[i];
+        if (list[0] == b) {
+            run++;
+            continue;
+        }
+        numSymbols += putRun(out, run);
+        run = 0;
+        int j = 1;
+        while (list[j] != b) {
+            j++;
+        }
+        memmove(&list[1], list, j);
+        list[0] = b;
+        putSymbol(out, j + 1);
+        numSymbols++;
+    }
+    return numSymbols + putRun(out, run);
+}
+
+// Writes a run length in bijective base 2, least significant digit first,
+// where RUN_A is the digit 1 and RUN_B the digit 2
+static uint32_t putRun(struct byteBuffer *out, uint32_t run) {
+    if (run == 0) {
+        return 0;
+    }
+    uint32_t numSymbols = 1;
+    run--;
+    putSymbol(out, run & 1 ? RUN_B : RUN_A);
+    while (run >= 2) {
+        run = (run - 2) / 2;
+        putSymbol(out, run & 1 ? RUN_B : RUN_A);
+        numSymbols++;
+    }
+    return numSymbols;
+}
+
+// Appends the two byte UTF-8 character U+0100 + symbol
+static void putSymbol(struct byteBuffer *out, int symbol) {
+    int cp = SYMBOL_BASE + symbol;
+    unsigned char bytes[2] = {0xC0 | cp >> 6, 0x80 | (cp & 0x3F)};
+    ByteBufferPut(out, bytes, 2);
+}
+
+// Decodes every block of the block encoding of the symbols
+static char *decodeSymbols(const unsigned char *data, size_t len, size_t *symbolsLen) {
+    BlockFile bf = BlockFileOpen(data, len);
+    if (bf == NULL) {
+        return NULL;
+    }
+    *symbolsLen = BlockFileDecodedSize(bf);
+    char *symbols = AllocMalloc(ALLOC_BUFFER, *symbolsLen);
+    StatsBegin(STATS_DECODE);
+    bool ok = true;
+    for (size_t i = 0; ok && i < BlockFileNumBlocks(bf); i++) {
+        ok = BlockFileDecodeBlock(bf, i, &symbols[BlockFileBlockStart(bf, i)]);
+    }
+    StatsEnd(STATS_DECODE);
+    BlockFileFree(bf);
+    if (!ok) {
+        AllocFree(ALLOC_BUFFER, symbols);
+        return NULL;
+    }
+    return symbols;
+}
+
+// Reads numSymbols symbols from *pos and undoes mtfRle into the n bytes of
+// last. Returns false if a symbol is malformed or they make more or fewer
+// than n bytes.
+static bool unMtfRle(const unsigned char *symbols, size_t len, size_t *pos,
+                     uint32_t numSymbols, unsigned char *last, uint32_t n) {
+    unsigned char list[256];
+    for (int i = 0; i < 256; i++) {
+        list[i] = i;
+    }
+    uint32_t i = 0;
+    uint64_t run = 0;
+    uint64_t digit = 1;
+    for (uint32_t k = 0; k <= numSymbols; k++) {
+        int s = k < numSymbols ? getSymbol(symbols, len, pos) : MAX_SYMBOL + 1;
+        if (s < 0) {
+            return false;
+        }
+        if (s == RUN_A || s == RUN_B) {
+            if (digit > n) {
+                return false;
+            }
+            run += (s == RUN_A ? 1 : 2) * digit;
+            digit *= 2;
+            continue;
+        }
+
+        // Any other symbol ends the run
+        if (run > n - i) {
+            return false;
+        }
+        memset(&last[i], list[0], run);
+        i += run;
+        run = 0;
+        digit = 1;
+        if (s > MAX_SYMBOL) {
+            break;
+        }
+        int j = s - 1;
+        unsigned char b = list[j];
+        memmove(&list[1], list, j);
+        list[0] = b;
+        if (i == n) {
+            return false;
+        }
+        last[i++] = b;
+    }
+    return i == n;
+}
+
+// Reads the symbol of the character at *pos, or returns -1 if it is not
+// the character of a symbol
+static int getSymbol(const unsigned char *symbols, size_t len, size_t *pos) {
+    if (len - *pos < 2) {
+        return -1;
+    }
+    unsigned char b0 = symbols[*pos];
+    unsigned char b1 = symbols[*pos + 1];
+    *pos += 2;
+    int s = ((b0 & 0x1F) << 6 | (b1 & 0x3F)) - SYMBOL_BASE;
+    if ((b0 & 0xE0) != 0xC0 || (b1 & 0xC0) != 0x80 || s < 0 || s > MAX_SYMBOL) {
+        return -1;
+    }
+    return s;
+}
+
+// Undoes the transform by following each byte back to the rotation that
+// starts with it, from the block itself back through to its first byte
+static void unbwt(const unsigned char *last, uint32_t n, uint32_t primary, unsigned char *out) {
+    uint32_t start[256] = {0};
+    for (uint32_t i = 0; i < n; i++) {
+        start[last[i]]++;
+    }
+    uint32_t sum = 0;
+    for (int c = 0; c < 256; c++) {
+        uint32_t count = start[c];
+        start[c] = sum;
+        sum += count;
+    }
+    uint32_t *prev = AllocMalloc(ALLOC_BUFFER, n * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) {
+        prev[i] = start[last[i]]++;
+    }
+    uint32_t row = primary;
+    for (uint32_t k = n; k-- > 0; ) {
+        out[k] = last[row];
+        row = prev[row];
+    }
+    AllocFree(ALLOC_BUFFER, prev);
+}
@@ -0,0 +1,48 @@
+// Interface to the BwtCoder module, which transforms the text before coding
+// it so that huffman codes have much less to code
+//
+// The text is cut into blocks, and each block goes through three stages:
+//   1. The Burrows-Wheeler transform sorts the rotations of the block and
+//      keeps the byte before each, which groups bytes that are followed by
+//      the same context, so runs of a few distinct bytes appear.
+//   2. Move-to-front replaces each byte by its position in a list of recent
+//      bytes, which turns those runs into small numbers, mostly zeros.
+//   3. Runs of zeros are written as their length in bijective base 2 with
+//      two run symbols, and every other position as position + 1.
+// Each of the 257 resulting symbols is written as the UTF-8 character
+// U+0100 + symbol, so the symbols can be counted and coded as characters by
+// the block coder (see BlockCoder.h), which fits trees to them.
+//
+// Layout (integers little-endian):
+//   "HUFX", u32 version, u32 numBlocks, u64 original size
+//   per block: u32 size, u32 primary index, u32 number of symbols
+//   the block encoding of all the symbols
+//
+// The primary index is the rank of the block itself among its rotations,
+// which is where the inverse transform starts.
+
+#ifndef BWT_CODER_H
+#define BWT_CODER_H
+
+#include <stddef.h>
+
+// Blocks are sorted in memory, at about 20 bytes per byte of the block
+#define BWT_MAX_BLOCK_SIZE (64 << 20)
+
+/**
+ * Transforms and encodes len bytes of text in blocks of blockSize bytes
+ * (at most BWT_MAX_BLOCK_SIZE). Returns the encoding and sets *outLen to
+ * its length in bytes. The encoding must be freed with
+ * AllocFree(ALLOC_BUFFER, ...)
+ */
+unsigned char *BwtEncode(const char *text, size_t len, size_t blockSize, size_t *outLen);
+
+/**
+ * Decodes an encoding made by BwtEncode and undoes the transform
+ * Returns the text and sets *textLen to its length, or returns NULL if data
+ * is not a complete, well-formed encoding. The text must be freed with
+ * AllocFree(ALLOC_BUFFER, ...)
+ */
+char *BwtDecode(const unsigned char *data, size_t len, size_t *textLen);
+
+#endif
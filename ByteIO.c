@@ -0,0 +1,89 @@
+// Implementation of the ByteIO module
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "ByteIO.h"
+
+void ByteBufferPut(struct byteBuffer *b, const void *bytes, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    if (b->len + n > b->cap) {
+        b->cap = b->cap > 0 ? b->cap : 4096;
+        while (b->len + n > b->cap) {
+            b->cap *= 2;
+        }
+        b->data = AllocRealloc(ALLOC_BUFFER, b->data, b->cap);
+    }
+    if (bytes != NULL) {
+        memcpy(&b->data[b->len], bytes, n);
+    }
+    b->len += n;
+}
+
+void ByteBufferPutU8(struct byteBuffer *b, uint8_t v) {
+    ByteBufferPut(b, &v, 1);
+}
+
+void ByteBufferPutU16(struct byteBuffer *b, uint16_t v) {
+    unsigned char bytes[2] = {v, v >> 8};
+    ByteBufferPut(b, bytes, 2);
+}
+
+void ByteBufferPutU32(struct byteBuffer *b, uint32_t v) {
+    unsigned char bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = v >> (8 * i);
+    }
+    ByteBufferPut(b, bytes, 4);
+}
+
+void ByteBufferPutU64(struct byteBuffer *b, uint64_t v) {
+    ByteBufferPutU32(b, (uint32_t)v);
+    ByteBufferPutU32(b, (uint32_t)(v >> 32));
+}
+
+bool ByteReaderGet(struct byteReader *r, void *bytes, size_t n) {
+    if (n > r->left) {
+        return false;
+    }
+    memcpy(bytes, r->p, n);
+    r->p += n;
+    r->left -= n;
+    return true;
+}
+
+bool ByteReaderGetU16(struct byteReader *r, uint16_t *v) {
+    unsigned char bytes[2];
+    if (!ByteReaderGet(r, bytes, 2)) {
+        return false;
+    }
+    *v = bytes[0] | bytes[1] << 8;
+    return true;
+}
+
+bool ByteReaderGetU32(struct byteReader *r, uint32_t *v) {
+    unsigned char bytes[4];
+    if (!ByteReaderGet(r, bytes, 4)) {
+        return false;
+    }
+    *v = 0;
+    for (int i = 3; i >= 0; i--) {
+        *v = (*v << 8) | bytes[i];
+    }
+    return true;
+}
+
+bool ByteReaderGetU64(struct byteReader *r, uint64_t *v) {
+    uint32_t low;
+    uint32_t high;
+    if (!ByteReaderGetU32(r, &low) || !ByteReaderGetU32(r, &high)) {
+        return false;
+    }
+    *v = ((uint64_t)high << 32) | low;
+    return true;
+}
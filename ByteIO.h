@@ -0,0 +1,47 @@
+// Interface to the ByteIO module for building and parsing the headers of
+// the binary formats
+// Integers are stored little endian
+
+#ifndef BYTEIO_H
+#define BYTEIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A growing byte string. Start with {NULL, 0, 0} and free data with
+// AllocFree(ALLOC_BUFFER, ...)
+struct byteBuffer {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+};
+
+// The unread part of a byte string. Start with {data, len}
+struct byteReader {
+    const unsigned char *p;
+    size_t left;
+};
+
+/**
+ * Appends n bytes, or makes room for them and skips over them if bytes is
+ * NULL, so that the caller can fill them in later through data
+ */
+void ByteBufferPut(struct byteBuffer *b, const void *bytes, size_t n);
+
+void ByteBufferPutU8(struct byteBuffer *b, uint8_t v);
+void ByteBufferPutU16(struct byteBuffer *b, uint16_t v);
+void ByteBufferPutU32(struct byteBuffer *b, uint32_t v);
+void ByteBufferPutU64(struct byteBuffer *b, uint64_t v);
+
+/**
+ * Reads n bytes into bytes
+ * Returns false, reading nothing, if fewer than n bytes are left
+ */
+bool ByteReaderGet(struct byteReader *r, void *bytes, size_t n);
+
+bool ByteReaderGetU16(struct byteReader *r, uint16_t *v);
+bool ByteReaderGetU32(struct byteReader *r, uint32_t *v);
+bool ByteReaderGetU64(struct byteReader *r, uint64_t *v);
+
+#endif
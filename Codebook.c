@@ -0,0 +1,294 @@
+// Implementation of the Codebook ADT
+// Tokens are stored in an open addressing hash table keyed by the token bytes
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "Alloc.h"
+#include "Codebook.h"
+#include "Stats.h"
+#include "huffman.h"
+
+// Structs definition
+struct entry {
+    char *token;    // NULL if the slot is empty
+    int tokenLen;
+    char *code;
+};
+
+struct codebook {
+    struct entry *table;
+    int capacity;   // always a power of two
+    int numItems;
+};
+
+struct frame {
+    struct huffmanTree *node;
+    int depth;
+    char bit;   // branch taken from the parent to reach this node
+};
+
+// The shortest line CodebookWrite can write: "1  x\n", a one byte token
+// with the empty code that lone leaves once had
+#define MIN_ITEM_LINE_LEN 5
+
+// Helper functions
+static Codebook newCodebook(int numItems, void *(*alloc)(AllocSubsystem, size_t));
+static uint32_t hashToken(char *token, int tokenLen);
+static int countLeaves(struct huffmanTree *tree);
+static void insertCode(Codebook cb, char *token, int tokenLen, char *path, int depth);
+
+// Returns a new codebook for the given tree
+Codebook CodebookNew(struct huffmanTree *tree) {
+    StatsBegin(STATS_CODEBOOK);
+    int numLeaves = countLeaves(tree);
+    Codebook cb = newCodebook(numLeaves, AllocMalloc);
+    if (tree == NULL) {
+        StatsEnd(STATS_CODEBOOK);
+        return cb;
+    }
+
+    // Walk the tree with an explicit stack so deep trees cannot overflow
+    struct frame *stack = AllocMalloc(ALLOC_CODE, (numLeaves * 2) * sizeof(struct frame));
+    char *path = AllocMalloc(ALLOC_CODE, numLeaves + 1);
+    int top = 0;
+    stack[top++] = (struct frame){tree, 0, '\0'};
+    while (top > 0) {
+        struct frame f = stack[--top];
+        if (f.depth > 0) {
+            path[f.depth - 1] = f.bit;
+        }
+        if (f.node->left == NULL && f.node->right == NULL) {
+            // A lone leaf still gets a 1 bit code, as in HuffmanCodec, so
+            // the encoding keeps the number of tokens
+            if (f.depth == 0) {
+                path[f.depth++] = '0';
+            }
+            insertCode(cb, f.node->token, strlen(f.node->token), path, f.depth);
+            StatsMax(STATS_TREE_DEPTH, f.depth);
+            continue;
+        }
+        // Push the right child first so the left subtree is visited first
+        if (f.node->right != NULL) {
+            stack[top++] = (struct frame){f.node->right, f.depth + 1, '1'};
+        }
+        if (f.node->left != NULL) {
+            stack[top++] = (struct frame){f.node->left, f.depth + 1, '0'};
+        }
+    }
+
+    AllocFree(ALLOC_CODE, path);
+    AllocFree(ALLOC_CODE, stack);
+    StatsMax(STATS_TREE_LEAVES, numLeaves);
+    StatsEnd(STATS_CODEBOOK);
+    return cb;
+}
+
+// Frees all memory allocated to the codebook
+void CodebookFree(Codebook cb) {
+    if (cb == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < cb->capacity; i++) {
+        AllocFree(ALLOC_CODE, cb->table[i].token);
+        AllocFree(ALLOC_CODE, cb->table[i].code);
+    }
+    AllocFree(ALLOC_CODE, cb->table);
+    AllocFree(ALLOC_CODE, cb);
+}
+
+// Returns the code of the given token, or NULL if it is not in the codebook
+char *CodebookGet(Codebook cb, char *token, int tokenLen) {
+    uint32_t mask = cb->capacity - 1;
+    for (uint32_t i = hashToken(token, tokenLen) & mask; ; i = (i + 1) & mask) {
+        struct entry *e = &cb->table[i];
+        if (e->token == NULL) {
+            return NULL;
+        }
+        if (e->tokenLen == tokenLen && memcmp(e->token, token, tokenLen) == 0) {
+            return e->code;
+        }
+    }
+}
+
+// Returns the number of distinct tokens in the codebook
+int CodebookNumItems(Codebook cb) {
+    return cb->numItems;
+}
+
+// Writes the number of tokens, then one "<token length> <code> <token>" line per token
+void CodebookWrite(Codebook cb, FILE *fp) {
+    fprintf(fp, "%d\n", cb->numItems);
+    for (int i = 0; i < cb->capacity; i++) {
+        struct entry *e = &cb->table[i];
+        if (e->token != NULL) {
+            fprintf(fp, "%d %s ", e->tokenLen, e->code);
+            fwrite(e->token, 1, e->tokenLen, fp);
+            fputc('\n', fp);
+        }
+    }
+}
+
+// Reads a codebook written by CodebookWrite
+Codebook CodebookRead(FILE *fp) {
+    int numItems;
+    if (fscanf(fp, "%d", &numItems) != 1 || numItems < 0) {
+        return NULL;
+    }
+
+    // The count is only trusted as far as the rest of the file could hold
+    // that many lines, and running out of memory for the table is treated
+    // like any other bad codebook
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0 || ftello(fp) < 0 ||
+            numItems > (st.st_size - ftello(fp)) / MIN_ITEM_LINE_LEN) {
+        return NULL;
+    }
+    Codebook cb = newCodebook(numItems, AllocTryMalloc);
+    if (cb == NULL) {
+        return NULL;
+    }
+
+    // No code can be longer than the number of tokens
+    char *code = AllocTryMalloc(ALLOC_CODE, (size_t)numItems + 2);
+    if (code == NULL) {
+        CodebookFree(cb);
+        return NULL;
+    }
+    char *buffer = NULL;
+    int bufferSize = 0;
+    for (int i = 0; i < numItems; i++) {
+        int tokenLen;
+        if (fscanf(fp, "%d", &tokenLen) != 1 || tokenLen <= 0 || fgetc(fp) != ' ') {
+            break;
+        }
+        int codeLen = 0;
+        int ch;
+        while ((ch = fgetc(fp)) == '0' || ch == '1') {
+            if (codeLen > numItems) {
+                break;
+            }
+            code[codeLen++] = ch;
+        }
+        if (ch != ' ') {
+            break;
+        }
+        if (tokenLen > bufferSize) {
+            bufferSize = tokenLen;
+            buffer = AllocRealloc(ALLOC_CODE, buffer, bufferSize);
+        }
+        if (fread(buffer, 1, tokenLen, fp) != (size_t)tokenLen || fgetc(fp) != '\n') {
+            break;
+        }
+        insertCode(cb, buffer, tokenLen, code, codeLen);
+    }
+
+    AllocFree(ALLOC_CODE, buffer);
+    AllocFree(ALLOC_CODE, code);
+    if (cb->numItems != numItems) {
+        CodebookFree(cb);
+        return NULL;
+    }
+    return cb;
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Returns an empty codebook with room for numItems tokens, allocated with
+// AllocMalloc or AllocTryMalloc
+// Returns NULL if alloc fails or the table would be too large
+static Codebook newCodebook(int numItems, void *(*alloc)(AllocSubsystem, size_t)) {
+    // Keep the table at most half full
+    size_t capacity = 16;
+    while (capacity < (size_t)numItems * 2) {
+        capacity *= 2;
+    }
+    if (capacity > INT_MAX) {
+        return NULL;
+    }
+
+    Codebook cb = alloc(ALLOC_CODE, sizeof(struct codebook));
+    if (cb == NULL) {
+        return NULL;
+    }
+    cb->table = alloc(ALLOC_CODE, capacity * sizeof(struct entry));
+    if (cb->table == NULL) {
+        AllocFree(ALLOC_CODE, cb);
+        return NULL;
+    }
+    memset(cb->table, 0, capacity * sizeof(struct entry));
+    cb->capacity = capacity;
+    cb->numItems = 0;
+    return cb;
+}
+
+// FNV-1a hash of the token bytes
+static uint32_t hashToken(char *token, int tokenLen) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < tokenLen; i++) {
+        hash ^= (unsigned char)token[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Counts the leaves of the tree without recursion
+static int countLeaves(struct huffmanTree *tree) {
+    if (tree == NULL) {
+        return 0;
+    }
+
+    int numLeaves = 0;
+    int capacity = 64;
+    int top = 0;
+    struct huffmanTree **stack = AllocMalloc(ALLOC_CODE, capacity * sizeof(struct huffmanTree *));
+    stack[top++] = tree;
+    while (top > 0) {
+        struct huffmanTree *node = stack[--top];
+        if (node->left == NULL && node->right == NULL) {
+            numLeaves++;
+            continue;
+        }
+        if (top + 2 > capacity) {
+            capacity *= 2;
+            stack = AllocRealloc(ALLOC_CODE, stack, capacity * sizeof(struct huffmanTree *));
+        }
+        if (node->right != NULL) {
+            stack[top++] = node->right;
+        }
+        if (node->left != NULL) {
+            stack[top++] = node->left;
+        }
+    }
+    AllocFree(ALLOC_CODE, stack);
+    return numLeaves;
+}
+
+// Inserts a copy of the token and its code into the table
+static void insertCode(Codebook cb, char *token, int tokenLen, char *path, int depth) {
+    uint32_t mask = cb->capacity - 1;
+    uint32_t i = hashToken(token, tokenLen) & mask;
+    while (cb->table[i].token != NULL) {
+        // Duplicate leaves keep their first (leftmost) code
+        if (cb->table[i].tokenLen == tokenLen && memcmp(cb->table[i].token, token, tokenLen) == 0) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+
+    struct entry *e = &cb->table[i];
+    e->token = AllocMalloc(ALLOC_CODE, tokenLen + 1);
+    memcpy(e->token, token, tokenLen);
+    e->token[tokenLen] = '\0';
+    e->tokenLen = tokenLen;
+    e->code = AllocMalloc(ALLOC_CODE, depth + 1);
+    memcpy(e->code, path, depth);
+    e->code[depth] = '\0';
+    cb->numItems++;
+}
@@ -0,0 +1,48 @@
+// Interface to a Codebook ADT that maps each token of a huffman tree to its
+// code, so that encoding does not have to search the tree for every token
+
+#ifndef CODEBOOK_H
+#define CODEBOOK_H
+
+#include <stdio.h>
+
+#include "huffman.h"
+
+typedef struct codebook *Codebook;
+
+/**
+ * Returns a new codebook containing the code of every leaf in the tree
+ * The codebook must be freed with CodebookFree
+ */
+Codebook CodebookNew(struct huffmanTree *tree);
+
+/**
+ * Frees all memory allocated to the codebook
+ */
+void CodebookFree(Codebook cb);
+
+/**
+ * Returns the code ('0'/'1' string) of the first tokenLen bytes of token,
+ * or NULL if that token is not in the codebook. The returned string is owned
+ * by the codebook.
+ */
+char *CodebookGet(Codebook cb, char *token, int tokenLen);
+
+/**
+ * Returns the number of distinct tokens in the codebook
+ */
+int CodebookNumItems(Codebook cb);
+
+/**
+ * Writes the codebook to the stream so that CodebookRead can restore it
+ * without the tree
+ */
+void CodebookWrite(Codebook cb, FILE *fp);
+
+/**
+ * Reads a codebook written by CodebookWrite
+ * Returns NULL if the stream does not contain a valid codebook
+ */
+Codebook CodebookRead(FILE *fp);
+
+#endif
@@ -1,5 +1,5 @@
 // Implementation of the Counter ADT
-// COMPLETE (memory leakage occuring)
+// COMPLETE
 
 #include <assert.h>
 #include <stdbool.h>
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "Alloc.h"
 #include "Counter.h"
 #include "huffman.h"
 
@@ -17,15 +18,15 @@ struct counter {
 
 // Helper functions
 struct huffmanTree *huffmanTreeNew(char *token);
-struct huffmanTree *inserthuffmanTree(struct huffmanTree *root, char *token);
+struct huffmanTree *inserthuffmanTree(struct huffmanTree *root, char *token, int64_t count);
 void freeHuffmanTree(struct huffmanTree *root);
 int countDistinctTokens(struct huffmanTree *root);
-int findTokenFrequency(struct huffmanTree *root, const char *token);
+int64_t findTokenFrequency(struct huffmanTree *root, const char *token);
 void collectItems(struct huffmanTree *root, struct item **items, int *index);
 
 // Returns a new empty counter with no tokens
 Counter CounterNew(void) {
-    Counter newCounter = (Counter)malloc(sizeof(struct counter));
+    Counter newCounter = AllocMalloc(ALLOC_COUNTER, sizeof(struct counter));
     newCounter->root = NULL;
     return newCounter;
 }
@@ -38,7 +39,7 @@ void CounterFree(Counter c) {
 
     freeHuffmanTree(c->root);
     c->root = NULL;
-    free(c);
+    AllocFree(ALLOC_COUNTER, c);
 }
 
 // Adds an occurrence of the given token to the counter
@@ -56,7 +57,16 @@ void CounterAdd(Counter c, char *token) {
     }
 
     // Otherwise, insert token into tree
-	inserthuffmanTree(c->root, token);
+	inserthuffmanTree(c->root, token, 1);
+}
+
+// Adds count occurrences of the given token to the counter
+void CounterAddCount(Counter c, char *token, int64_t count) {
+    if (c == NULL || token == NULL || count <= 0) {
+        return;
+    }
+
+    c->root = inserthuffmanTree(c->root, token, count);
 }
 
 // Returns the number of distinct tokens added to the counter
@@ -70,7 +80,7 @@ int CounterNumItems(Counter c) {
 } 
 
 // Returns the frequency of the given token
-int CounterGet(Counter c, char *token) {
+int64_t CounterGet(Counter c, char *token) {
     if (c == NULL || c->root == NULL || token == NULL) {
         return 0;
     }
@@ -88,56 +98,58 @@ struct item *CounterItems(Counter c, int *numItems) {
 
     // Collect items
     *numItems = CounterNumItems(c);
-    struct item *items = (struct item *)malloc(sizeof(struct item) * (*numItems));
+    struct item *items = AllocMalloc(ALLOC_COUNTER, sizeof(struct item) * (*numItems));
     int index = 0;
     collectItems(c->root, &items, &index);
 
     // Duplicate items
-    struct item *resultItems = (struct item *)malloc(sizeof(struct item) * (*numItems));
+    struct item *resultItems = AllocMalloc(ALLOC_COUNTER, sizeof(struct item) * (*numItems));
     for (int i = 0; i < *numItems; i++) {
-        resultItems[i].token = strdup(items[i].token);
+        resultItems[i].token = AllocStrdup(ALLOC_COUNTER, items[i].token);
         resultItems[i].freq = items[i].freq;
     }
 
     // Free the original items array and return the duplicated items
-    free(items);
+    AllocFree(ALLOC_COUNTER, items);
     return resultItems;
 }
 
+// Frees an array returned by CounterItems and the tokens in it
+void CounterFreeItems(struct item *items, int numItems) {
+    for (int i = 0; i < numItems; i++) {
+        AllocFree(ALLOC_COUNTER, items[i].token);
+    }
+    AllocFree(ALLOC_COUNTER, items);
+}
+
 // -------------------------------------------- Helper Functions --------------------------------------------
 
 // Creates a new huffman tree node
 struct huffmanTree *huffmanTreeNew(char *token) {
     // Allocate memory for new node
-    struct huffmanTree *newNode = (struct huffmanTree *)malloc(sizeof(struct huffmanTree));
-    if (newNode) {
-        newNode->token = (char *)malloc(strlen(token) + 1);
-        if (newNode->token) {
-            strncpy(newNode->token, token, strlen(token) + 1);
-            newNode->freq = 1;
-            newNode->left = newNode->right = NULL;
-        } else {
-            free(newNode);
-            newNode = NULL;
-        }
-    }
+    struct huffmanTree *newNode = AllocMalloc(ALLOC_COUNTER, sizeof(struct huffmanTree));
+    newNode->token = AllocStrdup(ALLOC_COUNTER, token);
+    newNode->freq = 1;
+    newNode->left = newNode->right = NULL;
     return newNode;
 }
 
 // Inserts a huffman tree node into the tree
-struct huffmanTree *inserthuffmanTree(struct huffmanTree *root, char *token) {
+struct huffmanTree *inserthuffmanTree(struct huffmanTree *root, char *token, int64_t count) {
     // If tree is empty, insert huffman tree node at root
     if (root == NULL) {
-        return huffmanTreeNew(token);
+        struct huffmanTree *newNode = huffmanTreeNew(token);
+        newNode->freq = count;
+        return newNode;
     }
     // Compare token to root token
     int cmp = strcmp(token, root->token);
-    if (cmp == 0) { // Token already exists, increment frequency
-        root->freq++;
+    if (cmp == 0) { // Token already exists, increase frequency
+        root->freq += count;
     } else if (cmp < 0) { // Token is smaller, go to left subtree
-        root->left = inserthuffmanTree(root->left, token);
+        root->left = inserthuffmanTree(root->left, token, count);
     } else { // Token is larger, go to right subtree
-        root->right = inserthuffmanTree(root->right, token);
+        root->right = inserthuffmanTree(root->right, token, count);
     }
     return root;
 }
@@ -151,8 +163,8 @@ void freeHuffmanTree(struct huffmanTree *root) {
     freeHuffmanTree(root->left);
     freeHuffmanTree(root->right);
 
-    free(root->token);
-    free(root);
+    AllocFree(ALLOC_COUNTER, root->token);
+    AllocFree(ALLOC_COUNTER, root);
 }
 
 // Counts the number of distinct tokens in the counter
@@ -170,7 +182,7 @@ int countDistinctTokens(struct huffmanTree *root) {
 }
 
 // Finds the frequency of a given token in the counter
-int findTokenFrequency(struct huffmanTree *root, const char *token) {
+int64_t findTokenFrequency(struct huffmanTree *root, const char *token) {
     // Base case
     if (root == NULL) {
         return 0;
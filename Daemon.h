@@ -0,0 +1,73 @@
+// Interface to the Daemon module: the wire protocol spoken over the Unix
+// domain socket of huffmand, and the client side of it
+//
+// A client sends any number of requests on one connection, each answered in
+// order. Both sides run on the same host, so integers are sent in host byte
+// order. Encodings travel as packed bits (see HuffmanCodec.h).
+//
+//   request:  magic "HD", op ('E' or 'D'), 1 reserved byte,
+//             uint32 tree path length, uint64 payload bytes,
+//             uint64 payload bits (decode only), tree path, payload
+//   response: uint32 status (0 on success), uint32 reserved,
+//             uint64 payload bytes, uint64 payload bits (encode only),
+//             payload (or an error message if status is not 0)
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DAEMON_OP_ENCODE 'E'
+#define DAEMON_OP_DECODE 'D'
+
+// Requests larger than this are refused
+#define DAEMON_MAX_PAYLOAD (UINT64_C(1) << 32)
+
+struct daemonRequest {
+    char magic[2];
+    char op;
+    char reserved;
+    uint32_t pathLen;
+    uint64_t numBytes;
+    uint64_t numBits;
+};
+
+struct daemonResponse {
+    uint32_t status;
+    uint32_t reserved;
+    uint64_t numBytes;
+    uint64_t numBits;
+};
+
+/**
+ * Connects to the daemon listening on the socket path
+ * Returns the connected socket, or -1 on failure
+ */
+int DaemonConnect(char *socketPath);
+
+/**
+ * Asks the daemon to encode inLen bytes with the tree at treePath
+ * On success, returns true and sets *out, its size in bytes and its size
+ * in bits. out must be freed with AllocFree(ALLOC_BUFFER, ...)
+ */
+bool DaemonEncode(int fd, char *treePath, char *in, size_t inLen,
+                  unsigned char **out, size_t *outLen, uint64_t *numBits);
+
+/**
+ * Asks the daemon to decode numBits bits with the tree at treePath
+ * On success, returns true and sets *out and its size in bytes
+ * out must be freed with AllocFree(ALLOC_BUFFER, ...)
+ */
+bool DaemonDecode(int fd, char *treePath, unsigned char *in, uint64_t numBits,
+                  char **out, size_t *outLen);
+
+/**
+ * Reads or writes exactly len bytes on the socket, retrying short transfers
+ * Returns false if the connection closed or failed
+ */
+bool DaemonReadAll(int fd, void *buffer, size_t len);
+bool DaemonWriteAll(int fd, const void *buffer, size_t len);
+
+#endif
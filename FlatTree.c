@@ -0,0 +1,325 @@
+// Implementation of the FlatTree ADT
+// Nodes are numbered in pre-order, so the root is node 0 and every child has
+// a higher index than its parent
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Alloc.h"
+#include "File.h"
+#include "FlatTree.h"
+#include "Stats.h"
+#include "Tokenizer.h"
+#include "huffman.h"
+
+static const char MAGIC[4] = {'H', 'U', 'F', 'D'};
+
+// Bumped whenever the layout after the header changes
+#define FLAT_TREE_VERSION 1
+
+#define FNV_OFFSET 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+// Structs definition
+struct flatTree {
+    int32_t numNodes;
+    int32_t tokenBytes;
+    int32_t *left;          // -1 for leaves
+    int32_t *right;         // -1 for leaves
+    int32_t *tokenStart;    // offset of the leaf's token in tokens, -1 for internal nodes
+    char *tokens;           // null-terminated tokens, back to back
+    void *map;              // the mapped file the arrays point into, or NULL
+    size_t mapSize;
+};
+
+// The start of every written flat tree; 24 bytes, so the arrays that follow
+// stay 4 byte aligned
+struct header {
+    char magic[4];
+    uint32_t version;
+    int32_t numNodes;
+    int32_t tokenBytes;
+    uint64_t checksum;      // FNV-1a of everything after the header
+};
+
+struct frame {
+    struct huffmanTree *node;
+    int32_t parent;
+    bool isRight;
+};
+
+// Helper functions
+static FlatTree newFlatTree(int32_t numNodes, int32_t tokenBytes);
+static bool isValidHeader(struct header *h);
+static size_t bodySize(struct header *h);
+static uint64_t checksum(FlatTree ft);
+static uint64_t hashBytes(uint64_t hash, const void *bytes, size_t len);
+static bool isValid(FlatTree ft);
+
+// Returns a flat copy of the tree
+FlatTree FlatTreeNew(struct huffmanTree *tree) {
+    // Count the nodes and token bytes without recursion
+    int32_t numNodes = 0;
+    int32_t tokenBytes = 0;
+    int capacity = 64;
+    struct frame *stack = AllocMalloc(ALLOC_CODE, capacity * sizeof(struct frame));
+    int top = 0;
+    if (tree != NULL) {
+        stack[top++] = (struct frame){tree, -1, false};
+    }
+    while (top > 0) {
+        struct huffmanTree *node = stack[--top].node;
+        numNodes++;
+        if (node->left == NULL && node->right == NULL) {
+            tokenBytes += strlen(node->token) + 1;
+            continue;
+        }
+        if (top + 2 > capacity) {
+            capacity *= 2;
+            stack = AllocRealloc(ALLOC_CODE, stack, capacity * sizeof(struct frame));
+        }
+        stack[top++] = (struct frame){node->right, -1, true};
+        stack[top++] = (struct frame){node->left, -1, false};
+    }
+
+    // Number the nodes in pre-order, linking each to its parent
+    FlatTree ft = newFlatTree(numNodes, tokenBytes);
+    int32_t index = 0;
+    int32_t tokenPos = 0;
+    if (tree != NULL) {
+        stack[top++] = (struct frame){tree, -1, false};
+    }
+    while (top > 0) {
+        struct frame f = stack[--top];
+        int32_t i = index++;
+        if (f.parent >= 0) {
+            if (f.isRight) {
+                ft->right[f.parent] = i;
+            } else {
+                ft->left[f.parent] = i;
+            }
+        }
+
+        ft->left[i] = ft->right[i] = -1;
+        ft->tokenStart[i] = -1;
+        if (f.node->left == NULL && f.node->right == NULL) {
+            int len = strlen(f.node->token);
+            memcpy(ft->tokens + tokenPos, f.node->token, len + 1);
+            ft->tokenStart[i] = tokenPos;
+            tokenPos += len + 1;
+            continue;
+        }
+        stack[top++] = (struct frame){f.node->right, i, true};
+        stack[top++] = (struct frame){f.node->left, i, false};
+    }
+
+    AllocFree(ALLOC_CODE, stack);
+    return ft;
+}
+
+// Frees the flat tree, unmapping it if it was mapped
+void FlatTreeFree(FlatTree ft) {
+    if (ft == NULL) {
+        return;
+    }
+    if (ft->map != NULL) {
+        munmap(ft->map, ft->mapSize);
+    } else {
+        AllocFree(ALLOC_CODE, ft->left);
+        AllocFree(ALLOC_CODE, ft->right);
+        AllocFree(ALLOC_CODE, ft->tokenStart);
+        AllocFree(ALLOC_CODE, ft->tokens);
+    }
+    AllocFree(ALLOC_CODE, ft);
+}
+
+// Writes the header, the three node arrays and the tokens
+void FlatTreeWrite(FlatTree ft, FILE *fp) {
+    struct header h = {
+        .version = FLAT_TREE_VERSION,
+        .numNodes = ft->numNodes,
+        .tokenBytes = ft->tokenBytes,
+        .checksum = checksum(ft),
+    };
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    fwrite(&h, sizeof(h), 1, fp);
+    fwrite(ft->left, sizeof(int32_t), ft->numNodes, fp);
+    fwrite(ft->right, sizeof(int32_t), ft->numNodes, fp);
+    fwrite(ft->tokenStart, sizeof(int32_t), ft->numNodes, fp);
+    fwrite(ft->tokens, 1, ft->tokenBytes, fp);
+}
+
+// Reads a flat tree written by FlatTreeWrite
+FlatTree FlatTreeRead(FILE *fp) {
+    struct header h;
+    if (fread(&h, sizeof(h), 1, fp) != 1 || !isValidHeader(&h)) {
+        return NULL;
+    }
+
+    int32_t numNodes = h.numNodes;
+    FlatTree ft = newFlatTree(numNodes, h.tokenBytes);
+    if (fread(ft->left, sizeof(int32_t), numNodes, fp) != (size_t)numNodes ||
+            fread(ft->right, sizeof(int32_t), numNodes, fp) != (size_t)numNodes ||
+            fread(ft->tokenStart, sizeof(int32_t), numNodes, fp) != (size_t)numNodes ||
+            fread(ft->tokens, 1, h.tokenBytes, fp) != (size_t)h.tokenBytes ||
+            checksum(ft) != h.checksum || !isValid(ft)) {
+        FlatTreeFree(ft);
+        return NULL;
+    }
+    return ft;
+}
+
+// Maps the file and points the arrays into the mapping
+FlatTree FlatTreeMap(char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    StatsBegin(STATS_READ_TREE);
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct header)) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        StatsEnd(STATS_READ_TREE);
+        return NULL;
+    }
+
+    struct header *h = map;
+    if (!isValidHeader(h) || sizeof(struct header) + bodySize(h) != (size_t)st.st_size) {
+        munmap(map, st.st_size);
+        StatsEnd(STATS_READ_TREE);
+        return NULL;
+    }
+
+    FlatTree ft = AllocMalloc(ALLOC_CODE, sizeof(struct flatTree));
+    ft->numNodes = h->numNodes;
+    ft->tokenBytes = h->tokenBytes;
+    ft->left = (int32_t *)(h + 1);
+    ft->right = ft->left + h->numNodes;
+    ft->tokenStart = ft->right + h->numNodes;
+    ft->tokens = (char *)(ft->tokenStart + h->numNodes);
+    ft->map = map;
+    ft->mapSize = st.st_size;
+    if (checksum(ft) != h->checksum || !isValid(ft)) {
+        FlatTreeFree(ft);
+        ft = NULL;
+    }
+    StatsEnd(STATS_READ_TREE);
+    return ft;
+}
+
+// Decodes the encoding by walking the child arrays
+void FlatTreeDecode(FlatTree ft, char *encoding, char *outputFilename) {
+    StatsBegin(STATS_DECODE);
+    struct file *outputFile = FileOpenToWrite(outputFilename);
+    int32_t node = 0;
+    bool loneLeaf = ft->left[0] == -1;
+    for (size_t i = 0; encoding[i] != '\0'; i++) {
+        if (loneLeaf) {
+            // The lone leaf's code is a single 0, and no code starts with 1
+            if (encoding[i] == '1') {
+                fprintf(stderr, "error: the encoding has bits that start no code of the tree\n");
+                exit(EXIT_FAILURE);
+            } else if (encoding[i] != '0') {
+                continue;
+            }
+        } else if (encoding[i] == '0') {
+            node = ft->left[node];
+        } else if (encoding[i] == '1') {
+            node = ft->right[node];
+        }
+        // If leaf node, add token to output file
+        if (ft->left[node] == -1) {
+            char *token = ft->tokens + ft->tokenStart[node];
+            if (strcmp(token, ESCAPE_TOKEN) == 0) {
+                char escaped[MAX_TOKEN_LEN + 1];
+                if (!decodeEscapedToken(encoding, &i, escaped)) {
+                    break;
+                }
+                FileWrite(outputFile, escaped);
+            } else {
+                FileWrite(outputFile, token);
+            }
+            node = 0;
+        }
+    }
+    FileClose(outputFile);
+    StatsEnd(STATS_DECODE);
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Allocates the arrays of a flat tree
+static FlatTree newFlatTree(int32_t numNodes, int32_t tokenBytes) {
+    FlatTree ft = AllocMalloc(ALLOC_CODE, sizeof(struct flatTree));
+    ft->numNodes = numNodes;
+    ft->tokenBytes = tokenBytes;
+    ft->left = AllocMalloc(ALLOC_CODE, (numNodes + 1) * sizeof(int32_t));
+    ft->right = AllocMalloc(ALLOC_CODE, (numNodes + 1) * sizeof(int32_t));
+    ft->tokenStart = AllocMalloc(ALLOC_CODE, (numNodes + 1) * sizeof(int32_t));
+    ft->tokens = AllocMalloc(ALLOC_CODE, tokenBytes + 1);
+    ft->map = NULL;
+    ft->mapSize = 0;
+    return ft;
+}
+
+// Checks the magic number and version, and that the sizes are positive
+static bool isValidHeader(struct header *h) {
+    return memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+           h->version == FLAT_TREE_VERSION && h->numNodes > 0 && h->tokenBytes > 0;
+}
+
+// Returns the number of bytes that follow a valid header
+static size_t bodySize(struct header *h) {
+    return 3 * sizeof(int32_t) * (size_t)h->numNodes + h->tokenBytes;
+}
+
+// The checksum covers the arrays in the order they are written
+static uint64_t checksum(FlatTree ft) {
+    size_t arrayBytes = ft->numNodes * sizeof(int32_t);
+    uint64_t hash = hashBytes(FNV_OFFSET, ft->left, arrayBytes);
+    hash = hashBytes(hash, ft->right, arrayBytes);
+    hash = hashBytes(hash, ft->tokenStart, arrayBytes);
+    return hashBytes(hash, ft->tokens, ft->tokenBytes);
+}
+
+// FNV-1a over the bytes, continuing from the given hash
+static uint64_t hashBytes(uint64_t hash, const void *bytes, size_t len) {
+    const unsigned char *p = bytes;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Checks that children point forwards and tokens lie inside the token buffer
+static bool isValid(FlatTree ft) {
+    if (ft->tokens[ft->tokenBytes - 1] != '\0') {
+        return false;
+    }
+    for (int32_t i = 0; i < ft->numNodes; i++) {
+        bool leaf = ft->left[i] == -1;
+        if (leaf != (ft->right[i] == -1)) {
+            return false;
+        }
+        if (leaf && (ft->tokenStart[i] < 0 || ft->tokenStart[i] >= ft->tokenBytes)) {
+            return false;
+        }
+        if (!leaf && (ft->left[i] <= i || ft->left[i] >= ft->numNodes ||
+                      ft->right[i] <= i || ft->right[i] >= ft->numNodes)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+// Interface to the FlatTree ADT, a huffman tree stored as arrays of child
+// indices and a single token buffer. It can be written to and read from a
+// stream without parsing or per-node allocation, and is used as the decode
+// table of the tree cache and as the binary tree file format.
+//
+// A binary tree file is a 24 byte header (magic "HUFD", format version,
+// node count, token bytes and a 64-bit FNV-1a checksum of the rest of the
+// file) followed by the left, right and tokenStart arrays as native-endian
+// 32-bit integers and then the tokens. Every array starts on a 4 byte
+// boundary, so a mapped file is used in place.
+
+#ifndef FLAT_TREE_H
+#define FLAT_TREE_H
+
+#include <stdio.h>
+
+#include "huffman.h"
+
+typedef struct flatTree *FlatTree;
+
+/**
+ * Returns a flat copy of the tree, with the root at index 0
+ * The flat tree must be freed with FlatTreeFree
+ */
+FlatTree FlatTreeNew(struct huffmanTree *tree);
+
+/**
+ * Frees all memory allocated to the flat tree
+ */
+void FlatTreeFree(FlatTree ft);
+
+/**
+ * Writes the flat tree to the stream in binary
+ */
+void FlatTreeWrite(FlatTree ft, FILE *fp);
+
+/**
+ * Reads a flat tree written by FlatTreeWrite
+ * Returns NULL if the stream does not contain a valid flat tree
+ */
+FlatTree FlatTreeRead(FILE *fp);
+
+/**
+ * Maps a file written by FlatTreeWrite into memory and checks it
+ * Returns NULL if the file cannot be opened or is not a valid flat tree
+ * The nodes and tokens are read straight from the mapping, which is
+ * released by FlatTreeFree
+ */
+FlatTree FlatTreeMap(char *filename);
+
+/**
+ * Decodes the encoding ('0'/'1' string) and writes the tokens to the file
+ */
+void FlatTreeDecode(FlatTree ft, char *encoding, char *outputFilename);
+
+#endif
@@ -0,0 +1,710 @@
+// Implementation of the HuffmanCodec ADT
+//
+// Encoding looks tokens up in a direct table for ASCII and a hash table for
+// everything else, and writes codes through a 64-bit accumulator. Decoding
+// peeks TABLE_BITS bits at a time: codes of up to TABLE_BITS bits are
+// resolved by a single table lookup, and longer codes continue from the
+// table entry down a flat copy of the tree.
+//
+// The flat copy is a single child[node][bit] array. Internal nodes come
+// first; rows from firstLeaf on are the leaves, symbol (row - firstLeaf),
+// and both their children point back at themselves. A walk that reaches a
+// leaf therefore stays there, so long codes are resolved by a fixed number
+// of unconditional lookups with no per-bit leaf test, and the code length
+// of the leaf reached says how many bits were really used. The one
+// exception is a lone leaf, whose code is "0": its root has no 1 child, so
+// such a codec is only decoded by the checked loop.
+//
+// Interleaved encodings deal the tokens round-robin across several streams.
+// The decoder takes one symbol from each stream per round, so the streams'
+// lookups run in parallel on a superscalar core; a single stream is decoded
+// by the same loop with one stream per round.
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "Counter.h"
+#include "HuffmanCodec.h"
+#include "Tokenizer.h"
+#include "huffman.h"
+
+#define TABLE_BITS 11
+#define TABLE_SIZE (1 << TABLE_BITS)
+#define MAX_CODE_LEN 64
+// Bits past the longest symbol that a fast decode may read: the long code
+// walk reads a whole word from TABLE_BITS past the symbol's start
+#define FAST_MARGIN (TABLE_BITS + 64)
+
+// Structs definition
+struct symbol {
+    uint64_t code;          // right aligned
+    int len;
+    int tokenStart;         // offset of the token in tokens
+    int tokenLen;
+};
+
+struct huffmanCodec {
+    int numSymbols;
+    int escapeSymbol;       // -1 if the tree has no escape leaf
+    int maxCodeLen;
+    int maxSymbolBits;      // longest code, or escape code and its raw bytes
+    int maxTokenLen;
+    bool hasWords;          // false for character alphabets, which skip word lookups
+    struct symbol *symbols;
+    char *tokens;
+
+    // Encoding lookups: symbol index, or -1 if absent
+    int32_t asciiSymbol[128];
+    int32_t *hashTable;
+    uint32_t hashMask;
+
+    // Decoding: the children of every node, with leaves from firstLeaf on,
+    // and the lookup table over the next TABLE_BITS bits
+    int32_t (*child)[2];
+    int32_t firstLeaf;
+    int longSteps;                      // lookups that resolve any longer code
+    int32_t tableSymbol[TABLE_SIZE];    // symbol, or node to continue from
+    uint8_t tableLen[TABLE_SIZE];       // code length, or 0 for longer codes
+};
+
+// An encoder's output position in a caller buffer
+struct bitSink {
+    unsigned char *out;
+    size_t len;
+    size_t cap;
+    uint64_t acc;
+    int accBits;
+};
+
+struct frame {
+    struct huffmanTree *node;
+    int32_t parent;
+    int bit;
+    uint64_t code;
+    int len;
+};
+
+// Helper functions
+static bool flattenTree(HuffmanCodec codec, struct huffmanTree *tree);
+static void buildLookups(HuffmanCodec codec);
+static inline int32_t nextSymbol(HuffmanCodec codec, const char *in, size_t inLen, size_t i,
+                                 size_t *wordEnd, int *tokenLen);
+static inline bool putSymbol(HuffmanCodec codec, struct bitSink *sink, int32_t sym,
+                             const char *raw, int rawBytes);
+static inline bool putBits(struct bitSink *sink, uint32_t bits, int n);
+static bool flushSink(struct bitSink *sink);
+static int64_t decodeStreams(HuffmanCodec codec, const unsigned char *in[],
+                             const uint64_t numBits[], int numStreams,
+                             char *out, size_t outCap, uint64_t *bitsUsed);
+static inline void decodeFast(HuffmanCodec codec, const unsigned char *in, uint64_t *pos,
+                              char *out, size_t *outLen);
+static bool decodeSymbol(HuffmanCodec codec, const unsigned char *in, uint64_t numBits,
+                         uint64_t *pos, char *out, size_t outCap, size_t *outLen);
+static bool isCode(HuffmanCodec codec, const unsigned char *in, uint64_t numBits, uint64_t pos);
+static int32_t findSymbol(HuffmanCodec codec, const char *token, int tokenLen);
+static uint32_t hashToken(const char *token, int tokenLen);
+static uint32_t peekBits(const unsigned char *in, uint64_t numBits, uint64_t pos, int n);
+static uint64_t peekWindow(const unsigned char *in, uint64_t numBits, uint64_t pos);
+static inline uint64_t loadWindow(const unsigned char *in, uint64_t pos);
+
+// Returns a new codec for the tree
+HuffmanCodec CodecNewFromTree(struct huffmanTree *tree) {
+    if (tree == NULL) {
+        return NULL;
+    }
+
+    HuffmanCodec codec = AllocMalloc(ALLOC_CODE, sizeof(struct huffmanCodec));
+    if (!flattenTree(codec, tree)) {
+        CodecFree(codec);
+        return NULL;
+    }
+    buildLookups(codec);
+    return codec;
+}
+
+// Returns a new codec for the counter's histogram
+HuffmanCodec CodecNewFromCounter(Counter c) {
+    struct huffmanTree *tree = createHuffmanTreeFromCounter(c);
+    HuffmanCodec codec = CodecNewFromTree(tree);
+    destroyHuffmanTree(tree);
+    return codec;
+}
+
+// Frees the codec
+void CodecFree(HuffmanCodec codec) {
+    if (codec == NULL) {
+        return;
+    }
+    AllocFree(ALLOC_CODE, codec->symbols);
+    AllocFree(ALLOC_CODE, codec->tokens);
+    AllocFree(ALLOC_CODE, codec->hashTable);
+    AllocFree(ALLOC_CODE, codec->child);
+    AllocFree(ALLOC_CODE, codec);
+}
+
+bool CodecHasWords(HuffmanCodec codec) {
+    return codec->hasWords;
+}
+
+// Every byte of input costs at most one longest code, or one escape code and
+// its 8 raw bits, and every stream may end in a padding byte
+size_t CodecMaxEncodedSize(HuffmanCodec codec, size_t inLen) {
+    size_t bitsPerByte = codec->maxCodeLen;
+    if (codec->escapeSymbol >= 0 && codec->symbols[codec->escapeSymbol].len + 8 > (int)bitsPerByte) {
+        bitsPerByte = codec->symbols[codec->escapeSymbol].len + 8;
+    }
+    return (inLen * bitsPerByte + 7) / 8 + CODEC_MAX_STREAMS;
+}
+
+// Encodes the text, trying whole words first, then characters, then escapes
+int64_t CodecEncode(HuffmanCodec codec, const char *in, size_t inLen,
+                    unsigned char *out, size_t outCap) {
+    struct bitSink sink = {out, 0, outCap, 0, 0};
+    size_t wordEnd = 0;
+
+    for (size_t i = 0; i < inLen; ) {
+        int tokenLen;
+        int32_t sym = nextSymbol(codec, in, inLen, i, &wordEnd, &tokenLen);
+        if (sym < 0) {
+            return -1;
+        }
+        int rawBytes = sym == codec->escapeSymbol ? tokenLen : 0;
+        if (!putSymbol(codec, &sink, sym, &in[i], rawBytes)) {
+            return -1;
+        }
+        i += tokenLen;
+    }
+    uint64_t numBits = 8 * (uint64_t)sink.len + sink.accBits;
+    return flushSink(&sink) ? (int64_t)numBits : -1;
+}
+
+// Sizes every stream in a first pass, so the streams can be written side
+// by side in a second
+int64_t CodecEncodeStreams(HuffmanCodec codec, const char *in, size_t inLen, int numStreams,
+                           unsigned char *out, size_t outCap, uint64_t streamBits[]) {
+    if (numStreams < 1 || numStreams > CODEC_MAX_STREAMS) {
+        return -1;
+    }
+    for (int k = 0; k < numStreams; k++) {
+        streamBits[k] = 0;
+    }
+    size_t wordEnd = 0;
+    int k = 0;
+    for (size_t i = 0; i < inLen; ) {
+        int tokenLen;
+        int32_t sym = nextSymbol(codec, in, inLen, i, &wordEnd, &tokenLen);
+        if (sym < 0) {
+            return -1;
+        }
+        int rawBytes = sym == codec->escapeSymbol ? tokenLen : 0;
+        streamBits[k] += codec->symbols[sym].len + 8 * rawBytes;
+        k = k + 1 == numStreams ? 0 : k + 1;
+        i += tokenLen;
+    }
+
+    struct bitSink sinks[CODEC_MAX_STREAMS];
+    size_t outLen = 0;
+    for (k = 0; k < numStreams; k++) {
+        size_t numBytes = (streamBits[k] + 7) / 8;
+        if (numBytes > outCap - outLen) {
+            return -1;
+        }
+        sinks[k] = (struct bitSink){&out[outLen], 0, numBytes, 0, 0};
+        outLen += numBytes;
+    }
+
+    wordEnd = 0;
+    k = 0;
+    for (size_t i = 0; i < inLen; ) {
+        int tokenLen;
+        int32_t sym = nextSymbol(codec, in, inLen, i, &wordEnd, &tokenLen);
+        int rawBytes = sym == codec->escapeSymbol ? tokenLen : 0;
+        putSymbol(codec, &sinks[k], sym, &in[i], rawBytes);
+        k = k + 1 == numStreams ? 0 : k + 1;
+        i += tokenLen;
+    }
+    for (k = 0; k < numStreams; k++) {
+        flushSink(&sinks[k]);
+    }
+    return outLen;
+}
+
+// Decodes the bitstream one table lookup per short code
+int64_t CodecDecode(HuffmanCodec codec, const unsigned char *in, uint64_t numBits,
+                    char *out, size_t outCap) {
+    return decodeStreams(codec, &in, &numBits, 1, out, outCap, NULL);
+}
+
+// Decodes up to the last whole code
+int64_t CodecDecodePrefix(HuffmanCodec codec, const unsigned char *in, uint64_t numBits,
+                          char *out, size_t outCap, uint64_t *bitsUsed) {
+    return decodeStreams(codec, &in, &numBits, 1, out, outCap, bitsUsed);
+}
+
+// Every code is at least one bit
+size_t CodecMaxDecodedSize(HuffmanCodec codec, uint64_t numBits) {
+    return numBits * codec->maxTokenLen;
+}
+
+// Finds where every stream starts and decodes them side by side
+int64_t CodecDecodeStreams(HuffmanCodec codec, const unsigned char *in, int numStreams,
+                           const uint64_t streamBits[], char *out, size_t outCap) {
+    if (numStreams < 1 || numStreams > CODEC_MAX_STREAMS) {
+        return -1;
+    }
+    const unsigned char *start[CODEC_MAX_STREAMS];
+    size_t offset = 0;
+    for (int k = 0; k < numStreams; k++) {
+        start[k] = &in[offset];
+        offset += (streamBits[k] + 7) / 8;
+    }
+    return decodeStreams(codec, start, streamBits, numStreams, out, outCap, NULL);
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Returns the symbol for the token at in[i] and sets *tokenLen to its
+// length: a whole word if the alphabet has it, else a single character,
+// else the escape symbol. Returns -1 if the character is not in the tree
+// and the tree has no escape leaf.
+static inline int32_t nextSymbol(HuffmanCodec codec, const char *in, size_t inLen, size_t i,
+                                 size_t *wordEnd, int *tokenLen) {
+    int32_t sym = -1;
+    *tokenLen = 0;
+    if (codec->hasWords && i >= *wordEnd) {
+        while (i + *tokenLen < inLen && isalpha((unsigned char)in[i + *tokenLen])) {
+            (*tokenLen)++;
+        }
+        *wordEnd = i + *tokenLen;
+        if (TokenWordFits(*tokenLen)) {
+            sym = findSymbol(codec, &in[i], *tokenLen);
+        }
+    }
+
+    if (sym < 0) {
+        *tokenLen = TokenCharLen((char *)&in[i]);
+        if (i + *tokenLen > inLen) {
+            *tokenLen = inLen - i;
+        }
+        sym = *tokenLen == 1 && (unsigned char)in[i] < 128
+            ? codec->asciiSymbol[(unsigned char)in[i]]
+            : findSymbol(codec, &in[i], *tokenLen);
+    }
+    return sym >= 0 ? sym : codec->escapeSymbol;
+}
+
+// Writes the symbol's code and then rawBytes bytes of raw; returns false if
+// the sink is full. Codes are written in at most 32 bit pieces so the
+// accumulator never holds more than 39 bits.
+static inline bool putSymbol(HuffmanCodec codec, struct bitSink *sink, int32_t sym,
+                             const char *raw, int rawBytes) {
+    struct symbol *s = &codec->symbols[sym];
+    if (s->len > 32 && !putBits(sink, (uint32_t)(s->code >> 32), s->len - 32)) {
+        return false;
+    }
+    bool ok = putBits(sink, (uint32_t)s->code, s->len > 32 ? 32 : s->len);
+    for (int b = 0; ok && b < rawBytes; b++) {
+        ok = putBits(sink, (unsigned char)raw[b], 8);
+    }
+    return ok;
+}
+
+// Writes the low n (at most 32) bits of bits
+static inline bool putBits(struct bitSink *sink, uint32_t bits, int n) {
+    sink->acc = (sink->acc << n) | (bits & (uint32_t)((UINT64_C(1) << n) - 1));
+    sink->accBits += n;
+    while (sink->accBits >= 8) {
+        if (sink->len == sink->cap) {
+            return false;
+        }
+        sink->accBits -= 8;
+        sink->out[sink->len++] = (unsigned char)(sink->acc >> sink->accBits);
+    }
+    return true;
+}
+
+// Pads the final byte with zero bits
+static bool flushSink(struct bitSink *sink) {
+    if (sink->accBits > 0) {
+        if (sink->len == sink->cap) {
+            return false;
+        }
+        sink->out[sink->len++] = (unsigned char)(sink->acc << (8 - sink->accBits));
+        sink->accBits = 0;
+    }
+    return true;
+}
+
+// Takes one symbol from each stream in turn. Each stream's position
+// depends only on its own codes, so the lookups of one stream overlap those
+// of the others instead of waiting on the previous code's length. Runs of
+// rounds that cannot reach the end of any stream, or of out, are decoded
+// without bounds checks. If bitsUsed is not NULL, decoding stops quietly
+// before a code that does not fit and *bitsUsed says where.
+static int64_t decodeStreams(HuffmanCodec codec, const unsigned char *in[],
+                             const uint64_t numBits[], int numStreams,
+                             char *out, size_t outCap, uint64_t *bitsUsed) {
+    uint64_t pos[CODEC_MAX_STREAMS];
+    for (int k = 0; k < numStreams; k++) {
+        pos[k] = 0;
+    }
+    size_t outLen = 0;
+    while (codec->numSymbols > 1) {
+        uint64_t rounds = (outCap - outLen) / ((size_t)numStreams * codec->maxTokenLen);
+        for (int k = 0; k < numStreams; k++) {
+            uint64_t left = numBits[k] - pos[k];
+            uint64_t safe = left > FAST_MARGIN ? (left - FAST_MARGIN) / codec->maxSymbolBits : 0;
+            rounds = safe < rounds ? safe : rounds;
+        }
+        if (rounds == 0) {
+            break;
+        }
+        for (uint64_t r = 0; r < rounds; r++) {
+            for (int k = 0; k < numStreams; k++) {
+                decodeFast(codec, in[k], &pos[k], out, &outLen);
+            }
+        }
+    }
+
+    // The last few symbols of every stream
+    int k = 0;
+    while (pos[k] < numBits[k]) {
+        uint64_t before = pos[k];
+        if (!decodeSymbol(codec, in[k], numBits[k], &pos[k], out, outCap, &outLen)) {
+            // Bits that start no code are an error even in a prefix
+            if (bitsUsed == NULL || !isCode(codec, in[k], numBits[k], before)) {
+                return -1;
+            }
+            *bitsUsed = before;
+            return outLen;
+        }
+        k = k + 1 == numStreams ? 0 : k + 1;
+    }
+    if (bitsUsed != NULL) {
+        *bitsUsed = pos[0];
+        return outLen;
+    }
+
+    // The first stream to run out ends the text, so every stream must end
+    // there too
+    for (k = 0; k < numStreams; k++) {
+        if (pos[k] != numBits[k]) {
+            return -1;
+        }
+    }
+    return outLen;
+}
+
+// Decodes the symbol at *pos with no bounds checks: at least FAST_MARGIN
+// bits beyond the longest symbol remain, and out has room for the longest
+// token
+static inline void decodeFast(HuffmanCodec codec, const unsigned char *in, uint64_t *pos,
+                              char *out, size_t *outLen) {
+    uint64_t window = loadWindow(in, *pos);
+    uint32_t peek = (uint32_t)(window >> (64 - TABLE_BITS));
+    int32_t sym = codec->tableSymbol[peek];
+    int len = codec->tableLen[peek];
+    if (len == 0) {
+        uint64_t rest = loadWindow(in, *pos + TABLE_BITS);
+        for (int k = 0; k < codec->longSteps; k++) {
+            sym = codec->child[sym][(rest >> (63 - k)) & 1];
+        }
+        sym -= codec->firstLeaf;
+        len = codec->symbols[sym].len;
+    }
+    *pos += len;
+
+    if (sym == codec->escapeSymbol) {
+        out[*outLen] = (char)(loadWindow(in, *pos) >> 56);
+        int tokenLen = TokenCharLen(&out[*outLen]);
+        for (int b = 0; b < tokenLen; b++) {
+            out[(*outLen)++] = (char)(loadWindow(in, *pos) >> 56);
+            *pos += 8;
+        }
+        return;
+    }
+    struct symbol *s = &codec->symbols[sym];
+    memcpy(&out[*outLen], &codec->tokens[s->tokenStart], s->tokenLen);
+    *outLen += s->tokenLen;
+}
+
+// Decodes the symbol at *pos into out and advances *pos and *outLen
+// Returns false if the bits start no code, the code runs past the end or
+// out is too small
+static bool decodeSymbol(HuffmanCodec codec, const unsigned char *in, uint64_t numBits,
+                         uint64_t *pos, char *out, size_t outCap, size_t *outLen) {
+    uint32_t peek = peekBits(in, numBits, *pos, TABLE_BITS);
+    int32_t sym;
+    int len = codec->tableLen[peek];
+    if (len > 0) {
+        sym = codec->tableSymbol[peek];
+    } else if (codec->tableSymbol[peek] < 0) {
+        return false;
+    } else {
+        // Walk the rest of the longest code; shorter codes stop at their
+        // leaf, which absorbs the remaining steps
+        uint64_t window = peekWindow(in, numBits, *pos + TABLE_BITS);
+        int32_t node = codec->tableSymbol[peek];
+        for (int k = 0; k < codec->longSteps; k++) {
+            node = codec->child[node][(window >> (63 - k)) & 1];
+        }
+        sym = node - codec->firstLeaf;
+        len = codec->symbols[sym].len;
+    }
+    // Bits past the end are read as zeros, so check the code fits
+    if (*pos + len > numBits) {
+        return false;
+    }
+    *pos += len;
+
+    if (sym == codec->escapeSymbol) {
+        // The raw bytes of a character that is not in the tree
+        if (*pos + 8 > numBits || *outLen == outCap) {
+            return false;
+        }
+        out[*outLen] = (char)peekBits(in, numBits, *pos, 8);
+        int tokenLen = TokenCharLen(&out[*outLen]);
+        if (*pos + 8 * tokenLen > numBits || *outLen + tokenLen > outCap) {
+            return false;
+        }
+        for (int b = 0; b < tokenLen; b++) {
+            out[(*outLen)++] = (char)peekBits(in, numBits, *pos, 8);
+            *pos += 8;
+        }
+        return true;
+    }
+    struct symbol *s = &codec->symbols[sym];
+    if (*outLen + s->tokenLen > outCap) {
+        return false;
+    }
+    memcpy(&out[*outLen], &codec->tokens[s->tokenStart], s->tokenLen);
+    *outLen += s->tokenLen;
+    return true;
+}
+
+// Copies the tree into the child arrays and computes every leaf's code
+// Returns false if a code is longer than MAX_CODE_LEN bits
+static bool flattenTree(HuffmanCodec codec, struct huffmanTree *tree) {
+    codec->symbols = NULL;
+    codec->tokens = NULL;
+    codec->hashTable = NULL;
+    codec->child = NULL;
+
+    // Count leaves and token bytes
+    int numLeaves = 0;
+    int tokenBytes = 0;
+    int capacity = 64;
+    struct frame *stack = AllocMalloc(ALLOC_CODE, capacity * sizeof(struct frame));
+    int top = 0;
+    stack[top++] = (struct frame){tree, -1, 0, 0, 0};
+    while (top > 0) {
+        struct huffmanTree *node = stack[--top].node;
+        if (node->left == NULL || node->right == NULL) {
+            numLeaves++;
+            tokenBytes += strlen(node->token);
+            continue;
+        }
+        if (top + 2 > capacity) {
+            capacity *= 2;
+            stack = AllocRealloc(ALLOC_CODE, stack, capacity * sizeof(struct frame));
+        }
+        stack[top++] = (struct frame){node->right, -1, 0, 0, 0};
+        stack[top++] = (struct frame){node->left, -1, 0, 0, 0};
+    }
+
+    codec->numSymbols = numLeaves;
+    codec->escapeSymbol = -1;
+    codec->maxCodeLen = 1;
+    codec->maxTokenLen = 1;
+    codec->hasWords = false;
+    codec->symbols = AllocMalloc(ALLOC_CODE, numLeaves * sizeof(struct symbol));
+    codec->tokens = AllocMalloc(ALLOC_CODE, tokenBytes + 1);
+    // A lone leaf still gets the 1 bit code "0", so it has an internal root
+    // whose 1 child is -1
+    codec->firstLeaf = numLeaves > 1 ? numLeaves - 1 : 1;
+    codec->child = AllocMalloc(ALLOC_CODE, (codec->firstLeaf + numLeaves) * sizeof(int32_t[2]));
+
+    int numNodes = 0;
+    int numSymbols = 0;
+    int tokenPos = 0;
+    bool ok = true;
+    if (tree->left == NULL || tree->right == NULL) {
+        numNodes = 1;
+        stack[top++] = (struct frame){tree, 0, 0, 0, 1};
+        codec->child[0][1] = -1;
+    } else {
+        stack[top++] = (struct frame){tree, -1, 0, 0, 0};
+    }
+
+    while (top > 0) {
+        struct frame f = stack[--top];
+        int32_t ref;
+        if (f.node->left == NULL || f.node->right == NULL) {
+            // Leaf: record its symbol
+            struct symbol *s = &codec->symbols[numSymbols];
+            s->code = f.code;
+            s->len = f.len;
+            s->tokenStart = tokenPos;
+            s->tokenLen = strlen(f.node->token);
+            memcpy(&codec->tokens[tokenPos], f.node->token, s->tokenLen);
+            tokenPos += s->tokenLen;
+            if (s->tokenLen > codec->maxTokenLen) {
+                codec->maxTokenLen = s->tokenLen;
+            }
+            if (strcmp(f.node->token, ESCAPE_TOKEN) == 0) {
+                codec->escapeSymbol = numSymbols;
+            } else if (s->tokenLen > TokenCharLen(f.node->token)) {
+                codec->hasWords = true;
+            }
+            if (f.len > codec->maxCodeLen) {
+                codec->maxCodeLen = f.len;
+            }
+            ref = codec->firstLeaf + numSymbols++;
+            codec->child[ref][0] = codec->child[ref][1] = ref;
+        } else {
+            if (f.len >= MAX_CODE_LEN) {
+                ok = false;
+                break;
+            }
+            ref = numNodes++;
+            stack[top++] = (struct frame){f.node->right, ref, 1, (f.code << 1) | 1, f.len + 1};
+            stack[top++] = (struct frame){f.node->left, ref, 0, f.code << 1, f.len + 1};
+        }
+        if (f.parent >= 0) {
+            codec->child[f.parent][f.bit] = ref;
+        }
+    }
+
+    AllocFree(ALLOC_CODE, stack);
+    codec->longSteps = codec->maxCodeLen > TABLE_BITS ? codec->maxCodeLen - TABLE_BITS : 0;
+    codec->maxSymbolBits = codec->maxCodeLen;
+    if (codec->escapeSymbol >= 0) {
+        // An escaped character is up to 4 raw bytes
+        int escapeBits = codec->symbols[codec->escapeSymbol].len + 32;
+        codec->maxSymbolBits = escapeBits > codec->maxSymbolBits ? escapeBits : codec->maxSymbolBits;
+        codec->maxTokenLen = codec->maxTokenLen > 4 ? codec->maxTokenLen : 4;
+    }
+    return ok;
+}
+
+// Fills the encode lookups and the decode table
+static void buildLookups(HuffmanCodec codec) {
+    for (int i = 0; i < 128; i++) {
+        codec->asciiSymbol[i] = -1;
+    }
+    memset(codec->tableLen, 0, sizeof(codec->tableLen));
+    uint32_t capacity = 16;
+    while (capacity < (uint32_t)codec->numSymbols * 2) {
+        capacity *= 2;
+    }
+    codec->hashMask = capacity - 1;
+    codec->hashTable = AllocMalloc(ALLOC_CODE, capacity * sizeof(int32_t));
+    for (uint32_t i = 0; i < capacity; i++) {
+        codec->hashTable[i] = -1;
+    }
+
+    for (int sym = 0; sym < codec->numSymbols; sym++) {
+        struct symbol *s = &codec->symbols[sym];
+        char *token = &codec->tokens[s->tokenStart];
+        if (s->tokenLen == 1 && (unsigned char)token[0] < 128) {
+            codec->asciiSymbol[(unsigned char)token[0]] = sym;
+        }
+        if (findSymbol(codec, token, s->tokenLen) < 0) {
+            uint32_t i = hashToken(token, s->tokenLen) & codec->hashMask;
+            while (codec->hashTable[i] >= 0) {
+                i = (i + 1) & codec->hashMask;
+            }
+            codec->hashTable[i] = sym;
+        }
+
+        // Every table index that starts with a short code decodes to it
+        if (s->len <= TABLE_BITS) {
+            uint32_t first = (uint32_t)s->code << (TABLE_BITS - s->len);
+            uint32_t count = 1u << (TABLE_BITS - s->len);
+            for (uint32_t k = 0; k < count; k++) {
+                codec->tableSymbol[first + k] = sym;
+                codec->tableLen[first + k] = s->len;
+            }
+        }
+    }
+
+    // The remaining indices are prefixes of long codes: walk them to the
+    // internal node where decoding continues, or to -1 if no code starts so
+    for (uint32_t index = 0; index < TABLE_SIZE; index++) {
+        if (codec->tableLen[index] == 0) {
+            int32_t node = 0;
+            for (int b = TABLE_BITS - 1; b >= 0 && node >= 0; b--) {
+                node = codec->child[node][(index >> b) & 1];
+            }
+            codec->tableSymbol[index] = node;
+            codec->tableLen[index] = 0;
+        }
+    }
+}
+
+// Returns false if no code starts with the bits at pos, reading bits past
+// the end as zeros, which some code always starts with
+static bool isCode(HuffmanCodec codec, const unsigned char *in, uint64_t numBits, uint64_t pos) {
+    uint32_t peek = peekBits(in, numBits, pos, TABLE_BITS);
+    return codec->tableLen[peek] > 0 || codec->tableSymbol[peek] >= 0;
+}
+
+// Returns the symbol of the token, or -1 if it is not in the tree
+static int32_t findSymbol(HuffmanCodec codec, const char *token, int tokenLen) {
+    for (uint32_t i = hashToken(token, tokenLen) & codec->hashMask; ; i = (i + 1) & codec->hashMask) {
+        int32_t sym = codec->hashTable[i];
+        if (sym < 0) {
+            return -1;
+        }
+        struct symbol *s = &codec->symbols[sym];
+        if (s->tokenLen == tokenLen && memcmp(&codec->tokens[s->tokenStart], token, tokenLen) == 0) {
+            return sym;
+        }
+    }
+}
+
+// FNV-1a hash of the token bytes
+static uint32_t hashToken(const char *token, int tokenLen) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < tokenLen; i++) {
+        hash ^= (unsigned char)token[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Returns the n (at most 32) bits starting at bit pos, with bits past the
+// end of the stream read as zeros
+static uint32_t peekBits(const unsigned char *in, uint64_t numBits, uint64_t pos, int n) {
+    return (uint32_t)(peekWindow(in, numBits, pos) >> (64 - n));
+}
+
+// Returns the bits starting at bit pos in the high bits of a word; the top
+// 57 bits are always valid, with bits past the end of the stream read as zeros
+static uint64_t peekWindow(const unsigned char *in, uint64_t numBits, uint64_t pos) {
+    uint64_t numBytes = (numBits + 7) / 8;
+    uint64_t byte = pos >> 3;
+    uint64_t window = 0;
+    if (byte + 8 <= numBytes) {
+        memcpy(&window, &in[byte], 8);
+        window = __builtin_bswap64(window);
+    } else {
+        for (int k = 0; k < 8; k++) {
+            window = (window << 8) | (byte + k < numBytes ? in[byte + k] : 0);
+        }
+    }
+    return window << (pos & 7);
+}
+
+// Returns the 57 or more bits starting at bit pos in the high bits of a
+// word, without checking that 8 bytes remain
+static inline uint64_t loadWindow(const unsigned char *in, uint64_t pos) {
+    uint64_t window;
+    memcpy(&window, &in[pos >> 3], 8);
+    return __builtin_bswap64(window) << (pos & 7);
+}
@@ -0,0 +1,103 @@
+// Interface to the HuffmanCodec ADT, an in-memory encoder and decoder
+//
+// A codec is built once from a tree or a histogram and can then encode and
+// decode caller-owned buffers any number of times. Encode and decode do not
+// allocate and do not modify the codec, so one codec can be shared by several
+// threads. Encodings are packed bitstreams, most significant bit first.
+
+#ifndef HUFFMAN_CODEC_H
+#define HUFFMAN_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Counter.h"
+#include "huffman.h"
+
+#define CODEC_MAX_STREAMS 16
+
+typedef struct huffmanCodec *HuffmanCodec;
+
+/**
+ * Returns a new codec for the tree. The tree is copied, so it may be freed
+ * afterwards. Returns NULL if the tree has a code longer than 64 bits.
+ * The codec must be freed with CodecFree
+ */
+HuffmanCodec CodecNewFromTree(struct huffmanTree *tree);
+
+/**
+ * Returns a new codec for a tree built from the counter's histogram
+ * Returns NULL if the counter is empty
+ */
+HuffmanCodec CodecNewFromCounter(Counter c);
+
+/**
+ * Frees all memory allocated to the codec
+ */
+void CodecFree(HuffmanCodec codec);
+
+/**
+ * Returns true if the tree has word tokens, which the encoder tries before
+ * spelling a run of letters out character by character
+ */
+bool CodecHasWords(HuffmanCodec codec);
+
+/**
+ * Returns the size in bytes of a buffer that is always large enough to hold
+ * the encoding of inLen bytes of input
+ */
+size_t CodecMaxEncodedSize(HuffmanCodec codec, size_t inLen);
+
+/**
+ * Encodes inLen bytes of text into out, which has room for outCap bytes
+ * Returns the number of bits written, or -1 if out is too small or the text
+ * contains a token that is not in the tree (and the tree has no escape leaf)
+ */
+int64_t CodecEncode(HuffmanCodec codec, const char *in, size_t inLen,
+                    unsigned char *out, size_t outCap);
+
+/**
+ * Decodes numBits bits of in into out, which has room for outCap bytes
+ * Returns the number of bytes written, or -1 if out is too small or the
+ * bits do not form a whole number of codes of the tree
+ */
+int64_t CodecDecode(HuffmanCodec codec, const unsigned char *in, uint64_t numBits,
+                    char *out, size_t outCap);
+
+/**
+ * Decodes the whole codes at the start of numBits bits of in, for bits that
+ * arrive in pieces. Stops before a code cut off by the end of the bits and
+ * sets *bitsUsed to the number of bits decoded; the rest start the next
+ * piece. out must have room for CodecMaxDecodedSize(codec, numBits) bytes
+ * Returns the number of bytes written, or -1 if some bits start no code of
+ * the tree (a 1, for a tree with a single leaf)
+ */
+int64_t CodecDecodePrefix(HuffmanCodec codec, const unsigned char *in, uint64_t numBits,
+                          char *out, size_t outCap, uint64_t *bitsUsed);
+
+/**
+ * Returns the size in bytes of a buffer that is always large enough to hold
+ * the decoding of numBits bits
+ */
+size_t CodecMaxDecodedSize(HuffmanCodec codec, uint64_t numBits);
+
+/**
+ * Encodes inLen bytes of text as numStreams (at most CODEC_MAX_STREAMS)
+ * interleaved bitstreams: the k-th token goes to stream k % numStreams.
+ * The streams are written one after another into out, each padded to a
+ * whole byte, and streamBits receives the number of bits in each
+ * Returns the number of bytes written, or -1 as for CodecEncode
+ */
+int64_t CodecEncodeStreams(HuffmanCodec codec, const char *in, size_t inLen, int numStreams,
+                           unsigned char *out, size_t outCap, uint64_t streamBits[]);
+
+/**
+ * Decodes streams written by CodecEncodeStreams, taking one token from each
+ * stream in turn so that the streams are decoded side by side
+ * Returns the number of bytes written, or -1 as for CodecDecode or if the
+ * streams do not all end together
+ */
+int64_t CodecDecodeStreams(HuffmanCodec codec, const unsigned char *in, int numStreams,
+                           const uint64_t streamBits[], char *out, size_t outCap);
+
+#endif
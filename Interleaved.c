@@ -0,0 +1,119 @@
+// Implementation of the Interleaved module
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "HuffmanCodec.h"
+#include "Interleaved.h"
+#include "Stats.h"
+
+static const char MAGIC[4] = {'H', 'U', 'F', 'I'};
+
+#define INTERLEAVED_VERSION 1
+#define HEADER_SIZE 20
+
+// Helper functions
+static void putLE(unsigned char *p, uint64_t v, int numBytes);
+static uint64_t getLE(const unsigned char *p, int numBytes);
+
+// Encodes the text after the header, then fills the header in
+unsigned char *InterleavedEncode(HuffmanCodec codec, const char *text, size_t len,
+                                 int numStreams, size_t *outLen) {
+    size_t headerSize = HEADER_SIZE + 8 * numStreams;
+    size_t cap = headerSize + CodecMaxEncodedSize(codec, len);
+    unsigned char *out = AllocMalloc(ALLOC_BUFFER, cap);
+    uint64_t streamBits[CODEC_MAX_STREAMS];
+
+    StatsBegin(STATS_ENCODE);
+    int64_t numBytes = CodecEncodeStreams(codec, text, len, numStreams,
+                                          &out[headerSize], cap - headerSize, streamBits);
+    StatsEnd(STATS_ENCODE);
+    if (numBytes < 0) {
+        AllocFree(ALLOC_BUFFER, out);
+        return NULL;
+    }
+
+    memcpy(out, MAGIC, sizeof(MAGIC));
+    putLE(&out[4], INTERLEAVED_VERSION, 4);
+    putLE(&out[8], numStreams, 4);
+    putLE(&out[12], len, 8);
+    for (int k = 0; k < numStreams; k++) {
+        putLE(&out[HEADER_SIZE + 8 * k], streamBits[k], 8);
+    }
+    StatsAdd(STATS_BYTES_IN, len);
+    StatsAdd(STATS_BYTES_OUT, headerSize + numBytes);
+
+    *outLen = headerSize + numBytes;
+    return out;
+}
+
+// Checks that the streams exactly fill the rest of the data before decoding
+char *InterleavedDecode(HuffmanCodec codec, const unsigned char *data, size_t len,
+                        size_t *textLen) {
+    if (len < HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) != 0 ||
+            getLE(&data[4], 4) != INTERLEAVED_VERSION) {
+        return NULL;
+    }
+    uint64_t numStreams = getLE(&data[8], 4);
+    uint64_t size = getLE(&data[12], 8);
+    if (numStreams < 1 || numStreams > CODEC_MAX_STREAMS ||
+            len - HEADER_SIZE < 8 * numStreams) {
+        return NULL;
+    }
+
+    uint64_t streamBits[CODEC_MAX_STREAMS];
+    size_t headerSize = HEADER_SIZE + 8 * numStreams;
+    size_t numBytes = 0;
+    for (uint64_t k = 0; k < numStreams; k++) {
+        streamBits[k] = getLE(&data[HEADER_SIZE + 8 * k], 8);
+        if (streamBits[k] / 8 > len) {
+            return NULL;
+        }
+        numBytes += (streamBits[k] + 7) / 8;
+    }
+    if (numBytes != len - headerSize) {
+        return NULL;
+    }
+
+    // No stream can decode to more than its longest tokens
+    uint64_t totalBits = 0;
+    for (uint64_t k = 0; k < numStreams; k++) {
+        totalBits += streamBits[k];
+    }
+    if (size > CodecMaxDecodedSize(codec, totalBits)) {
+        return NULL;
+    }
+    char *text = AllocMalloc(ALLOC_BUFFER, size);
+    StatsBegin(STATS_DECODE);
+    int64_t n = CodecDecodeStreams(codec, &data[headerSize], numStreams, streamBits, text, size);
+    StatsEnd(STATS_DECODE);
+    if (n < 0 || (uint64_t)n != size) {
+        AllocFree(ALLOC_BUFFER, text);
+        return NULL;
+    }
+    StatsAdd(STATS_BYTES_IN, len);
+    StatsAdd(STATS_BYTES_OUT, size);
+
+    *textLen = size;
+    return text;
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+static void putLE(unsigned char *p, uint64_t v, int numBytes) {
+    for (int i = 0; i < numBytes; i++) {
+        p[i] = (unsigned char)(v >> (8 * i));
+    }
+}
+
+static uint64_t getLE(const unsigned char *p, int numBytes) {
+    uint64_t v = 0;
+    for (int i = numBytes - 1; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
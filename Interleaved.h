@@ -0,0 +1,35 @@
+// Interface to the Interleaved module, an encoding whose tokens are dealt
+// round-robin across several bitstreams so they can be decoded side by side
+// (see CodecEncodeStreams)
+//
+// Layout (integers little-endian):
+//   "HUFI", u32 version, u32 numStreams, u64 decoded bytes
+//   per stream: u64 encoded bits
+//   the streams, each padded to a whole byte
+
+#ifndef INTERLEAVED_H
+#define INTERLEAVED_H
+
+#include <stddef.h>
+
+#include "HuffmanCodec.h"
+
+/**
+ * Encodes len bytes of text with the codec in numStreams streams
+ * (at most CODEC_MAX_STREAMS). Returns the encoding and sets *outLen to its
+ * length in bytes, or returns NULL if the text has a character that is not
+ * in the tree. The encoding must be freed with AllocFree(ALLOC_BUFFER, ...)
+ */
+unsigned char *InterleavedEncode(HuffmanCodec codec, const char *text, size_t len,
+                                 int numStreams, size_t *outLen);
+
+/**
+ * Decodes an encoding made by InterleavedEncode with the same tree
+ * Returns the text and sets *textLen to its length, or returns NULL if data
+ * is not a complete, well-formed encoding. The text must be freed with
+ * AllocFree(ALLOC_BUFFER, ...)
+ */
+char *InterleavedDecode(HuffmanCodec codec, const unsigned char *data, size_t len,
+                        size_t *textLen);
+
+#endif
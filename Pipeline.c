@@ -0,0 +1,208 @@
+// Implementation of the Pipeline module
+//
+// Each ring is a circular array with a count of chunks published by its
+// producer and a count handed back by its consumer. The producer may fill
+// the next slot while fewer than numChunks chunks are outstanding, and the
+// consumer may take the next slot while it is behind the producer. One lock
+// and one condition variable cover both rings: chunks are large, so the
+// stages rarely touch them.
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Alloc.h"
+#include "Pipeline.h"
+
+// Structs definition
+struct ring {
+    struct chunk *slots;
+    int numChunks;
+    uint64_t published;
+    uint64_t released;
+};
+
+struct pipeline {
+    struct pipelineStages *stages;
+    struct ring input;      // reader to codec
+    struct ring output;     // codec to writer
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    bool failed;
+};
+
+// Helper functions
+static void *runReader(void *arg);
+static void *runCodec(void *arg);
+static void *runWriter(void *arg);
+static struct chunk *acquire(struct pipeline *p, struct ring *r);
+static void publish(struct pipeline *p, struct ring *r);
+static struct chunk *take(struct pipeline *p, struct ring *r);
+static void release(struct pipeline *p, struct ring *r);
+static void fail(struct pipeline *p);
+static void initRing(struct ring *r, int numChunks, size_t chunkSize);
+static void freeRing(struct ring *r);
+
+// Starts a thread per stage and waits for all three
+bool PipelineRun(struct pipelineStages *stages, int numChunks, size_t chunkSize) {
+    struct pipeline p;
+    p.stages = stages;
+    initRing(&p.input, numChunks, chunkSize);
+    initRing(&p.output, numChunks, chunkSize);
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.changed, NULL);
+    p.failed = false;
+
+    void *(*run[3])(void *) = {runReader, runCodec, runWriter};
+    pthread_t threads[3];
+    for (int i = 0; i < 3; i++) {
+        if (pthread_create(&threads[i], NULL, run[i], &p) != 0) {
+            fprintf(stderr, "error: failed to start a pipeline thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&p.changed);
+    pthread_mutex_destroy(&p.lock);
+    freeRing(&p.input);
+    freeRing(&p.output);
+    return !p.failed;
+}
+
+// Doubles the capacity until it is large enough
+void PipelineReserve(struct chunk *c, size_t size) {
+    if (size <= c->cap) {
+        return;
+    }
+    while (c->cap < size) {
+        c->cap = c->cap > 0 ? 2 * c->cap : 4096;
+    }
+    c->data = AllocRealloc(ALLOC_IO, c->data, c->cap);
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+static void *runReader(void *arg) {
+    struct pipeline *p = arg;
+    for (bool last = false; !last; ) {
+        struct chunk *in = acquire(p, &p->input);
+        if (in == NULL) {
+            break;
+        }
+        in->len = 0;
+        in->last = false;
+        if (!p->stages->read(p->stages->readState, in)) {
+            fail(p);
+            break;
+        }
+        last = in->last;
+        publish(p, &p->input);
+    }
+    return NULL;
+}
+
+static void *runCodec(void *arg) {
+    struct pipeline *p = arg;
+    for (bool last = false; !last; ) {
+        struct chunk *in = take(p, &p->input);
+        struct chunk *out = in != NULL ? acquire(p, &p->output) : NULL;
+        if (out == NULL) {
+            break;
+        }
+        out->len = 0;
+        out->last = in->last;
+        if (!p->stages->codec(p->stages->codecState, in, out)) {
+            fail(p);
+            break;
+        }
+        last = in->last;
+        release(p, &p->input);
+        publish(p, &p->output);
+    }
+    return NULL;
+}
+
+static void *runWriter(void *arg) {
+    struct pipeline *p = arg;
+    for (bool last = false; !last; ) {
+        struct chunk *out = take(p, &p->output);
+        if (out == NULL) {
+            break;
+        }
+        if (!p->stages->write(p->stages->writeState, out)) {
+            fail(p);
+            break;
+        }
+        last = out->last;
+        release(p, &p->output);
+    }
+    return NULL;
+}
+
+// Returns the next empty chunk of the ring, waiting while every chunk is
+// still with the consumer; NULL if the pipeline has failed
+static struct chunk *acquire(struct pipeline *p, struct ring *r) {
+    pthread_mutex_lock(&p->lock);
+    while (!p->failed && r->published - r->released == (uint64_t)r->numChunks) {
+        pthread_cond_wait(&p->changed, &p->lock);
+    }
+    struct chunk *c = p->failed ? NULL : &r->slots[r->published % r->numChunks];
+    pthread_mutex_unlock(&p->lock);
+    return c;
+}
+
+static void publish(struct pipeline *p, struct ring *r) {
+    pthread_mutex_lock(&p->lock);
+    r->published++;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// Returns the oldest published chunk of the ring, waiting while there is
+// none; NULL if the pipeline has failed
+static struct chunk *take(struct pipeline *p, struct ring *r) {
+    pthread_mutex_lock(&p->lock);
+    while (!p->failed && r->released == r->published) {
+        pthread_cond_wait(&p->changed, &p->lock);
+    }
+    struct chunk *c = p->failed ? NULL : &r->slots[r->released % r->numChunks];
+    pthread_mutex_unlock(&p->lock);
+    return c;
+}
+
+static void release(struct pipeline *p, struct ring *r) {
+    pthread_mutex_lock(&p->lock);
+    r->released++;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// Wakes every stage so that they all stop
+static void fail(struct pipeline *p) {
+    pthread_mutex_lock(&p->lock);
+    p->failed = true;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void initRing(struct ring *r, int numChunks, size_t chunkSize) {
+    r->slots = AllocMalloc(ALLOC_IO, numChunks * sizeof(struct chunk));
+    r->numChunks = numChunks;
+    r->published = 0;
+    r->released = 0;
+    for (int i = 0; i < numChunks; i++) {
+        r->slots[i] = (struct chunk){AllocMalloc(ALLOC_IO, chunkSize), 0, chunkSize, false};
+    }
+}
+
+static void freeRing(struct ring *r) {
+    for (int i = 0; i < r->numChunks; i++) {
+        AllocFree(ALLOC_IO, r->slots[i].data);
+    }
+    AllocFree(ALLOC_IO, r->slots);
+}
@@ -0,0 +1,67 @@
+// Interface to the Pipeline module, which runs a reader, a codec and a
+// writer on threads of their own so that reading and writing overlap the
+// codec's work
+//
+// The stages pass chunks through two rings: the reader fills chunks of the
+// first ring, the codec turns each into a chunk of the second, and the
+// writer drains those. A ring holds a fixed number of chunks, and a stage
+// that gets ahead blocks until the stage after it hands a chunk back, so
+// memory stays bounded however large the input. With two or more chunks
+// per ring, each stage works on one chunk while its neighbours fill or
+// drain another.
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct chunk {
+    char *data;
+    size_t len;
+    size_t cap;         // stages may grow data, updating cap
+    bool last;          // the final chunk of the input
+};
+
+/**
+ * Fills the chunk, which is empty, with the next piece of input
+ * Sets chunk->last on the final piece, which may be empty
+ * Returns false on error
+ */
+typedef bool (*PipelineReadFn)(void *state, struct chunk *in);
+
+/**
+ * Transforms in into out, which is empty; in->last tells the codec that no
+ * more input follows. Returns false on error
+ */
+typedef bool (*PipelineCodecFn)(void *state, struct chunk *in, struct chunk *out);
+
+/**
+ * Writes the chunk. Returns false on error
+ */
+typedef bool (*PipelineWriteFn)(void *state, struct chunk *out);
+
+struct pipelineStages {
+    PipelineReadFn read;
+    void *readState;
+    PipelineCodecFn codec;
+    void *codecState;
+    PipelineWriteFn write;
+    void *writeState;
+};
+
+/**
+ * Grows the chunk's data to hold at least size bytes, keeping its contents
+ */
+void PipelineReserve(struct chunk *c, size_t size);
+
+/**
+ * Runs the stages until the final chunk has been written, with numChunks
+ * chunks of chunkSize bytes in each ring. Each stage's functions are only
+ * ever called from that stage's thread, one chunk at a time, in order.
+ * Returns false if a stage failed, in which case the others stop at their
+ * next chunk
+ */
+bool PipelineRun(struct pipelineStages *stages, int numChunks, size_t chunkSize);
+
+#endif
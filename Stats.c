@@ -0,0 +1,191 @@
+// Implementation of the Stats module
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Alloc.h"
+#include "Stats.h"
+
+struct phaseInfo {
+    char *name;
+    bool fine;
+};
+
+static const struct phaseInfo phases[STATS_NUM_PHASES] = {
+    [STATS_TOTAL] = {"total", false},
+    [STATS_READ_INPUT] = {"read_input", false},
+    [STATS_COUNT] = {"count", false},
+    [STATS_BUILD_TREE] = {"build_tree", false},
+    [STATS_CODEBOOK] = {"codebook", false},
+    [STATS_ENCODE] = {"encode", false},
+    [STATS_READ_TREE] = {"read_tree", false},
+    [STATS_DECODE] = {"decode", false},
+    [STATS_TRANSFORM] = {"transform", false},
+    [STATS_WRITE_OUTPUT] = {"write_output", true},
+};
+
+static const char *counterNames[STATS_NUM_COUNTERS] = {
+    [STATS_TOKENS_IN] = "tokens_in",
+    [STATS_TOKENS_OUT] = "tokens_out",
+    [STATS_DISTINCT_TOKENS] = "distinct_tokens",
+    [STATS_BYTES_IN] = "bytes_in",
+    [STATS_BYTES_OUT] = "bytes_out",
+    [STATS_ALLOCATIONS] = "allocations",
+    [STATS_TREE_LEAVES] = "tree_leaves",
+    [STATS_TREE_DEPTH] = "tree_depth",
+};
+
+struct phaseTimes {
+    uint64_t calls;
+    double wallStart;
+    double cpuStart;
+    double wall;
+    double cpu;
+};
+
+static bool enabled = false;
+static char *program = "";
+static struct phaseTimes times[STATS_NUM_PHASES];
+static uint64_t counters[STATS_NUM_COUNTERS];
+
+// Helper functions
+static void report(void);
+static int treeDepth(struct huffmanTree *t, uint64_t *numLeaves);
+static double clockSeconds(clockid_t clock);
+
+// Turns stats on from the flag or the environment
+void StatsInit(char *progName, bool enable) {
+    char *env = getenv("HUFFMAN_STATS");
+    if (!enable && (env == NULL || env[0] == '\0' || strcmp(env, "0") == 0)) {
+        return;
+    }
+
+    enabled = true;
+    program = progName;
+    atexit(report);
+    StatsBegin(STATS_TOTAL);
+}
+
+bool StatsEnabled(void) {
+    return enabled;
+}
+
+void StatsBegin(StatsPhase phase) {
+    if (!enabled) {
+        return;
+    }
+    times[phase].calls++;
+    times[phase].wallStart = clockSeconds(CLOCK_MONOTONIC);
+    if (!phases[phase].fine) {
+        times[phase].cpuStart = clockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    }
+}
+
+void StatsEnd(StatsPhase phase) {
+    if (!enabled) {
+        return;
+    }
+    times[phase].wall += clockSeconds(CLOCK_MONOTONIC) - times[phase].wallStart;
+    if (!phases[phase].fine) {
+        times[phase].cpu += clockSeconds(CLOCK_PROCESS_CPUTIME_ID) - times[phase].cpuStart;
+    }
+}
+
+void StatsAdd(StatsCounter counter, uint64_t n) {
+    if (enabled) {
+        counters[counter] += n;
+    }
+}
+
+void StatsMax(StatsCounter counter, uint64_t value) {
+    if (enabled && value > counters[counter]) {
+        counters[counter] = value;
+    }
+}
+
+void StatsTreeShape(struct huffmanTree *tree) {
+    if (!enabled || tree == NULL) {
+        return;
+    }
+    uint64_t numLeaves = 0;
+    StatsMax(STATS_TREE_DEPTH, treeDepth(tree, &numLeaves));
+    StatsMax(STATS_TREE_LEAVES, numLeaves);
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Writes the JSON report to stderr
+static void report(void) {
+    StatsEnd(STATS_TOTAL);
+
+    fprintf(stderr, "{\"program\":\"%s\",\"phases\":{", program);
+    bool first = true;
+    for (int p = 0; p < STATS_NUM_PHASES; p++) {
+        if (times[p].calls == 0) {
+            continue;
+        }
+        fprintf(stderr, "%s\"%s\":{\"calls\":%llu,\"wall_s\":%.6f", first ? "" : ",",
+                phases[p].name, (unsigned long long)times[p].calls, times[p].wall);
+        if (!phases[p].fine) {
+            fprintf(stderr, ",\"cpu_s\":%.6f", times[p].cpu);
+        }
+        fprintf(stderr, "}");
+        first = false;
+    }
+
+    // Allocations are counted by the Alloc module, whatever did them
+    struct allocStats alloc;
+    AllocGetStats(ALLOC_NUM_SUBSYSTEMS, &alloc);
+    counters[STATS_ALLOCATIONS] = alloc.allocs;
+
+    fprintf(stderr, "},\"counters\":{");
+    for (int c = 0; c < STATS_NUM_COUNTERS; c++) {
+        fprintf(stderr, "%s\"%s\":%llu", c == 0 ? "" : ",", counterNames[c],
+                (unsigned long long)counters[c]);
+    }
+    fprintf(stderr, "}}\n");
+}
+
+// Returns the depth of the deepest leaf and adds up the leaves, walking the
+// tree with an explicit stack so a degenerate tree file cannot overflow
+static int treeDepth(struct huffmanTree *t, uint64_t *numLeaves) {
+    struct frame {
+        struct huffmanTree *node;
+        int depth;
+    };
+    size_t capacity = 64;
+    struct frame *stack = AllocMalloc(ALLOC_TREE, capacity * sizeof(struct frame));
+    size_t top = 0;
+    int maxDepth = 0;
+    stack[top++] = (struct frame){t, 0};
+    while (top > 0) {
+        struct frame f = stack[--top];
+        if (f.node->left == NULL && f.node->right == NULL) {
+            (*numLeaves)++;
+            maxDepth = f.depth > maxDepth ? f.depth : maxDepth;
+            continue;
+        }
+        if (top + 2 > capacity) {
+            capacity *= 2;
+            stack = AllocRealloc(ALLOC_TREE, stack, capacity * sizeof(struct frame));
+        }
+        if (f.node->right != NULL) {
+            stack[top++] = (struct frame){f.node->right, f.depth + 1};
+        }
+        if (f.node->left != NULL) {
+            stack[top++] = (struct frame){f.node->left, f.depth + 1};
+        }
+    }
+    AllocFree(ALLOC_TREE, stack);
+    return maxDepth;
+}
+
+static double clockSeconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
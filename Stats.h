@@ -0,0 +1,81 @@
+// Interface to the Stats module: per-phase timers and counters for finding
+// where a slow encode or decode spends its time
+//
+// Stats are off unless StatsInit is asked to turn them on or the
+// HUFFMAN_STATS environment variable is set (to anything but "0"). When off,
+// every call returns after a single flag test. When on, the totals are
+// written to stderr as one JSON object when the program exits.
+//
+// Phases may nest: write_output runs inside decode, and count includes
+// reading the tokens it counts. Fine-grained phases, which are entered once
+// per token, record wall time only, since reading the CPU clock that often
+// would dominate what is being measured.
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "huffman.h"
+
+typedef enum {
+    STATS_TOTAL,
+    STATS_READ_INPUT,   // reading the input text
+    STATS_COUNT,        // reading tokens and inserting them in a Counter
+    STATS_BUILD_TREE,   // sorting and merging nodes into a tree
+    STATS_CODEBOOK,     // walking the tree for the code of every leaf
+    STATS_ENCODE,       // looking up and appending codes
+    STATS_READ_TREE,    // parsing a tree file
+    STATS_DECODE,       // walking the tree for every bit, including output
+    STATS_TRANSFORM,    // the BWT, move-to-front and run-length stages
+    STATS_WRITE_OUTPUT, // writing the encoding or the decoded text (fine)
+    STATS_NUM_PHASES,
+} StatsPhase;
+
+typedef enum {
+    STATS_TOKENS_IN,
+    STATS_TOKENS_OUT,
+    STATS_DISTINCT_TOKENS,
+    STATS_BYTES_IN,
+    STATS_BYTES_OUT,
+    STATS_ALLOCATIONS,  // taken from the Alloc totals when reporting
+    STATS_TREE_LEAVES,
+    STATS_TREE_DEPTH,   // kept as a maximum rather than a sum
+    STATS_NUM_COUNTERS,
+} StatsCounter;
+
+/**
+ * Turns stats on if enable is true or HUFFMAN_STATS is set, starts the
+ * total timer and arranges for the JSON report at exit
+ */
+void StatsInit(char *progName, bool enable);
+
+/**
+ * Returns true if stats are being collected
+ */
+bool StatsEnabled(void);
+
+/**
+ * Starts or stops timing a phase
+ * Each StatsBegin must be matched by a StatsEnd of the same phase
+ */
+void StatsBegin(StatsPhase phase);
+void StatsEnd(StatsPhase phase);
+
+/**
+ * Adds n to a counter
+ */
+void StatsAdd(StatsCounter counter, uint64_t n);
+
+/**
+ * Raises a counter to value if it is lower
+ */
+void StatsMax(StatsCounter counter, uint64_t value);
+
+/**
+ * Records the number of leaves and the depth of the tree
+ */
+void StatsTreeShape(struct huffmanTree *tree);
+
+#endif
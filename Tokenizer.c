@@ -0,0 +1,35 @@
+// Implementation of the Tokenizer module
+
+#include <ctype.h>
+#include <stdbool.h>
+
+#include "Tokenizer.h"
+
+// Returns the number of bytes in the UTF-8 character starting at text
+int TokenCharLen(char *text) {
+    unsigned char byte1 = (unsigned char)text[0];
+    if ((byte1 & 0b10000000) == 0) {
+        return 1;
+    } else if ((byte1 & 0b11100000) == 0b11000000) {
+        return 2;
+    } else if ((byte1 & 0b11110000) == 0b11100000) {
+        return 3;
+    } else if ((byte1 & 0b11111000) == 0b11110000) {
+        return 4;
+    }
+    return 1;
+}
+
+// Returns the number of bytes in the word starting at text (ASCII letters only)
+int TokenWordLen(char *text) {
+    int len = 0;
+    while (isalpha((unsigned char)text[len])) {
+        len++;
+    }
+    return len;
+}
+
+// Single letters are already in the alphabet, and long words are spelled out
+bool TokenWordFits(int wordLen) {
+    return wordLen > 1 && wordLen <= MAX_WORD_LEN;
+}
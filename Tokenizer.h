@@ -0,0 +1,41 @@
+// Interface to the Tokenizer module that splits text into alphabet tokens
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stdbool.h>
+
+// Longest token (in bytes) that any alphabet mode can produce. Tree readers
+// must size their token buffers with this rather than MAX_TOKEN_LEN.
+#define MAX_WORD_LEN 32
+
+// Token of the escape leaf in pretrained trees. 0xFF never occurs in UTF-8
+// text, so it cannot clash with a real token.
+#define ESCAPE_TOKEN "\xff"
+
+// Words seen fewer times than this are spelled out character by character
+#define DEFAULT_MIN_WORD_FREQ 4
+
+typedef enum {
+    ALPHABET_CHARS, // one UTF-8 character per token
+    ALPHABET_WORDS, // whole words, with separators as single characters
+} AlphabetMode;
+
+/**
+ * Returns the number of bytes in the UTF-8 character starting at text,
+ * or 1 if the leading byte is not a valid UTF-8 leading byte
+ */
+int TokenCharLen(char *text);
+
+/**
+ * Returns the number of bytes in the run of word characters starting at
+ * text, or 0 if text does not start with a word character
+ */
+int TokenWordLen(char *text);
+
+/**
+ * Returns true if a word of the given length can be used as a single token
+ */
+bool TokenWordFits(int wordLen);
+
+#endif
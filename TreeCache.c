@@ -0,0 +1,235 @@
+// Implementation of the TreeCache module
+// Each entry is a file named after its key in HUFFMAN_CACHE_DIR. Entries are
+// written to a temporary file and renamed into place, so concurrent runs
+// never see a partial entry.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Alloc.h"
+#include "Codebook.h"
+#include "Counter.h"
+#include "FlatTree.h"
+#include "TreeCache.h"
+
+#define FNV_OFFSET 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+// Helper functions
+static uint64_t hashBytes(uint64_t hash, const void *bytes, size_t len);
+static int compareItemsByToken(const void *a, const void *b);
+static int logBucket(uint64_t total, uint64_t freq);
+static char *entryPath(uint64_t key, char *suffix);
+static FILE *openEntryForWriting(uint64_t key, char *suffix, char **tmpPath);
+static void commitEntry(FILE *fp, uint64_t key, char *suffix, char *tmpPath);
+static bool copyStream(FILE *from, FILE *to);
+
+// Returns true if the cache directory is set
+bool TreeCacheEnabled(void) {
+    char *dir = getenv("HUFFMAN_CACHE_DIR");
+    return dir != NULL && dir[0] != '\0';
+}
+
+// Hashes the tokens in order along with their rounded code lengths
+uint64_t TreeCacheHistogramKey(Counter c) {
+    int numItems;
+    struct item *items = CounterItems(c, &numItems);
+    qsort(items, numItems, sizeof(struct item), compareItemsByToken);
+
+    uint64_t total = 0;
+    for (int i = 0; i < numItems; i++) {
+        total += items[i].freq;
+    }
+
+    uint64_t hash = FNV_OFFSET;
+    for (int i = 0; i < numItems; i++) {
+        int32_t bucket = logBucket(total, items[i].freq);
+        hash = hashBytes(hash, items[i].token, strlen(items[i].token) + 1);
+        hash = hashBytes(hash, &bucket, sizeof(bucket));
+    }
+    CounterFreeItems(items, numItems);
+    return hash;
+}
+
+// Hashes the contents of the file
+uint64_t TreeCacheFileKey(char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "error: failed to open '%s' for reading\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t hash = FNV_OFFSET;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        hash = hashBytes(hash, buffer, n);
+    }
+    fclose(fp);
+    return hash;
+}
+
+// Copies a cached tree file to treeFilename
+bool TreeCacheGetTreeFile(uint64_t key, char *treeFilename) {
+    char *path = entryPath(key, "tree");
+    FILE *from = path != NULL ? fopen(path, "rb") : NULL;
+    AllocFree(ALLOC_IO, path);
+    if (from == NULL) {
+        return false;
+    }
+
+    FILE *to = fopen(treeFilename, "wb");
+    if (to == NULL) {
+        fprintf(stderr, "error: failed to open '%s' for writing\n", treeFilename);
+        exit(EXIT_FAILURE);
+    }
+    bool ok = copyStream(from, to);
+    fclose(from);
+    fclose(to);
+    return ok;
+}
+
+// Caches a copy of a tree file
+void TreeCachePutTreeFile(uint64_t key, char *treeFilename) {
+    char *tmpPath;
+    FILE *to = openEntryForWriting(key, "tree", &tmpPath);
+    if (to == NULL) {
+        return;
+    }
+    FILE *from = fopen(treeFilename, "rb");
+    if (from == NULL || !copyStream(from, to)) {
+        fclose(to);
+        unlink(tmpPath);
+        AllocFree(ALLOC_IO, tmpPath);
+        if (from != NULL) {
+            fclose(from);
+        }
+        return;
+    }
+    fclose(from);
+    commitEntry(to, key, "tree", tmpPath);
+}
+
+// Returns a cached codebook
+Codebook TreeCacheGetCodebook(uint64_t key) {
+    char *path = entryPath(key, "cb");
+    FILE *fp = path != NULL ? fopen(path, "rb") : NULL;
+    AllocFree(ALLOC_IO, path);
+    if (fp == NULL) {
+        return NULL;
+    }
+    Codebook cb = CodebookRead(fp);
+    fclose(fp);
+    return cb;
+}
+
+// Caches a codebook
+void TreeCachePutCodebook(uint64_t key, Codebook cb) {
+    char *tmpPath;
+    FILE *fp = openEntryForWriting(key, "cb", &tmpPath);
+    if (fp != NULL) {
+        CodebookWrite(cb, fp);
+        commitEntry(fp, key, "cb", tmpPath);
+    }
+}
+
+// Returns a cached flat tree, mapped rather than read
+FlatTree TreeCacheGetFlatTree(uint64_t key) {
+    char *path = entryPath(key, "dt");
+    if (path == NULL) {
+        return NULL;
+    }
+    FlatTree ft = FlatTreeMap(path);
+    AllocFree(ALLOC_IO, path);
+    return ft;
+}
+
+// Caches a flat tree
+void TreeCachePutFlatTree(uint64_t key, FlatTree ft) {
+    char *tmpPath;
+    FILE *fp = openEntryForWriting(key, "dt", &tmpPath);
+    if (fp != NULL) {
+        FlatTreeWrite(ft, fp);
+        commitEntry(fp, key, "dt", tmpPath);
+    }
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// FNV-1a over the bytes, continuing from the given hash
+static uint64_t hashBytes(uint64_t hash, const void *bytes, size_t len) {
+    const unsigned char *p = bytes;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static int compareItemsByToken(const void *a, const void *b) {
+    return strcmp(((struct item *)a)->token, ((struct item *)b)->token);
+}
+
+// Returns -log2(freq / total) in quarter bits, using the position of the
+// leading bit and the two bits after it as a piecewise linear logarithm
+static int logBucket(uint64_t total, uint64_t freq) {
+    uint64_t ratio = (total << 8) / freq;
+    int msb = 63 - __builtin_clzll(ratio);
+    return msb * 4 + (int)((ratio >> (msb - 2)) & 3);
+}
+
+// Returns the path of the entry, or NULL if the cache is disabled
+static char *entryPath(uint64_t key, char *suffix) {
+    if (!TreeCacheEnabled()) {
+        return NULL;
+    }
+    char *dir = getenv("HUFFMAN_CACHE_DIR");
+    size_t size = strlen(dir) + strlen(suffix) + 32;
+    char *path = AllocMalloc(ALLOC_IO, size);
+    snprintf(path, size, "%s/%016llx.%s", dir, (unsigned long long)key, suffix);
+    return path;
+}
+
+// Opens a temporary file next to the entry, or returns NULL if the cache is
+// disabled or not writable
+static FILE *openEntryForWriting(uint64_t key, char *suffix, char **tmpPath) {
+    char *path = entryPath(key, suffix);
+    if (path == NULL) {
+        return NULL;
+    }
+    size_t size = strlen(path) + 32;
+    *tmpPath = AllocMalloc(ALLOC_IO, size);
+    snprintf(*tmpPath, size, "%s.%ld.tmp", path, (long)getpid());
+    AllocFree(ALLOC_IO, path);
+
+    FILE *fp = fopen(*tmpPath, "wb");
+    if (fp == NULL) {
+        AllocFree(ALLOC_IO, *tmpPath);
+    }
+    return fp;
+}
+
+// Closes the temporary file and renames it into place
+static void commitEntry(FILE *fp, uint64_t key, char *suffix, char *tmpPath) {
+    char *path = entryPath(key, suffix);
+    if (fclose(fp) != 0 || rename(tmpPath, path) != 0) {
+        unlink(tmpPath);
+    }
+    AllocFree(ALLOC_IO, path);
+    AllocFree(ALLOC_IO, tmpPath);
+}
+
+static bool copyStream(FILE *from, FILE *to) {
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), from)) > 0) {
+        if (fwrite(buffer, 1, n, to) != n) {
+            return false;
+        }
+    }
+    return !ferror(from);
+}
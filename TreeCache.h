@@ -0,0 +1,68 @@
+// Interface to the TreeCache module, a local on-disk cache of huffman trees
+// and the tables built from them
+//
+// The cache is enabled by setting HUFFMAN_CACHE_DIR to a directory. Trees are
+// keyed by a fingerprint of the histogram they were built from, and
+// codebooks (encode tables) and flat trees (decode tables) by a hash of the
+// tree file they were built from. Every function does nothing, or reports a
+// miss, when the cache is disabled.
+
+#ifndef TREE_CACHE_H
+#define TREE_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Codebook.h"
+#include "Counter.h"
+#include "FlatTree.h"
+
+/**
+ * Returns true if HUFFMAN_CACHE_DIR is set
+ */
+bool TreeCacheEnabled(void);
+
+/**
+ * Returns a fingerprint of the counter's tokens and their relative
+ * frequencies. Frequencies are rounded to a quarter of a bit of ideal code
+ * length, so near-identical distributions share a fingerprint (and a tree).
+ */
+uint64_t TreeCacheHistogramKey(Counter c);
+
+/**
+ * Returns a hash of the contents of the file
+ */
+uint64_t TreeCacheFileKey(char *filename);
+
+/**
+ * Copies the tree file cached under the key to treeFilename
+ * Returns false on a miss
+ */
+bool TreeCacheGetTreeFile(uint64_t key, char *treeFilename);
+
+/**
+ * Caches a copy of the tree file under the key
+ */
+void TreeCachePutTreeFile(uint64_t key, char *treeFilename);
+
+/**
+ * Returns the codebook cached under the key, or NULL on a miss
+ */
+Codebook TreeCacheGetCodebook(uint64_t key);
+
+/**
+ * Caches the codebook under the key
+ */
+void TreeCachePutCodebook(uint64_t key, Codebook cb);
+
+/**
+ * Returns the flat tree cached under the key, or NULL on a miss
+ */
+FlatTree TreeCacheGetFlatTree(uint64_t key);
+
+/**
+ * Caches the flat tree under the key
+ */
+void TreeCachePutFlatTree(uint64_t key, FlatTree ft);
+
+#endif
@@ -0,0 +1,253 @@
+// Implementation of the TreeIO module
+//
+// Parsing makes two passes over the text. The first counts the leaves,
+// which fixes the number of nodes (2 * leaves - 1) and bounds the token
+// bytes, so the second pass can build the tree inside one block: the node
+// array, root first, followed by the NUL-terminated tokens.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "Alloc.h"
+#include "Stats.h"
+#include "TreeIO.h"
+
+// Structs definition
+struct writeFrame {
+    struct huffmanTree *node;
+    bool inRight;               // the left subtree and ',' are written
+};
+
+// Helper functions
+static size_t countLeaves(const char *text, size_t len);
+static size_t parseToken(const char *text, size_t len, size_t pos, char *token);
+static char *readFile(char *filename, size_t *len);
+static void writeToken(const char *token, FILE *fp);
+
+// Parses the tree iteratively, keeping the open internal nodes on a stack
+struct huffmanTree *TreeIOParse(const char *text, size_t len) {
+    if (len == 0) {
+        return NULL;
+    }
+    size_t numLeaves = countLeaves(text, len);
+    size_t numNodes = 2 * numLeaves - 1;
+    size_t nodesSize = numNodes * sizeof(struct huffmanTree);
+    struct huffmanTree *nodes = AllocMalloc(ALLOC_TREE, nodesSize + len + numLeaves);
+    struct huffmanTree **stack = AllocMalloc(ALLOC_TREE, numNodes * sizeof(struct huffmanTree *));
+    char *tokens = (char *)nodes + nodesSize;
+
+    size_t used = 0;
+    size_t top = 0;
+    size_t pos = 0;
+    struct huffmanTree **slot = NULL;
+    bool ok = true;
+    while (ok) {
+        if (used == numNodes) {
+            ok = false;
+            break;
+        }
+        struct huffmanTree *t = &nodes[used++];
+        t->freq = 0;
+        t->left = NULL;
+        t->right = NULL;
+        t->token = NULL;
+        if (slot != NULL) {
+            *slot = t;
+        }
+
+        // An internal node waits on the stack until its ')' is reached
+        if (pos < len && text[pos] == '(') {
+            stack[top++] = t;
+            slot = &t->left;
+            pos++;
+            continue;
+        }
+
+        t->token = tokens;
+        pos = parseToken(text, len, pos, tokens);
+        tokens += strlen(tokens) + 1;
+
+        // Close every node whose right subtree this leaf completed, then move
+        // on to the right subtree of the innermost node still open
+        slot = NULL;
+        while (top > 0) {
+            struct huffmanTree *parent = stack[top - 1];
+            if (parent->right == NULL && pos < len && text[pos] == ',') {
+                slot = &parent->right;
+                pos++;
+                break;
+            } else if (parent->right != NULL && pos < len && text[pos] == ')') {
+                top--;
+                pos++;
+            } else {
+                ok = false;
+                break;
+            }
+        }
+        if (slot == NULL) {
+            break;
+        }
+    }
+
+    // Only a trailing newline may follow the root
+    while (pos < len && (text[pos] == '\n' || text[pos] == '\r')) {
+        pos++;
+    }
+
+    AllocFree(ALLOC_TREE, stack);
+    if (!ok || top > 0 || used != numNodes || pos != len) {
+        AllocFree(ALLOC_TREE, nodes);
+        return NULL;
+    }
+    return nodes;
+}
+
+// Reads the whole file into memory and parses it
+struct huffmanTree *TreeIOLoad(char *filename) {
+    size_t len;
+    char *text = readFile(filename, &len);
+    if (text == NULL) {
+        return NULL;
+    }
+    StatsBegin(STATS_READ_TREE);
+    struct huffmanTree *tree = TreeIOParse(text, len);
+    StatsEnd(STATS_READ_TREE);
+    AllocFree(ALLOC_IO, text);
+    return tree;
+}
+
+struct huffmanTree *TreeIORead(char *filename) {
+    struct huffmanTree *tree = TreeIOLoad(filename);
+    if (tree == NULL) {
+        FILE *fp = fopen(filename, "r");
+        if (fp == NULL) {
+            fprintf(stderr, "error: failed to open '%s' for reading\n", filename);
+        } else {
+            fprintf(stderr, "error: '%s' is not a valid huffman tree\n", filename);
+            fclose(fp);
+        }
+        exit(EXIT_FAILURE);
+    }
+    return tree;
+}
+
+// The root is the start of the block holding the whole tree
+void TreeIOFree(struct huffmanTree *tree) {
+    AllocFree(ALLOC_TREE, tree);
+}
+
+// Writes the tree iteratively, keeping the internal nodes whose ')' is still
+// to come on a stack
+void TreeIOWrite(struct huffmanTree *tree, FILE *fp) {
+    size_t cap = 64;
+    size_t top = 0;
+    struct writeFrame *stack = AllocMalloc(ALLOC_TREE, cap * sizeof(struct writeFrame));
+    struct huffmanTree *t = tree;
+    while (true) {
+        if (t->left == NULL && t->right == NULL) {
+            writeToken(t->token, fp);
+        } else if (t->left == NULL || t->right == NULL) {
+            fprintf(
+                stderr,
+                "error: found node with exactly one child\n"
+                "       all nodes should have zero or two children\n"
+            );
+            exit(EXIT_FAILURE);
+        } else {
+            if (top == cap) {
+                cap *= 2;
+                stack = AllocRealloc(ALLOC_TREE, stack, cap * sizeof(struct writeFrame));
+            }
+            stack[top++] = (struct writeFrame){t, false};
+            fputc('(', fp);
+            t = t->left;
+            continue;
+        }
+
+        // Close every node whose right subtree is done, then start on the
+        // right subtree of the innermost node left open
+        while (top > 0 && stack[top - 1].inRight) {
+            fputc(')', fp);
+            top--;
+        }
+        if (top == 0) {
+            break;
+        }
+        stack[top - 1].inRight = true;
+        fputc(',', fp);
+        t = stack[top - 1].node->right;
+    }
+    AllocFree(ALLOC_TREE, stack);
+}
+
+void TreeIOSave(struct huffmanTree *tree, char *filename) {
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "error: failed to open '%s' for writing\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    TreeIOWrite(tree, fp);
+    if (ferror(fp) || fclose(fp) != 0) {
+        fprintf(stderr, "error: failed to write '%s'\n", filename);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Every unescaped ',' separates two subtrees, so there is one more leaf
+// than there are commas
+static size_t countLeaves(const char *text, size_t len) {
+    size_t numLeaves = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == '\\') {
+            i++;
+        } else if (text[i] == ',') {
+            numLeaves++;
+        }
+    }
+    return numLeaves;
+}
+
+// Copies the unescaped token starting at pos into token and returns the
+// position of the ',' or ')' that ends it
+static size_t parseToken(const char *text, size_t len, size_t pos, char *token) {
+    size_t n = 0;
+    while (pos < len && text[pos] != ',' && text[pos] != ')') {
+        if (text[pos] == '\\' && pos + 1 < len) {
+            pos++;
+        }
+        token[n++] = text[pos++];
+    }
+    token[n] = '\0';
+    return pos;
+}
+
+static char *readFile(char *filename, size_t *len) {
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseeko(fp, 0, SEEK_END);
+    off_t size = ftello(fp);
+    fseeko(fp, 0, SEEK_SET);
+
+    char *text = AllocMalloc(ALLOC_IO, size);
+    *len = fread(text, 1, size, fp);
+    fclose(fp);
+    return text;
+}
+
+// Writes a leaf's token with '(', ')', ',' and '\' escaped
+static void writeToken(const char *token, FILE *fp) {
+    for (int i = 0; token[i] != '\0'; i++) {
+        char c = token[i];
+        if (c == '(' || c == ')' || c == ',' || c == '\\') {
+            fputc('\\', fp);
+        }
+        fputc(c, fp);
+    }
+}
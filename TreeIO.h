@@ -0,0 +1,55 @@
+// Interface to the TreeIO module that loads and saves huffman tree files
+//
+// A tree file is written as "(left,right)" for internal nodes and the
+// token itself for leaves, with '(', ')', ',' and '\' escaped by a '\'.
+// The parser works on the whole file in memory without recursion, so
+// degenerate trees of any depth load in bounded stack space, and puts every
+// node and token of the tree in a single allocation. The writer does not
+// recurse either.
+
+#ifndef TREE_IO_H
+#define TREE_IO_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "huffman.h"
+
+/**
+ * Parses a tree from len bytes of text
+ * Returns NULL if the text is not a well-formed tree
+ * The tree must be freed with TreeIOFree
+ */
+struct huffmanTree *TreeIOParse(const char *text, size_t len);
+
+/**
+ * Reads and parses a tree file
+ * Returns NULL if the file cannot be read or is not a well-formed tree
+ * The tree must be freed with TreeIOFree
+ */
+struct huffmanTree *TreeIOLoad(char *filename);
+
+/**
+ * Reads and parses a tree file, exiting with an error message on failure
+ * The tree must be freed with TreeIOFree
+ */
+struct huffmanTree *TreeIORead(char *filename);
+
+/**
+ * Frees a tree returned by this module
+ * Trees built in any other way must not be passed to this function
+ */
+void TreeIOFree(struct huffmanTree *tree);
+
+/**
+ * Writes a tree to the stream in the tree file format
+ * Exits with an error message if a node has exactly one child
+ */
+void TreeIOWrite(struct huffmanTree *tree, FILE *fp);
+
+/**
+ * Writes a tree to a tree file, exiting with an error message on failure
+ */
+void TreeIOSave(struct huffmanTree *tree, char *filename);
+
+#endif
@@ -0,0 +1,238 @@
+// Implementation of the WorkPool ADT
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Alloc.h"
+#include "WorkPool.h"
+
+#define INITIAL_DEQUE_SIZE 64
+
+// Structs definition
+struct task {
+    WorkFn fn;
+    void *arg;
+};
+
+// Tasks live in a circular array between top (oldest) and bottom (newest)
+struct deque {
+    struct task *tasks;
+    size_t size;
+    size_t top;
+    size_t bottom;
+    pthread_mutex_t lock;
+};
+
+struct worker {
+    WorkPool pool;
+    int index;
+    pthread_t thread;
+    struct deque deque;
+};
+
+struct workPool {
+    int numWorkers;
+    struct worker *workers;
+
+    // Guards the counts below, which let idle workers sleep instead of spin
+    pthread_mutex_t lock;
+    pthread_cond_t workAvailable;
+    pthread_cond_t allDone;
+    size_t numQueued;
+    size_t numPending;
+    size_t nextExternal;
+    bool stopping;
+};
+
+// The worker running on the current thread, or NULL outside the pool
+static __thread struct worker *currentWorker = NULL;
+
+// Helper functions
+static void *runWorker(void *arg);
+static bool takeTask(WorkPool pool, struct worker *self, struct task *task);
+static void pushBottom(struct deque *d, struct task task);
+static bool popBottom(struct deque *d, struct task *task);
+static bool popTop(struct deque *d, struct task *task);
+
+// Starts the worker threads
+WorkPool WorkPoolNew(int numWorkers) {
+    if (numWorkers < 1) {
+        numWorkers = 1;
+    }
+
+    WorkPool pool = AllocMalloc(ALLOC_POOL, sizeof(struct workPool));
+    struct worker *workers = AllocMalloc(ALLOC_POOL, numWorkers * sizeof(struct worker));
+    pool->numWorkers = numWorkers;
+    pool->workers = workers;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->workAvailable, NULL);
+    pthread_cond_init(&pool->allDone, NULL);
+    pool->numQueued = 0;
+    pool->numPending = 0;
+    pool->nextExternal = 0;
+    pool->stopping = false;
+
+    for (int i = 0; i < numWorkers; i++) {
+        struct deque *d = &workers[i].deque;
+        d->tasks = AllocMalloc(ALLOC_POOL, INITIAL_DEQUE_SIZE * sizeof(struct task));
+        d->size = INITIAL_DEQUE_SIZE;
+        d->top = 0;
+        d->bottom = 0;
+        pthread_mutex_init(&d->lock, NULL);
+        workers[i].pool = pool;
+        workers[i].index = i;
+    }
+
+    // Threads start only once every deque exists, since any of them may steal
+    for (int i = 0; i < numWorkers; i++) {
+        if (pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]) != 0) {
+            fprintf(stderr, "error: failed to start worker thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+// Stops the workers and frees the pool
+void WorkPoolFree(WorkPool pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->workAvailable);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->numWorkers; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+        pthread_mutex_destroy(&pool->workers[i].deque.lock);
+        AllocFree(ALLOC_POOL, pool->workers[i].deque.tasks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->workAvailable);
+    pthread_cond_destroy(&pool->allDone);
+    AllocFree(ALLOC_POOL, pool->workers);
+    AllocFree(ALLOC_POOL, pool);
+}
+
+// Queues a task on the current worker, or spreads tasks from outside the
+// pool round robin over the workers
+void WorkPoolSubmit(WorkPool pool, WorkFn fn, void *arg) {
+    struct worker *w = currentWorker;
+    if (w == NULL || w->pool != pool) {
+        pthread_mutex_lock(&pool->lock);
+        w = &pool->workers[pool->nextExternal++ % pool->numWorkers];
+        pthread_mutex_unlock(&pool->lock);
+    }
+    pushBottom(&w->deque, (struct task){fn, arg});
+
+    pthread_mutex_lock(&pool->lock);
+    pool->numQueued++;
+    pool->numPending++;
+    pthread_cond_signal(&pool->workAvailable);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Waits for every pending task to finish
+void WorkPoolWait(WorkPool pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->numPending > 0) {
+        pthread_cond_wait(&pool->allDone, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int WorkPoolNumWorkers(WorkPool pool) {
+    return pool->numWorkers;
+}
+
+// -------------------------------------------- Helper Functions --------------------------------------------
+
+// Runs tasks until the pool stops, sleeping while there is nothing to do
+static void *runWorker(void *arg) {
+    struct worker *self = arg;
+    WorkPool pool = self->pool;
+    currentWorker = self;
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->numQueued == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->workAvailable, &pool->lock);
+        }
+        if (pool->numQueued == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        // Claim a task before searching. Tasks are pushed before they are
+        // counted, so there is always one for us, though a racing worker may
+        // take the one we saw first and make us scan again
+        pool->numQueued--;
+        pthread_mutex_unlock(&pool->lock);
+
+        struct task task;
+        while (!takeTask(pool, self, &task)) {
+            sched_yield();
+        }
+        task.fn(pool, task.arg);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->numPending == 0) {
+            pthread_cond_broadcast(&pool->allDone);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+// Takes the newest task of our own deque, or steals the oldest task of
+// another worker's deque
+static bool takeTask(WorkPool pool, struct worker *self, struct task *task) {
+    if (popBottom(&self->deque, task)) {
+        return true;
+    }
+    for (int i = 1; i < pool->numWorkers; i++) {
+        struct worker *victim = &pool->workers[(self->index + i) % pool->numWorkers];
+        if (popTop(&victim->deque, task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void pushBottom(struct deque *d, struct task task) {
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom - d->top == d->size) {
+        // Unwrap the full circular array into one twice the size
+        struct task *tasks = AllocMalloc(ALLOC_POOL, 2 * d->size * sizeof(struct task));
+        for (size_t i = d->top; i < d->bottom; i++) {
+            tasks[i - d->top] = d->tasks[i % d->size];
+        }
+        AllocFree(ALLOC_POOL, d->tasks);
+        d->tasks = tasks;
+        d->bottom -= d->top;
+        d->top = 0;
+        d->size *= 2;
+    }
+    d->tasks[d->bottom++ % d->size] = task;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static bool popBottom(struct deque *d, struct task *task) {
+    pthread_mutex_lock(&d->lock);
+    bool found = d->bottom > d->top;
+    if (found) {
+        *task = d->tasks[--d->bottom % d->size];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+static bool popTop(struct deque *d, struct task *task) {
+    pthread_mutex_lock(&d->lock);
+    bool found = d->bottom > d->top;
+    if (found) {
+        *task = d->tasks[d->top++ % d->size];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
@@ -0,0 +1,47 @@
+// Interface to the WorkPool ADT: a fixed set of worker threads that run
+// submitted tasks, balancing load by work stealing
+//
+// Every worker owns a deque. Tasks submitted from inside a task go to the
+// bottom of the running worker's deque and are taken back LIFO, so a task's
+// sub-tasks run on the same core while their data is still in cache. Idle
+// workers steal the oldest task from the top of another worker's deque,
+// which tends to be the largest remaining piece of work.
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+typedef struct workPool *WorkPool;
+
+typedef void (*WorkFn)(WorkPool pool, void *arg);
+
+/**
+ * Starts a pool of numWorkers threads
+ * The pool must be freed with WorkPoolFree
+ */
+WorkPool WorkPoolNew(int numWorkers);
+
+/**
+ * Stops the workers and frees the pool
+ * Assumes that no tasks are pending (see WorkPoolWait)
+ */
+void WorkPoolFree(WorkPool pool);
+
+/**
+ * Queues fn(pool, arg) to run on some worker
+ * May be called from outside the pool or from a running task
+ */
+void WorkPoolSubmit(WorkPool pool, WorkFn fn, void *arg);
+
+/**
+ * Blocks until every submitted task, including tasks submitted by other
+ * tasks, has finished
+ * Must not be called from a running task
+ */
+void WorkPoolWait(WorkPool pool);
+
+/**
+ * Returns the number of worker threads in the pool
+ */
+int WorkPoolNumWorkers(WorkPool pool);
+
+#endif
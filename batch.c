@@ -0,0 +1,412 @@
+// Main program for building trees and encodings for many files at once
+//
+// For every input file name.txt, writes name.tree and name.enc into the
+// output directory, exactly as "encode name.txt name.tree" followed by
+// "encode name.txt name.tree name.enc" would. All files are processed in one
+// process on a work-stealing pool; files larger than a chunk are counted and
+// encoded chunk by chunk so a single big file still keeps every core busy.
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "Alloc.h"
+#include "BitIO.h"
+#include "Counter.h"
+#include "File.h"
+#include "HuffmanCodec.h"
+#include "Tokenizer.h"
+#include "TreeIO.h"
+#include "WorkPool.h"
+#include "huffman.h"
+
+#define CHUNK_SIZE (1 << 20)
+
+// Structs definition
+struct job;
+
+struct chunk {
+	struct job *job;
+	size_t start;
+	size_t len;
+	Counter counter;
+	char *encoding;
+};
+
+struct job {
+	char *inputFilename;
+	char *treeFilename;
+	char *encodingFilename;
+	bool words;
+
+	char *text;
+	size_t len;
+	HuffmanCodec codec;
+
+	int numChunks;
+	struct chunk *chunks;
+	atomic_int remaining;
+};
+
+static atomic_bool failed = false;
+
+static void loadFile(WorkPool pool, void *arg);
+static void countChunk(WorkPool pool, void *arg);
+static void buildTree(WorkPool pool, struct job *job);
+static void encodeChunk(WorkPool pool, void *arg);
+static void writeEncodingFile(struct job *job);
+static void splitChunks(struct job *job);
+static void freeJob(struct job *job);
+static void fail(struct job *job, char *message);
+
+static int addInputs(WorkPool pool, char *path, char *outputDir, bool words);
+static int addListedInputs(WorkPool pool, char *listFilename, char *outputDir,
+                           bool words);
+static void addJob(WorkPool pool, char *inputFilename, char *outputDir, bool words);
+static char *concat(char *a, char *b, char *c);
+static void usage(char *progName);
+
+int main(int argc, char *argv[]) {
+	char *progName = argv[0];
+	AllocInit("batch");
+	long numWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+	bool words = false;
+	char *listFilename = NULL;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "j:wl:")) != -1) {
+		if (opt == 'j') {
+			numWorkers = atol(optarg);
+		} else if (opt == 'w') {
+			words = true;
+		} else if (opt == 'l') {
+			listFilename = optarg;
+		} else {
+			usage(progName);
+		}
+	}
+	if (optind >= argc || numWorkers < 1 ||
+			(listFilename == NULL && optind + 1 >= argc)) {
+		usage(progName);
+	}
+
+	char *outputDir = argv[optind];
+	if (mkdir(outputDir, 0777) != 0 && access(outputDir, W_OK) != 0) {
+		fprintf(stderr, "error: failed to create '%s'\n", outputDir);
+		exit(EXIT_FAILURE);
+	}
+
+	WorkPool pool = WorkPoolNew(numWorkers);
+	int numFiles = 0;
+	if (listFilename != NULL) {
+		numFiles += addListedInputs(pool, listFilename, outputDir, words);
+	}
+	for (int i = optind + 1; i < argc; i++) {
+		numFiles += addInputs(pool, argv[i], outputDir, words);
+	}
+	WorkPoolWait(pool);
+	WorkPoolFree(pool);
+
+	if (numFiles == 0) {
+		fprintf(stderr, "error: no input files\n");
+		exit(EXIT_FAILURE);
+	}
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Jobs: load, count each chunk, build the tree, encode each chunk, write
+
+// Reads the whole file and queues a count task per chunk
+static void loadFile(WorkPool pool, void *arg) {
+	struct job *job = arg;
+	FILE *fp = fopen(job->inputFilename, "r");
+	if (fp == NULL) {
+		fail(job, "failed to open for reading");
+		return;
+	}
+	fseeko(fp, 0, SEEK_END);
+	off_t size = ftello(fp);
+	fseeko(fp, 0, SEEK_SET);
+	job->text = AllocMalloc(ALLOC_IO, size + 1);
+	job->len = fread(job->text, 1, size, fp);
+	job->text[job->len] = '\0';
+	fclose(fp);
+
+	splitChunks(job);
+
+	// Word alphabets need the frequency of every word in the whole file
+	// before any token can be counted, so they are counted in one piece
+	if (job->words) {
+		Counter c = countWordTokens(job->inputFilename, DEFAULT_MIN_WORD_FREQ);
+		job->chunks[0].counter = c;
+		for (int i = 1; i < job->numChunks; i++) {
+			job->chunks[i].counter = NULL;
+		}
+		buildTree(pool, job);
+		return;
+	}
+
+	atomic_store(&job->remaining, job->numChunks);
+	for (int i = 0; i < job->numChunks; i++) {
+		WorkPoolSubmit(pool, countChunk, &job->chunks[i]);
+	}
+}
+
+// Counts the characters of one chunk; the last chunk to finish builds the tree
+static void countChunk(WorkPool pool, void *arg) {
+	struct chunk *chunk = arg;
+	uint64_t numTokens;
+	chunk->counter = countTextTokens(&chunk->job->text[chunk->start], chunk->len, &numTokens);
+
+	if (atomic_fetch_sub(&chunk->job->remaining, 1) == 1) {
+		buildTree(pool, chunk->job);
+	}
+}
+
+// Merges the chunk histograms, writes the tree and queues an encode task
+// per chunk
+static void buildTree(WorkPool pool, struct job *job) {
+	Counter c = job->chunks[0].counter;
+	for (int i = 1; i < job->numChunks; i++) {
+		int numItems;
+		struct item *items = CounterItems(job->chunks[i].counter, &numItems);
+		for (int j = 0; j < numItems; j++) {
+			CounterAddCount(c, items[j].token, items[j].freq);
+		}
+		CounterFreeItems(items, numItems);
+		CounterFree(job->chunks[i].counter);
+		job->chunks[i].counter = NULL;
+	}
+
+	struct huffmanTree *tree = createHuffmanTreeFromCounter(c);
+	CounterFree(c);
+	job->chunks[0].counter = NULL;
+	if (tree == NULL) {
+		fail(job, "file is empty");
+		return;
+	}
+	TreeIOSave(tree, job->treeFilename);
+	job->codec = CodecNewFromTree(tree);
+	destroyHuffmanTree(tree);
+
+	atomic_store(&job->remaining, job->numChunks);
+	for (int i = 0; i < job->numChunks; i++) {
+		WorkPoolSubmit(pool, encodeChunk, &job->chunks[i]);
+	}
+}
+
+// Encodes one chunk; the last chunk to finish writes the encoding file
+static void encodeChunk(WorkPool pool, void *arg) {
+	(void)pool;
+	struct chunk *chunk = arg;
+	struct job *job = chunk->job;
+
+	size_t cap = CodecMaxEncodedSize(job->codec, chunk->len);
+	unsigned char *bits = AllocMalloc(ALLOC_BUFFER, cap);
+	int64_t numBits = CodecEncode(job->codec, &job->text[chunk->start],
+	                              chunk->len, bits, cap);
+	if (numBits >= 0) {
+		chunk->encoding = AllocMalloc(ALLOC_BUFFER, numBits + 1);
+		BitsToText(bits, numBits, chunk->encoding);
+	}
+	AllocFree(ALLOC_BUFFER, bits);
+
+	if (atomic_fetch_sub(&job->remaining, 1) == 1) {
+		writeEncodingFile(job);
+	}
+}
+
+// Writes the chunk encodings in order
+static void writeEncodingFile(struct job *job) {
+	for (int i = 0; i < job->numChunks; i++) {
+		if (job->chunks[i].encoding == NULL) {
+			fail(job, "token is not in the huffman tree");
+			return;
+		}
+	}
+
+	FILE *fp = fopen(job->encodingFilename, "w");
+	if (fp == NULL) {
+		fail(job, "failed to open the encoding file for writing");
+		return;
+	}
+	for (int i = 0; i < job->numChunks; i++) {
+		fputs(job->chunks[i].encoding, fp);
+	}
+	fclose(fp);
+	freeJob(job);
+}
+
+// Splits the text into chunks of about CHUNK_SIZE bytes, moving each cut
+// forward so it never falls inside a UTF-8 character or, for word alphabets,
+// inside a word
+static void splitChunks(struct job *job) {
+	job->numChunks = job->len / CHUNK_SIZE + 1;
+	job->chunks = AllocMalloc(ALLOC_POOL, job->numChunks * sizeof(struct chunk));
+	memset(job->chunks, 0, job->numChunks * sizeof(struct chunk));
+
+	size_t start = 0;
+	int n = 0;
+	while (n < job->numChunks) {
+		size_t end = start + CHUNK_SIZE;
+		if (end >= job->len || n == job->numChunks - 1) {
+			end = job->len;
+		} else {
+			while (end < job->len && (job->text[end] & 0xC0) == 0x80) {
+				end++;
+			}
+			while (job->words && end < job->len &&
+					isalpha((unsigned char)job->text[end]) &&
+					isalpha((unsigned char)job->text[end - 1])) {
+				end++;
+			}
+		}
+		job->chunks[n].job = job;
+		job->chunks[n].start = start;
+		job->chunks[n].len = end - start;
+		n++;
+		start = end;
+		if (start == job->len) {
+			break;
+		}
+	}
+	job->numChunks = n;
+}
+
+static void freeJob(struct job *job) {
+	for (int i = 0; i < job->numChunks; i++) {
+		CounterFree(job->chunks[i].counter);
+		AllocFree(ALLOC_BUFFER, job->chunks[i].encoding);
+	}
+	AllocFree(ALLOC_POOL, job->chunks);
+	if (job->codec != NULL) {
+		CodecFree(job->codec);
+	}
+	AllocFree(ALLOC_IO, job->text);
+	AllocFree(ALLOC_POOL, job->inputFilename);
+	AllocFree(ALLOC_POOL, job->treeFilename);
+	AllocFree(ALLOC_POOL, job->encodingFilename);
+	AllocFree(ALLOC_POOL, job);
+}
+
+// Reports a failed file and abandons its job
+static void fail(struct job *job, char *message) {
+	fprintf(stderr, "error: '%s': %s\n", job->inputFilename, message);
+	atomic_store(&failed, true);
+	freeJob(job);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Queues the file, or every .txt file in the directory
+static int addInputs(WorkPool pool, char *path, char *outputDir, bool words) {
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		fprintf(stderr, "error: failed to open '%s' for reading\n", path);
+		exit(EXIT_FAILURE);
+	}
+	if (!S_ISDIR(st.st_mode)) {
+		addJob(pool, path, outputDir, words);
+		return 1;
+	}
+
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		fprintf(stderr, "error: failed to open '%s' for reading\n", path);
+		exit(EXIT_FAILURE);
+	}
+	int numFiles = 0;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		size_t len = strlen(entry->d_name);
+		if (len > 4 && strcmp(&entry->d_name[len - 4], ".txt") == 0) {
+			char *filename = concat(path, "/", entry->d_name);
+			addJob(pool, filename, outputDir, words);
+			AllocFree(ALLOC_POOL, filename);
+			numFiles++;
+		}
+	}
+	closedir(dir);
+	return numFiles;
+}
+
+// Queues every file named in the list, one per line; "-" reads stdin
+static int addListedInputs(WorkPool pool, char *listFilename, char *outputDir,
+                           bool words) {
+	FILE *fp = strcmp(listFilename, "-") == 0 ? stdin : fopen(listFilename, "r");
+	if (fp == NULL) {
+		fprintf(stderr, "error: failed to open '%s' for reading\n", listFilename);
+		exit(EXIT_FAILURE);
+	}
+
+	int numFiles = 0;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	while ((len = getline(&line, &size, fp)) != -1) {
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+			line[--len] = '\0';
+		}
+		if (len > 0) {
+			addJob(pool, line, outputDir, words);
+			numFiles++;
+		}
+	}
+	free(line);
+	if (fp != stdin) {
+		fclose(fp);
+	}
+	return numFiles;
+}
+
+static void addJob(WorkPool pool, char *inputFilename, char *outputDir, bool words) {
+	struct job *job = AllocMalloc(ALLOC_POOL, sizeof(struct job));
+	memset(job, 0, sizeof(struct job));
+
+	// Outputs are named after the input, minus its directory and extension
+	char *name = strrchr(inputFilename, '/');
+	name = AllocStrdup(ALLOC_POOL, name != NULL ? name + 1 : inputFilename);
+	char *dot = strrchr(name, '.');
+	if (dot != NULL && dot != name) {
+		*dot = '\0';
+	}
+
+	job->inputFilename = AllocStrdup(ALLOC_POOL, inputFilename);
+	char *base = concat(outputDir, "/", name);
+	job->treeFilename = concat(base, ".tree", "");
+	job->encodingFilename = concat(base, ".enc", "");
+	job->words = words;
+	AllocFree(ALLOC_POOL, base);
+	AllocFree(ALLOC_POOL, name);
+
+	WorkPoolSubmit(pool, loadFile, job);
+}
+
+static char *concat(char *a, char *b, char *c) {
+	size_t lenA = strlen(a);
+	size_t lenB = strlen(b);
+	char *s = AllocMalloc(ALLOC_POOL, lenA + lenB + strlen(c) + 1);
+	strcpy(s, a);
+	strcpy(s + lenA, b);
+	strcpy(s + lenA + lenB, c);
+	return s;
+}
+
+static void usage(char *progName) {
+	fprintf(stderr,
+	        "usage: %s [-j <workers>] [-w] [-l <list filename|->] <output directory> "
+	        "[input filename|directory]...\n",
+	        progName);
+	exit(EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////
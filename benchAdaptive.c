@@ -0,0 +1,121 @@
+// Benchmark comparing the one-pass adaptive coder with the static two-pass
+// path (createHuffmanTree + encode, then decode)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Adaptive.h"
+#include "Alloc.h"
+#include "huffman.h"
+
+#define DEFAULT_REPEATS 3
+
+static double benchStatic(char *filename, double *decodeSeconds, double *bitsPerByte);
+static double benchAdaptive(char *filename, double *decodeSeconds, double *bitsPerByte);
+static long fileSize(char *filename);
+static double now(void);
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <input file>...\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%-28s %10s %12s %12s %12s %12s %8s %8s\n", "file", "bytes",
+           "static enc", "static dec", "adapt enc", "adapt dec",
+           "static", "adapt");
+    printf("%-28s %10s %12s %12s %12s %12s %8s %8s\n", "", "",
+           "MB/s", "MB/s", "MB/s", "MB/s", "bits/B", "bits/B");
+
+    for (int i = 1; i < argc; i++) {
+        double megabytes = fileSize(argv[i]) / 1e6;
+        double bestStatic[2] = {1e30, 1e30};
+        double bestAdaptive[2] = {1e30, 1e30};
+        double staticBits = 0;
+        double adaptiveBits = 0;
+
+        // Keep the fastest of a few runs to smooth out noise
+        for (int r = 0; r < DEFAULT_REPEATS; r++) {
+            double decodeSeconds;
+            double encodeSeconds = benchStatic(argv[i], &decodeSeconds, &staticBits);
+            if (encodeSeconds < bestStatic[0]) bestStatic[0] = encodeSeconds;
+            if (decodeSeconds < bestStatic[1]) bestStatic[1] = decodeSeconds;
+
+            encodeSeconds = benchAdaptive(argv[i], &decodeSeconds, &adaptiveBits);
+            if (encodeSeconds < bestAdaptive[0]) bestAdaptive[0] = encodeSeconds;
+            if (decodeSeconds < bestAdaptive[1]) bestAdaptive[1] = decodeSeconds;
+        }
+
+        printf("%-28s %10.0f %12.2f %12.2f %12.2f %12.2f %8.3f %8.3f\n",
+               argv[i], megabytes * 1e6,
+               megabytes / bestStatic[0], megabytes / bestStatic[1],
+               megabytes / bestAdaptive[0], megabytes / bestAdaptive[1],
+               staticBits, adaptiveBits);
+    }
+}
+
+// Times both passes of the static encoder and the decoder
+static double benchStatic(char *filename, double *decodeSeconds, double *bitsPerByte) {
+    double start = now();
+    struct huffmanTree *tree = createHuffmanTree(filename);
+    char *encoding = encode(tree, filename);
+    double encodeSeconds = now() - start;
+
+    start = now();
+    decode(tree, encoding, "/dev/null");
+    *decodeSeconds = now() - start;
+
+    *bitsPerByte = (double)strlen(encoding) / fileSize(filename);
+    AllocFree(ALLOC_BUFFER, encoding);
+    destroyHuffmanTree(tree);
+    return encodeSeconds;
+}
+
+// Times the adaptive encoder and decoder through a temporary file
+static double benchAdaptive(char *filename, double *decodeSeconds, double *bitsPerByte) {
+    FILE *in = fopen(filename, "r");
+    FILE *encoded = tmpfile();
+    FILE *out = fopen("/dev/null", "w");
+    if (in == NULL || encoded == NULL || out == NULL) {
+        fprintf(stderr, "error: failed to open files for '%s'\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    double start = now();
+    uint64_t numBytes = AdaptiveEncodeStream(in, encoded);
+    double encodeSeconds = now() - start;
+
+    long encodedBytes = ftell(encoded);
+    *bitsPerByte = numBytes > 0 ? encodedBytes * 8.0 / numBytes : 0;
+    rewind(encoded);
+
+    start = now();
+    AdaptiveDecodeStream(encoded, out);
+    *decodeSeconds = now() - start;
+
+    fclose(in);
+    fclose(encoded);
+    fclose(out);
+    return encodeSeconds;
+}
+
+static long fileSize(char *filename) {
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "error: failed to open '%s' for reading\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
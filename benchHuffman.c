@@ -0,0 +1,302 @@
+// End-to-end benchmark of the static huffman pipeline
+//
+// Times every phase (count, build, encode, decode, and the in-memory codec,
+// as one bitstream and as -n interleaved streams) on each input file and
+// prints one JSON object per file, so results can be collected per commit
+// and compared by scripts. Each file runs in its own
+// child process, which makes the reported peak RSS that file's own.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Alloc.h"
+#include "Codebook.h"
+#include "Counter.h"
+#include "HuffmanCodec.h"
+#include "huffman.h"
+
+#define DEFAULT_REPEATS 5
+#define DEFAULT_STREAMS 4
+#define MAX_SYNTHETIC 8
+
+enum phase {
+    PHASE_COUNT,
+    PHASE_BUILD,
+    PHASE_ENCODE,
+    PHASE_DECODE,
+    PHASE_CODEC_ENCODE,
+    PHASE_CODEC_DECODE,
+    PHASE_STREAMS_ENCODE,
+    PHASE_STREAMS_DECODE,
+    NUM_PHASES,
+};
+
+static char *phaseNames[NUM_PHASES] = {
+    "count", "build", "encode", "decode", "codec_encode", "codec_decode",
+    "streams_encode", "streams_decode",
+};
+
+static void benchFile(char *filename, char *label, char *commit, int repeats,
+                      int numStreams);
+static void printPhase(enum phase p, double *seconds, int repeats, long bytes,
+                       uint64_t symbols, bool last);
+static char *makeSynthetic(char **filenames, int numFiles, long megabytes);
+static char *readFile(char *filename, long *size);
+static int compareDoubles(const void *a, const void *b);
+static double now(void);
+static void usage(char *progName);
+
+int main(int argc, char *argv[]) {
+    int repeats = DEFAULT_REPEATS;
+    int numStreams = DEFAULT_STREAMS;
+    char *commit = "";
+    long synthetic[MAX_SYNTHETIC];
+    int numSynthetic = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:s:c:n:")) != -1) {
+        if (opt == 'r') {
+            repeats = atoi(optarg);
+        } else if (opt == 's' && numSynthetic < MAX_SYNTHETIC) {
+            synthetic[numSynthetic++] = atol(optarg);
+        } else if (opt == 'c') {
+            commit = optarg;
+        } else if (opt == 'n') {
+            numStreams = atoi(optarg);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (optind >= argc || repeats < 1 || numStreams < 1 || numStreams > CODEC_MAX_STREAMS) {
+        usage(argv[0]);
+    }
+
+    for (int i = optind; i < argc; i++) {
+        benchFile(argv[i], argv[i], commit, repeats, numStreams);
+    }
+
+    // Scaled-up inputs repeat the given files until they reach the size
+    for (int i = 0; i < numSynthetic; i++) {
+        char *filename = makeSynthetic(&argv[optind], argc - optind, synthetic[i]);
+        char label[64];
+        snprintf(label, sizeof(label), "synthetic-%ldMB", synthetic[i]);
+        benchFile(filename, label, commit, repeats, numStreams);
+        unlink(filename);
+        free(filename);
+    }
+}
+
+// Runs every phase repeats times in a child process and prints the results
+static void benchFile(char *filename, char *label, char *commit, int repeats,
+                      int numStreams) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid > 0) {
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "error: benchmark of '%s' failed\n", label);
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+
+    long bytes;
+    char *text = readFile(filename, &bytes);
+    double *seconds[NUM_PHASES];
+    for (int p = 0; p < NUM_PHASES; p++) {
+        seconds[p] = malloc(repeats * sizeof(double));
+        if (seconds[p] == NULL) {
+            fprintf(stderr, "error: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    uint64_t symbols = 0;
+    uint64_t numBits = 0;
+
+    for (int r = 0; r < repeats; r++) {
+        double start = now();
+        Counter c = countTokens(filename);
+        seconds[PHASE_COUNT][r] = now() - start;
+
+        start = now();
+        struct huffmanTree *tree = createHuffmanTreeFromCounter(c);
+        seconds[PHASE_BUILD][r] = now() - start;
+
+        int numItems;
+        struct item *items = CounterItems(c, &numItems);
+        symbols = 0;
+        for (int i = 0; i < numItems; i++) {
+            symbols += items[i].freq;
+        }
+        CounterFreeItems(items, numItems);
+        CounterFree(c);
+
+        start = now();
+        Codebook cb = CodebookNew(tree);
+        char *encoding = encodeWithCodebook(cb, filename);
+        seconds[PHASE_ENCODE][r] = now() - start;
+        CodebookFree(cb);
+        if (encoding == NULL) {
+            exit(EXIT_FAILURE);
+        }
+
+        start = now();
+        decode(tree, encoding, "/dev/null");
+        seconds[PHASE_DECODE][r] = now() - start;
+        AllocFree(ALLOC_BUFFER, encoding);
+
+        HuffmanCodec codec = CodecNewFromTree(tree);
+        size_t cap = CodecMaxEncodedSize(codec, bytes);
+        unsigned char *bits = malloc(cap);
+        char *decoded = malloc(bytes + 1);
+        if (bits == NULL || decoded == NULL) {
+            fprintf(stderr, "error: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+
+        start = now();
+        int64_t n = CodecEncode(codec, text, bytes, bits, cap);
+        seconds[PHASE_CODEC_ENCODE][r] = now() - start;
+
+        start = now();
+        int64_t len = CodecDecode(codec, bits, n, decoded, bytes + 1);
+        seconds[PHASE_CODEC_DECODE][r] = now() - start;
+        if (n < 0 || len != bytes || memcmp(decoded, text, bytes) != 0) {
+            fprintf(stderr, "error: '%s' did not round trip\n", label);
+            exit(EXIT_FAILURE);
+        }
+        numBits = n;
+
+        uint64_t streamBits[CODEC_MAX_STREAMS];
+        start = now();
+        int64_t streamBytes = CodecEncodeStreams(codec, text, bytes, numStreams, bits, cap,
+                                                 streamBits);
+        seconds[PHASE_STREAMS_ENCODE][r] = now() - start;
+
+        start = now();
+        len = CodecDecodeStreams(codec, bits, numStreams, streamBits, decoded, bytes + 1);
+        seconds[PHASE_STREAMS_DECODE][r] = now() - start;
+        if (streamBytes < 0 || len != bytes || memcmp(decoded, text, bytes) != 0) {
+            fprintf(stderr, "error: '%s' did not round trip in %d streams\n", label,
+                    numStreams);
+            exit(EXIT_FAILURE);
+        }
+
+        free(bits);
+        free(decoded);
+        CodecFree(codec);
+        destroyHuffmanTree(tree);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("{\"commit\":\"%s\",\"file\":\"%s\",\"bytes\":%ld,\"symbols\":%llu,"
+           "\"repeats\":%d,\"streams\":%d,\"ratio\":%.4f,\"bits_per_byte\":%.4f,"
+           "\"peak_rss_kb\":%ld,\"phases\":{",
+           commit, label, bytes, (unsigned long long)symbols, repeats, numStreams,
+           numBits > 0 ? bytes * 8.0 / numBits : 0.0,
+           bytes > 0 ? (double)numBits / bytes : 0.0, usage.ru_maxrss);
+    for (int p = 0; p < NUM_PHASES; p++) {
+        printPhase(p, seconds[p], repeats, bytes, symbols, p == NUM_PHASES - 1);
+        free(seconds[p]);
+    }
+    printf("}}\n");
+    free(text);
+    exit(EXIT_SUCCESS);
+}
+
+// Prints the median and fastest run of one phase
+static void printPhase(enum phase p, double *seconds, int repeats, long bytes,
+                       uint64_t symbols, bool last) {
+    qsort(seconds, repeats, sizeof(double), compareDoubles);
+    double median = seconds[repeats / 2];
+    printf("\"%s\":{\"median_s\":%.6f,\"min_s\":%.6f,\"mb_per_s\":%.2f,"
+           "\"ns_per_symbol\":%.2f}%s",
+           phaseNames[p], median, seconds[0],
+           median > 0 ? bytes / 1e6 / median : 0.0,
+           symbols > 0 ? median * 1e9 / symbols : 0.0, last ? "" : ",");
+}
+
+// Writes a temporary file of about the given size made of the inputs
+// repeated end to end, and returns its name
+static char *makeSynthetic(char **filenames, int numFiles, long megabytes) {
+    char *filename = strdup("/tmp/benchHuffmanXXXXXX");
+    int fd = mkstemp(filename);
+    FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (fp == NULL) {
+        fprintf(stderr, "error: failed to create a synthetic input\n");
+        exit(EXIT_FAILURE);
+    }
+
+    long target = megabytes * 1000000;
+    long written = 0;
+    while (written < target) {
+        long before = written;
+        for (int i = 0; i < numFiles && written < target; i++) {
+            long size;
+            char *text = readFile(filenames[i], &size);
+            fwrite(text, 1, size, fp);
+            written += size;
+            free(text);
+        }
+        if (written == before) {
+            break;
+        }
+    }
+    fclose(fp);
+    return filename;
+}
+
+static char *readFile(char *filename, long *size) {
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "error: failed to open '%s' for reading\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char *text = malloc(*size + 1);
+    if (text == NULL) {
+        fprintf(stderr, "error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *size = fread(text, 1, *size, fp);
+    text[*size] = '\0';
+    fclose(fp);
+    return text;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(char *progName) {
+    fprintf(stderr,
+            "usage: %s [-r <repeats>] [-s <synthetic MB>]... [-c <commit>] "
+            "[-n <streams>] <input file>...\n",
+            progName);
+    exit(EXIT_FAILURE);
+}
@@ -1,127 +1,581 @@
 // Main program for decoding
 
-// !!! DO NOT MODIFY THIS FILE !!!
-
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 
+#include "Adaptive.h"
+#include "Alloc.h"
+#include "AnsCoder.h"
+#include "BitIO.h"
+#include "BlockCoder.h"
+#include "BwtCoder.h"
+#include "Daemon.h"
 #include "File.h"
+#include "FlatTree.h"
+#include "HuffmanCodec.h"
+#include "Interleaved.h"
+#include "Pipeline.h"
+#include "Stats.h"
+#include "Tokenizer.h"
+#include "TreeCache.h"
+#include "TreeIO.h"
+#include "WorkPool.h"
 #include "huffman.h"
 
-static struct huffmanTree *readHuffmanTree(char *filename);
-static struct huffmanTree *readTree(FILE *fp, char buffer[]);
-static struct huffmanTree *newHuffmanNode(char *token, int freq);
-static void freeHuffmanTree(struct huffmanTree *t);
+// -P passes the encoding through rings of PIPELINE_CHUNKS chunks of
+// PIPELINE_CHUNK_SIZE bytes
+#define PIPELINE_CHUNKS 4
+#define PIPELINE_CHUNK_SIZE (1 << 20)
+
+// Structs definition
+struct chunkDecoder {
+	HuffmanCodec codec;
+	char *text;             // starts with the bits of a code cut off by
+	size_t textCap;         // the end of the last chunk
+	size_t carryLen;
+	unsigned char *bits;
+	size_t bitsCap;
+};
+
+struct blockTask {
+	BlockFile bf;
+	size_t block;
+	char *text;             // the whole output, which the block decodes into
+	bool ok;
+};
 
 static char *readEncoding(char *filename);
 
+static void decodeWithCache(char *treeFilename, char *encoding, char *outputFilename);
+
+static void decodeWithDaemon(char *socketPath, char *treeFilename,
+                             char *encodingFilename, char *outputFilename);
+
+static void decodeAdaptive(char *encodingFilename, char *outputFilename);
+static void decodeBlocks(char *encodingFilename, char *outputFilename);
+static void decodeBlockTask(WorkPool pool, void *arg);
+static void decodeAns(char *encodingFilename, char *outputFilename);
+static void decodeBwt(char *encodingFilename, char *outputFilename);
+static void decodeInterleaved(char *treeFilename, char *encodingFilename, char *outputFilename);
+static void writeText(char *text, size_t len, char *filename);
+static char *mapOutput(char *filename, size_t size, int *fd);
+static void unmapOutput(char *text, size_t size, int fd, char *filename);
+static void decodePipelined(char *treeFilename, char *encodingFilename, char *outputFilename);
+static bool readChunk(void *state, struct chunk *in);
+static bool decodeChunk(void *state, struct chunk *in, struct chunk *out);
+static bool writeChunk(void *state, struct chunk *out);
+static HuffmanCodec codecFromTreeFile(char *treeFilename);
+static void *grow(void *data, size_t *cap, size_t size);
+static unsigned char *readFile(char *filename, size_t *len);
+static FILE *openStream(char *filename, char *mode);
+
 int main(int argc, char *argv[]) {
+	char *progName = argv[0];
+
+	// --stats reports per-phase timings and counters as JSON on stderr
+	bool stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+	if (stats) {
+		argc--;
+		argv++;
+	}
+	StatsInit("decode", stats);
+	AllocInit("decode");
+
+	// -a decodes a single pass adaptive encoding, which needs no tree file
+	if (argc == 4 && strcmp(argv[1], "-a") == 0) {
+		decodeAdaptive(argv[2], argv[3]);
+		return 0;
+	}
+
+	// -B decodes a block encoding (see encode -B), which carries its trees
+	if (argc == 4 && strcmp(argv[1], "-B") == 0) {
+		decodeBlocks(argv[2], argv[3]);
+		return 0;
+	}
+
+	// -A decodes a tANS encoding (see encode -A), which carries its table
+	if (argc == 4 && strcmp(argv[1], "-A") == 0) {
+		decodeAns(argv[2], argv[3]);
+		return 0;
+	}
+
+	// -X decodes a transformed block encoding (see encode -X)
+	if (argc == 4 && strcmp(argv[1], "-X") == 0) {
+		decodeBwt(argv[2], argv[3]);
+		return 0;
+	}
+
+	// -I decodes an interleaved encoding (see encode -I) with its tree
+	if (argc == 5 && strcmp(argv[1], "-I") == 0) {
+		decodeInterleaved(argv[2], argv[3], argv[4]);
+		return 0;
+	}
+
+	// -P overlaps reading, decoding and writing on three threads
+	if (argc == 5 && strcmp(argv[1], "-P") == 0) {
+		decodePipelined(argv[2], argv[3], argv[4]);
+		return 0;
+	}
+
+	// -S hands the decoding to a running huffmand
+	if (argc == 6 && strcmp(argv[1], "-S") == 0) {
+		decodeWithDaemon(argv[2], argv[3], argv[4], argv[5]);
+		return 0;
+	}
+
 	if (argc != 4) {
-		fprintf(stderr, "usage: %s <tree filename> <encoding filename> "
+		fprintf(stderr, "usage: %s [--stats] <tree filename> <encoding filename> "
+		        "<output filename>\n"
+		        "       %s -a <encoding filename|-> <output filename|->\n"
+		        "       %s -A <encoding filename|-> <output filename|->\n"
+		        "       %s -B <encoding filename|-> <output filename|->\n"
+		        "       %s -I <tree filename> <encoding filename|-> <output filename|->\n"
+		        "       %s -P <tree filename> <encoding filename|-> <output filename|->\n"
+		        "       %s -X <encoding filename|-> <output filename|->\n"
+		        "       %s -S <socket path> <tree filename> <encoding filename> "
 		        "<output filename>\n",
-		        argv[0]);
+		        progName, progName, progName, progName, progName, progName, progName, progName);
 		exit(EXIT_FAILURE);
 	}
 
-	struct huffmanTree *tree = readHuffmanTree(argv[1]);
 	char *encoding = readEncoding(argv[2]);
+	// A binary tree file (see encode -b) is mapped and decoded from in place
+	FlatTree ft = FlatTreeMap(argv[1]);
+	if (ft != NULL) {
+		FlatTreeDecode(ft, encoding, argv[3]);
+		FlatTreeFree(ft);
+	} else if (TreeCacheEnabled()) {
+		decodeWithCache(argv[1], encoding, argv[3]);
+	} else {
+		struct huffmanTree *tree = TreeIORead(argv[1]);
+		decode(tree, encoding, argv[3]);
+		TreeIOFree(tree);
+	}
+	AllocFree(ALLOC_IO, encoding);
+}
+
+// Decodes with the tree file's flat decode table, loaded from the cache when
+// this tree has been seen before
+static void decodeWithCache(char *treeFilename, char *encoding, char *outputFilename) {
+	uint64_t key = TreeCacheFileKey(treeFilename);
+	FlatTree ft = TreeCacheGetFlatTree(key);
+	if (ft == NULL) {
+		struct huffmanTree *tree = TreeIORead(treeFilename);
+		ft = FlatTreeNew(tree);
+		TreeIOFree(tree);
+		TreeCachePutFlatTree(key, ft);
+	}
+	FlatTreeDecode(ft, encoding, outputFilename);
+	FlatTreeFree(ft);
+}
+
+// Decodes through the daemon listening on the socket path
+static void decodeWithDaemon(char *socketPath, char *treeFilename,
+                             char *encodingFilename, char *outputFilename) {
+	char treePath[PATH_MAX];
+	if (realpath(treeFilename, treePath) == NULL) {
+		fprintf(stderr, "error: failed to open '%s' for reading\n", treeFilename);
+		exit(EXIT_FAILURE);
+	}
+	int fd = DaemonConnect(socketPath);
+	if (fd < 0) {
+		fprintf(stderr, "error: failed to connect to '%s'\n", socketPath);
+		exit(EXIT_FAILURE);
+	}
+
+	char *encoding = readEncoding(encodingFilename);
+	unsigned char *bits = AllocMalloc(ALLOC_BUFFER, strlen(encoding) / 8 + 1);
+	uint64_t numBits = TextToBits(encoding, bits);
+	AllocFree(ALLOC_IO, encoding);
 
-	decode(tree, encoding, argv[3]);
+	char *text;
+	size_t len;
+	if (!DaemonDecode(fd, treePath, bits, numBits, &text, &len)) {
+		exit(EXIT_FAILURE);
+	}
+	close(fd);
+	AllocFree(ALLOC_BUFFER, bits);
 
-	freeHuffmanTree(tree);
-	free(encoding);
+	FILE *out = openStream(outputFilename, "w");
+	if (fwrite(text, 1, len, out) != len) {
+		fprintf(stderr, "error: failed to write '%s'\n", outputFilename);
+		exit(EXIT_FAILURE);
+	}
+	if (out != stdout) {
+		fclose(out);
+	}
+	AllocFree(ALLOC_BUFFER, text);
 }
 
-static struct huffmanTree *readHuffmanTree(char *filename) {
+////////////////////////////////////////////////////////////////////////
+
+static char *readEncoding(char *filename) {
 	FILE *fp = fopen(filename, "r");
 	if (fp == NULL) {
 		fprintf(stderr, "error: failed to open '%s' for reading\n", filename);
 		exit(EXIT_FAILURE);
 	}
 
-	char buffer[MAX_TOKEN_LEN + 1];
-	struct huffmanTree *tree = readTree(fp, buffer);
+	StatsBegin(STATS_READ_INPUT);
+	fseeko(fp, 0, SEEK_END);
+	off_t pos = ftello(fp);
+	fseeko(fp, 0, SEEK_SET);
+
+	char *encoding = AllocMalloc(ALLOC_IO, ((size_t)pos + 1) * sizeof(char));
+
+	if (fscanf(fp, "%s", encoding) != 1) {
+		fprintf(stderr, "error: failed to read encoding\n");
+		exit(EXIT_FAILURE);
+	}
 	fclose(fp);
-	return tree;
+	StatsEnd(STATS_READ_INPUT);
+	StatsAdd(STATS_BYTES_IN, strlen(encoding));
+
+	return encoding;
 }
 
-static struct huffmanTree *readTree(FILE *fp, char buffer[]) {
-	struct huffmanTree *t = newHuffmanNode(NULL, 0);
+////////////////////////////////////////////////////////////////////////
 
-	int c = fgetc(fp);
+// Decodes a single pass adaptive encoding; "-" reads stdin or writes stdout
+static void decodeAdaptive(char *encodingFilename, char *outputFilename) {
+	FILE *in = openStream(encodingFilename, "r");
+	FILE *out = openStream(outputFilename, "w");
+	if (!AdaptiveDecodeStream(in, out)) {
+		fprintf(stderr, "error: '%s' is not a complete adaptive encoding\n",
+		        encodingFilename);
+		exit(EXIT_FAILURE);
+	}
+	if (in != stdin) {
+		fclose(in);
+	}
+	if (out != stdout) {
+		fclose(out);
+	}
+}
+
+// Decodes the blocks of a block encoding in parallel, each straight into
+// its own region of the output. The header records the decoded size, so a
+// regular output file is sized up front and mapped, and the blocks are
+// written to it without passing through a buffer or stdio.
+static void decodeBlocks(char *encodingFilename, char *outputFilename) {
+	size_t len;
+	unsigned char *data = readFile(encodingFilename, &len);
+	BlockFile bf = BlockFileOpen(data, len);
+	if (bf == NULL) {
+		fprintf(stderr, "error: '%s' is not a complete block encoding\n",
+		        encodingFilename);
+		exit(EXIT_FAILURE);
+	}
+
+	size_t size = BlockFileDecodedSize(bf);
+	int fd;
+	char *text = mapOutput(outputFilename, size, &fd);
+	if (text == NULL) {
+		text = AllocMalloc(ALLOC_BUFFER, size);
+	}
 
-	if (c == '(') {
-		t->left = readTree(fp, buffer);
-		fgetc(fp); // should always be a ','
-		t->right = readTree(fp, buffer);
-		fgetc(fp); // should always be a ')'
+	size_t numBlocks = BlockFileNumBlocks(bf);
+	struct blockTask *tasks = AllocMalloc(ALLOC_BUFFER, numBlocks * sizeof(*tasks));
+	StatsBegin(STATS_DECODE);
+	long numWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+	if (numBlocks > 1 && numWorkers > 1) {
+		WorkPool pool = WorkPoolNew(numWorkers < (long)numBlocks ? numWorkers : (long)numBlocks);
+		for (size_t i = 0; i < numBlocks; i++) {
+			tasks[i] = (struct blockTask){bf, i, text, false};
+			WorkPoolSubmit(pool, decodeBlockTask, &tasks[i]);
+		}
+		WorkPoolWait(pool);
+		WorkPoolFree(pool);
 	} else {
-		int i = 0;
-		while (c != ',' && c != ')') {
-			if (c == '\\') {
-				c = fgetc(fp);
+		for (size_t i = 0; i < numBlocks; i++) {
+			tasks[i] = (struct blockTask){bf, i, text, false};
+			decodeBlockTask(NULL, &tasks[i]);
+		}
+	}
+	StatsEnd(STATS_DECODE);
+	for (size_t i = 0; i < numBlocks; i++) {
+		if (!tasks[i].ok) {
+			// A mapped output already has its full size, so leave none at all
+			if (fd >= 0) {
+				unlink(outputFilename);
 			}
-			buffer[i++] = c;
-			c = fgetc(fp);
+			fprintf(stderr, "error: block %zu of '%s' is corrupt\n", i,
+			        encodingFilename);
+			exit(EXIT_FAILURE);
 		}
+	}
+	StatsAdd(STATS_BYTES_OUT, size);
 
-		ungetc(c, fp);
-		buffer[i] = '\0';
-		t->token = strdup(buffer);
+	if (fd >= 0) {
+		unmapOutput(text, size, fd, outputFilename);
+	} else {
+		writeText(text, size, outputFilename);
+		AllocFree(ALLOC_BUFFER, text);
 	}
+	AllocFree(ALLOC_BUFFER, tasks);
+	BlockFileFree(bf);
+	AllocFree(ALLOC_IO, data);
+}
 
-	return t;
+// Decodes one block into its region of the output
+static void decodeBlockTask(WorkPool pool, void *arg) {
+	(void)pool;
+	struct blockTask *task = arg;
+	task->ok = BlockFileDecodeBlock(task->bf, task->block,
+	                                &task->text[BlockFileBlockStart(task->bf, task->block)]);
 }
 
-static struct huffmanTree *newHuffmanNode(char *token, int freq) {
-	struct huffmanTree *new = malloc(sizeof(struct huffmanTree));
-	if (new == NULL) {
-		fprintf(stderr, "error: out of memory\n");
+// Decodes a tANS encoding with the table at its start
+static void decodeAns(char *encodingFilename, char *outputFilename) {
+	size_t len;
+	unsigned char *data = readFile(encodingFilename, &len);
+	size_t textLen;
+	char *text = AnsDecode(data, len, &textLen);
+	if (text == NULL) {
+		fprintf(stderr, "error: '%s' is not a complete tANS encoding\n", encodingFilename);
 		exit(EXIT_FAILURE);
 	}
+	writeText(text, textLen, outputFilename);
+	AllocFree(ALLOC_BUFFER, text);
+	AllocFree(ALLOC_IO, data);
+}
 
-	new->token = token;
-	new->freq = freq;
-	new->left = NULL;
-	new->right = NULL;
-	return new;
+// Decodes a transformed block encoding and undoes the transform
+static void decodeBwt(char *encodingFilename, char *outputFilename) {
+	size_t len;
+	unsigned char *data = readFile(encodingFilename, &len);
+	size_t textLen;
+	char *text = BwtDecode(data, len, &textLen);
+	if (text == NULL) {
+		fprintf(stderr, "error: '%s' is not a complete transformed encoding\n",
+		        encodingFilename);
+		exit(EXIT_FAILURE);
+	}
+	StatsAdd(STATS_BYTES_OUT, textLen);
+	writeText(text, textLen, outputFilename);
+	AllocFree(ALLOC_BUFFER, text);
+	AllocFree(ALLOC_IO, data);
 }
 
-static void freeHuffmanTree(struct huffmanTree *t) {
-	if (t != NULL) {
-		freeHuffmanTree(t->left);
-		freeHuffmanTree(t->right);
-		free(t->token);
-		free(t);
+// Decodes an interleaved encoding, whose streams are read side by side
+static void decodeInterleaved(char *treeFilename, char *encodingFilename, char *outputFilename) {
+	HuffmanCodec codec = codecFromTreeFile(treeFilename);
+	size_t len;
+	unsigned char *data = readFile(encodingFilename, &len);
+	size_t textLen;
+	char *text = InterleavedDecode(codec, data, len, &textLen);
+	if (text == NULL) {
+		fprintf(stderr, "error: '%s' is not a complete interleaved encoding for '%s'\n",
+		        encodingFilename, treeFilename);
+		exit(EXIT_FAILURE);
 	}
+	writeText(text, textLen, outputFilename);
+	AllocFree(ALLOC_BUFFER, text);
+	AllocFree(ALLOC_IO, data);
+	CodecFree(codec);
 }
 
-////////////////////////////////////////////////////////////////////////
+// Decodes the encoding with the tree while the next chunk is read and the
+// last one written. The output is the same as without -P.
+static void decodePipelined(char *treeFilename, char *encodingFilename, char *outputFilename) {
+	FILE *in = openStream(encodingFilename, "r");
+	struct chunkDecoder decoder = {codecFromTreeFile(treeFilename), NULL, 0, 0, NULL, 0};
+	FILE *out = openStream(outputFilename, "w");
+	struct pipelineStages stages = {
+		readChunk, in, decodeChunk, &decoder, writeChunk, out,
+	};
+	if (!PipelineRun(&stages, PIPELINE_CHUNKS, PIPELINE_CHUNK_SIZE)) {
+		exit(EXIT_FAILURE);
+	}
+	if (in != stdin) {
+		fclose(in);
+	}
+	if (out != stdout && fclose(out) != 0) {
+		fprintf(stderr, "error: failed to write '%s'\n", outputFilename);
+		exit(EXIT_FAILURE);
+	}
+	AllocFree(ALLOC_BUFFER, decoder.text);
+	AllocFree(ALLOC_BUFFER, decoder.bits);
+	CodecFree(decoder.codec);
+}
 
-static char *readEncoding(char *filename) {
-	FILE *fp = fopen(filename, "r");
-	if (fp == NULL) {
-		fprintf(stderr, "error: failed to open '%s' for reading\n", filename);
+static bool readChunk(void *state, struct chunk *in) {
+	FILE *fp = state;
+	StatsBegin(STATS_READ_INPUT);
+	in->len = fread(in->data, 1, in->cap, fp);
+	in->last = in->len < in->cap;
+	StatsEnd(STATS_READ_INPUT);
+	StatsAdd(STATS_BYTES_IN, in->len);
+	if (ferror(fp)) {
+		fprintf(stderr, "error: failed to read the encoding\n");
+		return false;
+	}
+	return true;
+}
+
+// Decodes the whole codes of the carried bits and the chunk, and carries
+// the bits of a code cut off by the end of the chunk on to the next one
+static bool decodeChunk(void *state, struct chunk *in, struct chunk *out) {
+	struct chunkDecoder *d = state;
+	StatsBegin(STATS_DECODE);
+	d->text = grow(d->text, &d->textCap, d->carryLen + in->len + 1);
+	memcpy(&d->text[d->carryLen], in->data, in->len);
+	d->text[d->carryLen + in->len] = '\0';
+	d->bits = grow(d->bits, &d->bitsCap, (d->carryLen + in->len + 7) / 8);
+	uint64_t numBits = TextToBits(d->text, d->bits);
+
+	PipelineReserve(out, CodecMaxDecodedSize(d->codec, numBits));
+	uint64_t used;
+	int64_t len = CodecDecodePrefix(d->codec, d->bits, numBits, out->data, out->cap, &used);
+	if (len < 0) {
+		StatsEnd(STATS_DECODE);
+		fprintf(stderr, "error: the encoding has bits that start no code of the tree\n");
+		return false;
+	}
+	out->len = len;
+	d->carryLen = numBits - used;
+	for (uint64_t i = used; i < numBits; i++) {
+		d->text[i - used] = (d->bits[i / 8] >> (7 - i % 8)) & 1 ? '1' : '0';
+	}
+	StatsEnd(STATS_DECODE);
+
+	if (in->last && d->carryLen > 0) {
+		fprintf(stderr, "error: the encoding does not end with a whole code\n");
+		return false;
+	}
+	return true;
+}
+
+static bool writeChunk(void *state, struct chunk *out) {
+	StatsBegin(STATS_WRITE_OUTPUT);
+	bool ok = fwrite(out->data, 1, out->len, (FILE *)state) == out->len;
+	StatsEnd(STATS_WRITE_OUTPUT);
+	StatsAdd(STATS_BYTES_OUT, out->len);
+	if (!ok) {
+		fprintf(stderr, "error: failed to write the output\n");
+	}
+	return ok;
+}
+
+static HuffmanCodec codecFromTreeFile(char *treeFilename) {
+	struct huffmanTree *tree = TreeIORead(treeFilename);
+	HuffmanCodec codec = CodecNewFromTree(tree);
+	TreeIOFree(tree);
+	if (codec == NULL) {
+		fprintf(stderr, "error: '%s' has a code longer than 64 bits\n", treeFilename);
 		exit(EXIT_FAILURE);
 	}
+	return codec;
+}
 
-	fseek(fp, 0, SEEK_END);
-	long pos = ftell(fp);
-	fseek(fp, 0, SEEK_SET);
+// Reallocates data to hold at least size bytes
+static void *grow(void *data, size_t *cap, size_t size) {
+	if (size <= *cap) {
+		return data;
+	}
+	*cap = size;
+	return AllocRealloc(ALLOC_BUFFER, data, size);
+}
 
-	char *encoding = malloc((pos + 1) * sizeof(char));
-	if (encoding == NULL) {
-		fprintf(stderr, "error: out of memory\n");
+static void writeText(char *text, size_t len, char *filename) {
+	FILE *out = openStream(filename, "w");
+	StatsBegin(STATS_WRITE_OUTPUT);
+	if (fwrite(text, 1, len, out) != len) {
+		fprintf(stderr, "error: failed to write '%s'\n", filename);
 		exit(EXIT_FAILURE);
 	}
+	StatsEnd(STATS_WRITE_OUTPUT);
+	if (out != stdout) {
+		fclose(out);
+	}
+}
+
+// Creates filename with room for size bytes and maps it for writing
+// Returns NULL, leaving the output to writeText, if filename is stdout or
+// not a regular file, or if there is nothing to map
+static char *mapOutput(char *filename, size_t size, int *fd) {
+	*fd = -1;
+	struct stat st;
+	if (strcmp(filename, "-") == 0 || size == 0 ||
+			(stat(filename, &st) == 0 && !S_ISREG(st.st_mode))) {
+		return NULL;
+	}
 
-	if (fscanf(fp, "%s", encoding) != 1) {
-		fprintf(stderr, "error: failed to read encoding\n");
+	int out = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (out < 0) {
+		fprintf(stderr, "error: failed to open '%s' for writing\n", filename);
 		exit(EXIT_FAILURE);
 	}
+	// Allocating the blocks now means a full disk is reported here rather
+	// than as a SIGBUS on some later store to the mapping
+	if (posix_fallocate(out, 0, size) != 0) {
+		unlink(filename);
+		fprintf(stderr, "error: failed to write '%s'\n", filename);
+		exit(EXIT_FAILURE);
+	}
+	char *text = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, out, 0);
+	if (text == MAP_FAILED) {
+		close(out);
+		return NULL;
+	}
+	*fd = out;
+	return text;
+}
 
-	return encoding;
+// Unmaps an output mapped by mapOutput, leaving the kernel to write it back
+static void unmapOutput(char *text, size_t size, int fd, char *filename) {
+	StatsBegin(STATS_WRITE_OUTPUT);
+	if (munmap(text, size) != 0 || close(fd) != 0) {
+		fprintf(stderr, "error: failed to write '%s'\n", filename);
+		exit(EXIT_FAILURE);
+	}
+	StatsEnd(STATS_WRITE_OUTPUT);
+}
+
+// Reads the whole file into memory
+static unsigned char *readFile(char *filename, size_t *len) {
+	FILE *fp = openStream(filename, "r");
+	StatsBegin(STATS_READ_INPUT);
+	size_t size = 4096;
+	unsigned char *data = AllocMalloc(ALLOC_IO, size);
+	*len = 0;
+	while (true) {
+		*len += fread(data + *len, 1, size - *len, fp);
+		if (*len < size) {
+			break;
+		}
+		size *= 2;
+		data = AllocRealloc(ALLOC_IO, data, size);
+	}
+	if (fp != stdin) {
+		fclose(fp);
+	}
+	StatsEnd(STATS_READ_INPUT);
+	StatsAdd(STATS_BYTES_IN, *len);
+	return data;
+}
+
+static FILE *openStream(char *filename, char *mode) {
+	if (strcmp(filename, "-") == 0) {
+		return mode[0] == 'r' ? stdin : stdout;
+	}
+
+	FILE *fp = fopen(filename, mode);
+	if (fp == NULL) {
+		fprintf(stderr, "error: failed to open '%s' for %s\n", filename,
+		        mode[0] == 'r' ? "reading" : "writing");
+		exit(EXIT_FAILURE);
+	}
+	return fp;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -1,162 +1,713 @@
 // Main program for encoding
 
-// !!! DO NOT MODIFY THIS FILE !!!
-
+#include <ctype.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "Adaptive.h"
+#include "Alloc.h"
+#include "AnsCoder.h"
+#include "BitIO.h"
+#include "BlockCoder.h"
+#include "BwtCoder.h"
+#include "Codebook.h"
+#include "Daemon.h"
 #include "File.h"
+#include "FlatTree.h"
+#include "HuffmanCodec.h"
+#include "Interleaved.h"
+#include "Pipeline.h"
+#include "Stats.h"
+#include "Tokenizer.h"
+#include "TreeCache.h"
+#include "TreeIO.h"
 #include "huffman.h"
 
-static struct huffmanTree *readHuffmanTree(char *filename);
-static struct huffmanTree *readTree(FILE *fp, char buffer[]);
-static struct huffmanTree *newHuffmanNode(char *token, int freq);
+// -P passes the input through rings of PIPELINE_CHUNKS chunks of
+// PIPELINE_CHUNK_SIZE bytes. A chunk grows until it has a token boundary,
+// up to PIPELINE_MAX_CHUNK_SIZE bytes.
+#define PIPELINE_CHUNKS 4
+#define PIPELINE_CHUNK_SIZE (1 << 20)
+#define PIPELINE_MAX_CHUNK_SIZE (4 * PIPELINE_CHUNK_SIZE)
+
+// Structs definition
+struct textReader {
+	FILE *fp;
+	bool words;             // the tree has words, so letter runs hold together
+	char *carry;            // the cut-off tail of the last chunk
+	size_t carryLen;
+	size_t carryCap;
+};
+
+struct chunkEncoder {
+	HuffmanCodec codec;
+	unsigned char *bits;
+	size_t bitsCap;
+};
 
-static void writeHuffmanTree(struct huffmanTree *tree, char *filename);
-static void writeTree(struct huffmanTree *t, FILE *fp);
+static void writeBinaryTree(char *treeFilename, char *binaryFilename);
 static void writeEncoding(char *encoding, char *filename);
 
 void showHuffmanTree(struct huffmanTree *t);
-static void freeHuffmanTree(struct huffmanTree *t);
+
+static void buildTreeFile(char *inputFilename, char *treeFilename, bool words);
+static void buildSampledTreeFile(char *inputFilename, char *treeFilename,
+                                 int64_t sampleBytes, int sampleBlocks, bool report);
+static void reportSampleLoss(struct huffmanTree *sampled, char *inputFilename,
+                             int64_t sampleBytes);
+static int64_t encodedBits(struct huffmanTree *tree, char *inputFilename);
+static bool parseSample(char *arg, int64_t *sampleBytes, int *sampleBlocks);
+static char *encodeWithTreeFile(char *inputFilename, char *treeFilename);
+static void encodeAdaptive(char *inputFilename, char *encodingFilename);
+static void encodeBlocks(char *inputFilename, long blockKB, char *encodingFilename);
+static void encodeAns(char *inputFilename, char *encodingFilename);
+static void encodeBwt(char *inputFilename, long blockKB, char *encodingFilename);
+static void encodeInterleaved(char *inputFilename, char *treeFilename, int numStreams,
+                              char *encodingFilename);
+static void writeBytes(unsigned char *data, size_t len, char *filename);
+static void encodePipelined(char *inputFilename, char *treeFilename, char *encodingFilename);
+static bool readTextChunk(void *state, struct chunk *in);
+static size_t lastTokenBoundary(struct chunk *c, bool words);
+static bool encodeChunk(void *state, struct chunk *in, struct chunk *out);
+static bool writeChunk(void *state, struct chunk *out);
+static HuffmanCodec codecFromTreeFile(char *treeFilename);
+static void encodeWithDaemon(char *socketPath, char *inputFilename,
+                             char *treeFilename, char *encodingFilename);
+static char *readFile(char *filename, size_t *len);
+static FILE *openStream(char *filename, char *mode);
+static void usage(char *progName);
 
 int main(int argc, char *argv[]) {
-	if (argc != 3 && argc != 4) {
-		fprintf(stderr, "usage: %s <input filename> <tree filename> "
-		        "[encoding filename]\n",
-		        argv[0]);
-		exit(EXIT_FAILURE);
+	char *progName = argv[0];
+
+	// --stats reports per-phase timings and counters as JSON on stderr
+	bool stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+	if (stats) {
+		argc--;
+		argv++;
+	}
+	StatsInit("encode", stats);
+	AllocInit("encode");
+
+	// -a encodes in a single pass with an adaptive tree and no tree file
+	if (argc > 1 && strcmp(argv[1], "-a") == 0) {
+		if (argc != 4) {
+			usage(progName);
+		}
+		encodeAdaptive(argv[2], argv[3]);
+		return 0;
+	}
+
+	// -B encodes in independently decodable blocks, each with its own tree
+	// or the tree of the block before it
+	if (argc > 1 && strcmp(argv[1], "-B") == 0) {
+		char *end;
+		long blockKB = argc == 5 ? strtol(argv[2], &end, 10) : 0;
+		if (argc != 5 || *end != '\0' || blockKB <= 0 || blockKB > 1024 * 1024) {
+			usage(progName);
+		}
+		encodeBlocks(argv[3], blockKB, argv[4]);
+		return 0;
+	}
+
+	// -A codes with a tANS table fitted to the input instead of a tree
+	if (argc > 1 && strcmp(argv[1], "-A") == 0) {
+		if (argc != 4) {
+			usage(progName);
+		}
+		encodeAns(argv[2], argv[3]);
+		return 0;
+	}
+
+	// -X transforms blocks of the input (BWT, move-to-front and run-length)
+	// before coding them, which suits large archived texts
+	if (argc > 1 && strcmp(argv[1], "-X") == 0) {
+		char *end;
+		long blockKB = argc == 5 ? strtol(argv[2], &end, 10) : 0;
+		if (argc != 5 || *end != '\0' || blockKB <= 0 || blockKB > BWT_MAX_BLOCK_SIZE / 1024) {
+			usage(progName);
+		}
+		encodeBwt(argv[3], blockKB, argv[4]);
+		return 0;
+	}
+
+	// -I deals the tokens across several bitstreams that decode side by side
+	if (argc > 1 && strcmp(argv[1], "-I") == 0) {
+		char *end;
+		long numStreams = argc == 6 ? strtol(argv[2], &end, 10) : 0;
+		if (argc != 6 || *end != '\0' || numStreams < 1 || numStreams > CODEC_MAX_STREAMS) {
+			usage(progName);
+		}
+		encodeInterleaved(argv[3], argv[4], numStreams, argv[5]);
+		return 0;
+	}
+
+	// -P overlaps reading, encoding and writing on three threads
+	if (argc > 1 && strcmp(argv[1], "-P") == 0) {
+		if (argc != 5) {
+			usage(progName);
+		}
+		encodePipelined(argv[2], argv[3], argv[4]);
+		return 0;
+	}
+
+	// -S hands the encoding to a running huffmand
+	if (argc > 1 && strcmp(argv[1], "-S") == 0) {
+		if (argc != 6) {
+			usage(progName);
+		}
+		encodeWithDaemon(argv[2], argv[3], argv[4], argv[5]);
+		return 0;
+	}
+
+	// -T trains a shared tree with an escape leaf from one or more corpora
+	if (argc > 1 && strcmp(argv[1], "-T") == 0) {
+		if (argc < 4) {
+			usage(progName);
+		}
+		struct huffmanTree *tree = createPretrainedHuffmanTree(&argv[3], argc - 3);
+		TreeIOSave(tree, argv[2]);
+		destroyHuffmanTree(tree);
+		return 0;
+	}
+
+	// -b converts a tree file into a binary tree file that decode can map
+	if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+		if (argc != 4) {
+			usage(progName);
+		}
+		writeBinaryTree(argv[2], argv[3]);
+		return 0;
+	}
+
+	// -s <MB>[:<blocks>] builds the tree from a sample of the input, and -r
+	// reports the cost against a tree built from all of it
+	if (argc > 1 && strcmp(argv[1], "-s") == 0) {
+		int64_t sampleBytes;
+		int sampleBlocks;
+		if (argc < 3 || !parseSample(argv[2], &sampleBytes, &sampleBlocks)) {
+			usage(progName);
+		}
+		argc -= 2;
+		argv += 2;
+		bool report = argc > 1 && strcmp(argv[1], "-r") == 0;
+		if (report) {
+			argc--;
+			argv++;
+		}
+		if (argc != 3) {
+			usage(progName);
+		}
+		buildSampledTreeFile(argv[1], argv[2], sampleBytes, sampleBlocks, report);
+		return 0;
+	}
+
+	// -w builds a word alphabet instead of a character alphabet
+	bool words = argc > 1 && strcmp(argv[1], "-w") == 0;
+	if (words) {
+		argc--;
+		argv++;
+	}
+
+	if ((argc != 3 && argc != 4) || (words && argc != 3)) {
+		usage(progName);
 	}
 
 	if (argc == 3) {
-		struct huffmanTree *tree = createHuffmanTree(argv[1]);
-		writeHuffmanTree(tree, argv[2]);
-		freeHuffmanTree(tree);
+		buildTreeFile(argv[1], argv[2], words);
 	} else {
-		struct huffmanTree *tree = readHuffmanTree(argv[2]);
-		char *encoding = encode(tree, argv[1]);
+		char *encoding = encodeWithTreeFile(argv[1], argv[2]);
+		if (encoding == NULL) {
+			exit(EXIT_FAILURE);
+		}
 		writeEncoding(encoding, argv[3]);
-		free(encoding);
-		freeHuffmanTree(tree);
+		AllocFree(ALLOC_BUFFER, encoding);
 	}
 }
 
-////////////////////////////////////////////////////////////////////////
+// Counts the input and writes its tree, reusing a cached tree built from a
+// near-identical histogram when HUFFMAN_CACHE_DIR is set
+static void buildTreeFile(char *inputFilename, char *treeFilename, bool words) {
+	Counter c = words ? countWordTokens(inputFilename, DEFAULT_MIN_WORD_FREQ)
+	                  : countTokens(inputFilename);
+	uint64_t key = 0;
+	if (TreeCacheEnabled()) {
+		key = TreeCacheHistogramKey(c);
+		if (TreeCacheGetTreeFile(key, treeFilename)) {
+			CounterFree(c);
+			return;
+		}
+	}
 
-static struct huffmanTree *readHuffmanTree(char *filename) {
-	FILE *fp = fopen(filename, "r");
-	if (fp == NULL) {
-		fprintf(stderr, "error: failed to open '%s' for reading\n", filename);
+	struct huffmanTree *tree = createHuffmanTreeFromCounter(c);
+	CounterFree(c);
+	if (tree == NULL) {
+		fprintf(stderr, "error: '%s' is empty\n", inputFilename);
 		exit(EXIT_FAILURE);
 	}
+	TreeIOSave(tree, treeFilename);
+	destroyHuffmanTree(tree);
+	TreeCachePutTreeFile(key, treeFilename);
+}
 
-	char buffer[MAX_TOKEN_LEN + 1];
-	struct huffmanTree *tree = readTree(fp, buffer);
-	fclose(fp);
-	return tree;
+// Counts only a sample of the input, so the tree costs a fraction of a full
+// read; the tree has an escape leaf for characters the sample missed
+static void buildSampledTreeFile(char *inputFilename, char *treeFilename,
+                                 int64_t sampleBytes, int sampleBlocks, bool report) {
+	Counter c = countSampledTokens(inputFilename, sampleBytes, sampleBlocks);
+	struct huffmanTree *tree = createHuffmanTreeFromCounter(c);
+	CounterFree(c);
+	if (tree == NULL) {
+		fprintf(stderr, "error: '%s' is empty\n", inputFilename);
+		exit(EXIT_FAILURE);
+	}
+	TreeIOSave(tree, treeFilename);
+	if (report) {
+		reportSampleLoss(tree, inputFilename, sampleBytes);
+	}
+	destroyHuffmanTree(tree);
 }
 
-static struct huffmanTree *readTree(FILE *fp, char buffer[]) {
-	struct huffmanTree *t = newHuffmanNode(NULL, 0);
+// Compares the encoded size with the sampled tree against the exact tree,
+// which means reading the whole input twice more
+static void reportSampleLoss(struct huffmanTree *sampled, char *inputFilename,
+                             int64_t sampleBytes) {
+	struct huffmanTree *exact = createHuffmanTree(inputFilename);
+	int64_t sampledBits = encodedBits(sampled, inputFilename);
+	int64_t exactBits = encodedBits(exact, inputFilename);
+	destroyHuffmanTree(exact);
 
-	int c = fgetc(fp);
+	FILE *fp = openStream(inputFilename, "r");
+	fseeko(fp, 0, SEEK_END);
+	int64_t fileSize = ftello(fp);
+	fclose(fp);
+	if (sampleBytes > fileSize) {
+		sampleBytes = fileSize;
+	}
 
-	if (c == '(') {
-		t->left = readTree(fp, buffer);
-		fgetc(fp); // should always be a ','
-		t->right = readTree(fp, buffer);
-		fgetc(fp); // should always be a ')'
-	} else {
-		int i = 0;
-		while (c != ',' && c != ')') {
-			if (c == '\\') {
-				c = fgetc(fp);
-			}
-			buffer[i++] = c;
-			c = fgetc(fp);
-		}
+	printf("sample: %" PRId64 " of %" PRId64 " bytes (%.2f%%)\n", sampleBytes, fileSize,
+	       fileSize > 0 ? 100.0 * sampleBytes / fileSize : 100.0);
+	printf("sampled tree: %" PRId64 " bits\n", sampledBits);
+	printf("exact tree: %" PRId64 " bits\n", exactBits);
+	printf("ratio loss: %.3f%%\n",
+	       exactBits > 0 ? 100.0 * (sampledBits - exactBits) / exactBits : 0.0);
+}
 
-		ungetc(c, fp);
-		buffer[i] = '\0';
-		t->token = strdup(buffer);
+// Returns the length of the encoding of the input, without encoding it
+static int64_t encodedBits(struct huffmanTree *tree, char *inputFilename) {
+	Codebook cb = CodebookNew(tree);
+	int64_t escapedBytes;
+	Counter c = countEncodedTokens(cb, inputFilename, &escapedBytes);
+	if (c == NULL) {
+		exit(EXIT_FAILURE);
 	}
 
-	return t;
+	int numItems;
+	struct item *items = CounterItems(c, &numItems);
+	int64_t bits = 8 * escapedBytes;
+	for (int i = 0; i < numItems; i++) {
+		char *code = CodebookGet(cb, items[i].token, strlen(items[i].token));
+		bits += items[i].freq * (int64_t)strlen(code);
+	}
+	CounterFreeItems(items, numItems);
+	CounterFree(c);
+	CodebookFree(cb);
+	return bits;
 }
 
-static struct huffmanTree *newHuffmanNode(char *token, int freq) {
-	struct huffmanTree *new = malloc(sizeof(struct huffmanTree));
-	if (new == NULL) {
-		fprintf(stderr, "error: out of memory\n");
-		exit(EXIT_FAILURE);
+// Parses "<MB>[:<blocks>]"
+static bool parseSample(char *arg, int64_t *sampleBytes, int *sampleBlocks) {
+	char *end;
+	double megabytes = strtod(arg, &end);
+	*sampleBlocks = 1;
+	if (*end == ':') {
+		*sampleBlocks = strtol(end + 1, &end, 10);
+	}
+	*sampleBytes = (int64_t)(megabytes * 1024 * 1024);
+	return *end == '\0' && end != arg && *sampleBytes > 0 && *sampleBlocks > 0;
+}
+
+// Encodes the input with the tree file's codebook, which is loaded from the
+// cache instead of being built from the tree when HUFFMAN_CACHE_DIR is set
+static char *encodeWithTreeFile(char *inputFilename, char *treeFilename) {
+	uint64_t key = TreeCacheEnabled() ? TreeCacheFileKey(treeFilename) : 0;
+	Codebook cb = TreeCacheGetCodebook(key);
+	if (cb == NULL) {
+		struct huffmanTree *tree = TreeIORead(treeFilename);
+		cb = CodebookNew(tree);
+		TreeIOFree(tree);
+		TreeCachePutCodebook(key, cb);
 	}
 
-	new->token = token;
-	new->freq = freq;
-	new->left = NULL;
-	new->right = NULL;
-	return new;
+	char *encoding = encodeWithCodebook(cb, inputFilename);
+	CodebookFree(cb);
+	return encoding;
 }
 
-static void freeHuffmanTree(struct huffmanTree *t) {
-	if (t != NULL) {
-		freeHuffmanTree(t->left);
-		freeHuffmanTree(t->right);
-		free(t->token);
-		free(t);
+////////////////////////////////////////////////////////////////////////
+
+// Writes the tree as a flat node array that can be used without parsing
+static void writeBinaryTree(char *treeFilename, char *binaryFilename) {
+	struct huffmanTree *tree = TreeIORead(treeFilename);
+	FlatTree ft = FlatTreeNew(tree);
+	TreeIOFree(tree);
+
+	FILE *fp = fopen(binaryFilename, "wb");
+	if (fp == NULL) {
+		fprintf(stderr, "error: failed to open '%s' for writing\n", binaryFilename);
+		exit(EXIT_FAILURE);
 	}
+	FlatTreeWrite(ft, fp);
+	if (ferror(fp) || fclose(fp) != 0) {
+		fprintf(stderr, "error: failed to write '%s'\n", binaryFilename);
+		exit(EXIT_FAILURE);
+	}
+	FlatTreeFree(ft);
 }
 
 ////////////////////////////////////////////////////////////////////////
 
-static void writeHuffmanTree(struct huffmanTree *tree, char *filename) {
+static void writeEncoding(char *encoding, char *filename) {
 	FILE *fp = fopen(filename, "w");
 	if (fp == NULL) {
 		fprintf(stderr, "error: failed to open '%s' for writing\n", filename);
 		exit(EXIT_FAILURE);
 	}
 
-	writeTree(tree, fp);
-
+	StatsBegin(STATS_WRITE_OUTPUT);
+	size_t len = strlen(encoding);
+	fwrite(encoding, 1, len, fp);
 	fclose(fp);
+	StatsEnd(STATS_WRITE_OUTPUT);
+	StatsAdd(STATS_BYTES_OUT, len);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Encodes the input in one pass; "-" reads stdin or writes stdout
+static void encodeAdaptive(char *inputFilename, char *encodingFilename) {
+	FILE *in = openStream(inputFilename, "r");
+	FILE *out = openStream(encodingFilename, "w");
+	AdaptiveEncodeStream(in, out);
+	if (in != stdin) {
+		fclose(in);
+	}
+	if (out != stdout) {
+		fclose(out);
+	}
+}
+
+// Writes the block encoding of the input, in binary; "-" reads stdin or
+// writes stdout
+static void encodeBlocks(char *inputFilename, long blockKB, char *encodingFilename) {
+	size_t inLen;
+	char *in = readFile(inputFilename, &inLen);
+	size_t outLen;
+	unsigned char *out = BlockEncode(in, inLen, blockKB * 1024, &outLen);
+	if (out == NULL) {
+		fprintf(stderr, "error: '%s' has a NUL byte\n", inputFilename);
+		exit(EXIT_FAILURE);
+	}
+	AllocFree(ALLOC_IO, in);
+	writeBytes(out, outLen, encodingFilename);
+	AllocFree(ALLOC_BUFFER, out);
+}
+
+// Writes the tANS encoding of the input, in binary
+static void encodeAns(char *inputFilename, char *encodingFilename) {
+	size_t inLen;
+	char *in = readFile(inputFilename, &inLen);
+	size_t outLen;
+	unsigned char *out = AnsEncode(in, inLen, &outLen);
+	if (out == NULL) {
+		fprintf(stderr, "error: '%s' has a NUL byte or too many distinct characters\n",
+		        inputFilename);
+		exit(EXIT_FAILURE);
+	}
+	AllocFree(ALLOC_IO, in);
+	writeBytes(out, outLen, encodingFilename);
+	AllocFree(ALLOC_BUFFER, out);
+}
+
+// Writes the transformed block encoding of the input, in binary
+static void encodeBwt(char *inputFilename, long blockKB, char *encodingFilename) {
+	size_t inLen;
+	char *in = readFile(inputFilename, &inLen);
+	size_t outLen;
+	unsigned char *out = BwtEncode(in, inLen, blockKB * 1024, &outLen);
+	AllocFree(ALLOC_IO, in);
+	writeBytes(out, outLen, encodingFilename);
+	AllocFree(ALLOC_BUFFER, out);
+}
+
+// Writes the interleaved encoding of the input with the tree, in binary
+static void encodeInterleaved(char *inputFilename, char *treeFilename, int numStreams,
+                              char *encodingFilename) {
+	HuffmanCodec codec = codecFromTreeFile(treeFilename);
+	size_t inLen;
+	char *in = readFile(inputFilename, &inLen);
+	size_t outLen;
+	unsigned char *out = InterleavedEncode(codec, in, inLen, numStreams, &outLen);
+	if (out == NULL) {
+		fprintf(stderr, "error: '%s' has characters that are not in '%s'\n",
+		        inputFilename, treeFilename);
+		exit(EXIT_FAILURE);
+	}
+	AllocFree(ALLOC_IO, in);
+	CodecFree(codec);
+	writeBytes(out, outLen, encodingFilename);
+	AllocFree(ALLOC_BUFFER, out);
+}
+
+static void writeBytes(unsigned char *data, size_t len, char *filename) {
+	FILE *fp = openStream(filename, "w");
+	StatsBegin(STATS_WRITE_OUTPUT);
+	if (fwrite(data, 1, len, fp) != len) {
+		fprintf(stderr, "error: failed to write '%s'\n", filename);
+		exit(EXIT_FAILURE);
+	}
+	StatsEnd(STATS_WRITE_OUTPUT);
+	if (fp != stdout) {
+		fclose(fp);
+	}
+}
+
+// Encodes the input with the tree while the next chunk is read and the
+// last one written. The encoding is the same as without -P.
+static void encodePipelined(char *inputFilename, char *treeFilename, char *encodingFilename) {
+	struct chunkEncoder encoder = {codecFromTreeFile(treeFilename), NULL, 0};
+	struct textReader reader = {
+		openStream(inputFilename, "r"), CodecHasWords(encoder.codec), NULL, 0, 0,
+	};
+	FILE *out = openStream(encodingFilename, "w");
+	struct pipelineStages stages = {
+		readTextChunk, &reader, encodeChunk, &encoder, writeChunk, out,
+	};
+	if (!PipelineRun(&stages, PIPELINE_CHUNKS, PIPELINE_CHUNK_SIZE)) {
+		exit(EXIT_FAILURE);
+	}
+	if (reader.fp != stdin) {
+		fclose(reader.fp);
+	}
+	if (out != stdout && fclose(out) != 0) {
+		fprintf(stderr, "error: failed to write '%s'\n", encodingFilename);
+		exit(EXIT_FAILURE);
+	}
+	AllocFree(ALLOC_IO, reader.carry);
+	AllocFree(ALLOC_BUFFER, encoder.bits);
+	CodecFree(encoder.codec);
+}
+
+// Reads a chunk that ends on a token boundary, so that chunks encode
+// independently; the rest is carried over to the front of the next chunk
+static bool readTextChunk(void *state, struct chunk *in) {
+	struct textReader *r = state;
+	StatsBegin(STATS_READ_INPUT);
+	PipelineReserve(in, r->carryLen);
+	if (r->carryLen > 0) {
+		memcpy(in->data, r->carry, r->carryLen);
+	}
+	in->len = r->carryLen;
+	r->carryLen = 0;
+
+	size_t cut = 0;
+	while (cut == 0) {
+		in->len += fread(&in->data[in->len], 1, in->cap - in->len, r->fp);
+		if (in->len < in->cap) {
+			in->last = true;
+			break;
+		}
+		cut = lastTokenBoundary(in, r->words);
+		if (cut == 0) {
+			if (in->cap >= PIPELINE_MAX_CHUNK_SIZE) {
+				StatsEnd(STATS_READ_INPUT);
+				fprintf(stderr, "error: the input has no token boundary in %d bytes\n",
+				        PIPELINE_MAX_CHUNK_SIZE);
+				return false;
+			}
+			PipelineReserve(in, 2 * in->cap);
+		}
+	}
+	if (!in->last) {
+		r->carryLen = in->len - cut;
+		if (r->carryLen > r->carryCap) {
+			r->carryCap = in->cap;
+			r->carry = AllocRealloc(ALLOC_IO, r->carry, r->carryCap);
+		}
+		memcpy(r->carry, &in->data[cut], r->carryLen);
+		in->len = cut;
+	}
+	StatsEnd(STATS_READ_INPUT);
+	StatsAdd(STATS_BYTES_IN, in->len);
+	if (ferror(r->fp)) {
+		fprintf(stderr, "error: failed to read the input\n");
+		return false;
+	}
+	return true;
 }
 
-static void writeTree(struct huffmanTree *t, FILE *fp) {
-	if (t->left == NULL && t->right == NULL) {
-		for (int i = 0; t->token[i] != '\0'; i++) {
-			char c = t->token[i];
-			if (c == '(' || c == ')' || c == ',' || c == '\\') {
-				fprintf(fp, "\\");
+// Returns the last position in the chunk that no token of valid UTF-8 spans,
+// so the text before it encodes the same on its own, or 0 if there is none.
+// Every character starts at a byte that is not a continuation byte. Words
+// are runs of letters, so with words the cut is at a byte that is not a
+// letter, or in the middle of a run too long to be a word on either side.
+static size_t lastTokenBoundary(struct chunk *c, bool words) {
+	int letters = 0;
+	for (size_t i = c->len; i-- > 1; ) {
+		unsigned char ch = c->data[i];
+		if (words && isalpha(ch)) {
+			letters++;
+			if (letters == 2 * (MAX_WORD_LEN + 1)) {
+				return i + MAX_WORD_LEN + 1;
 			}
-			fprintf(fp, "%c", c);
+			continue;
+		}
+		letters = 0;
+		if ((ch & 0xC0) != 0x80) {
+			return i;
 		}
-	} else if (t->left == NULL || t->right == NULL) {
-		fprintf(
-			stderr,
-			"error: found node with exactly one child\n"
-			"       all nodes should have zero or two children\n"
-		);
+	}
+	return 0;
+}
+
+static bool encodeChunk(void *state, struct chunk *in, struct chunk *out) {
+	struct chunkEncoder *e = state;
+	StatsBegin(STATS_ENCODE);
+	size_t cap = CodecMaxEncodedSize(e->codec, in->len);
+	if (cap > e->bitsCap) {
+		AllocFree(ALLOC_BUFFER, e->bits);
+		e->bits = AllocMalloc(ALLOC_BUFFER, cap);
+		e->bitsCap = cap;
+	}
+	int64_t numBits = CodecEncode(e->codec, in->data, in->len, e->bits, cap);
+	if (numBits < 0) {
+		fprintf(stderr, "error: the input has characters that are not in the tree\n");
+		return false;
+	}
+	PipelineReserve(out, numBits + 1);
+	BitsToText(e->bits, numBits, out->data);
+	out->len = numBits;
+	StatsEnd(STATS_ENCODE);
+	return true;
+}
+
+static bool writeChunk(void *state, struct chunk *out) {
+	StatsBegin(STATS_WRITE_OUTPUT);
+	bool ok = fwrite(out->data, 1, out->len, (FILE *)state) == out->len;
+	StatsEnd(STATS_WRITE_OUTPUT);
+	StatsAdd(STATS_BYTES_OUT, out->len);
+	if (!ok) {
+		fprintf(stderr, "error: failed to write the encoding\n");
+	}
+	return ok;
+}
+
+// Encodes the input through the daemon listening on the socket path
+// The daemon loads the tree once and keeps it, so only the input and the
+// bits cross the socket
+static void encodeWithDaemon(char *socketPath, char *inputFilename,
+                             char *treeFilename, char *encodingFilename) {
+	char treePath[PATH_MAX];
+	if (realpath(treeFilename, treePath) == NULL) {
+		fprintf(stderr, "error: failed to open '%s' for reading\n", treeFilename);
+		exit(EXIT_FAILURE);
+	}
+	int fd = DaemonConnect(socketPath);
+	if (fd < 0) {
+		fprintf(stderr, "error: failed to connect to '%s'\n", socketPath);
+		exit(EXIT_FAILURE);
+	}
+
+	size_t inLen;
+	char *in = readFile(inputFilename, &inLen);
+	unsigned char *bits;
+	size_t numBytes;
+	uint64_t numBits;
+	if (!DaemonEncode(fd, treePath, in, inLen, &bits, &numBytes, &numBits)) {
 		exit(EXIT_FAILURE);
-	} else {
-		fprintf(fp, "(");
-		writeTree(t->left, fp);
-		fprintf(fp, ",");
-		writeTree(t->right, fp);
-		fprintf(fp, ")");
 	}
+	close(fd);
+	AllocFree(ALLOC_IO, in);
+
+	char *encoding = AllocMalloc(ALLOC_BUFFER, numBits + 1);
+	BitsToText(bits, numBits, encoding);
+	writeEncoding(encoding, encodingFilename);
+	AllocFree(ALLOC_BUFFER, encoding);
+	AllocFree(ALLOC_BUFFER, bits);
 }
 
-////////////////////////////////////////////////////////////////////////
+// Reads the whole file into memory
+static char *readFile(char *filename, size_t *len) {
+	FILE *fp = openStream(filename, "r");
+	size_t size = 4096;
+	char *data = AllocMalloc(ALLOC_IO, size);
+	*len = 0;
+	while (true) {
+		*len += fread(data + *len, 1, size - *len, fp);
+		if (*len < size) {
+			break;
+		}
+		size *= 2;
+		data = AllocRealloc(ALLOC_IO, data, size);
+	}
+	if (fp != stdin) {
+		fclose(fp);
+	}
+	return data;
+}
 
-static void writeEncoding(char *encoding, char *filename) {
-	FILE *fp = fopen(filename, "w");
+static HuffmanCodec codecFromTreeFile(char *treeFilename) {
+	struct huffmanTree *tree = TreeIORead(treeFilename);
+	HuffmanCodec codec = CodecNewFromTree(tree);
+	TreeIOFree(tree);
+	if (codec == NULL) {
+		fprintf(stderr, "error: '%s' has a code longer than 64 bits\n", treeFilename);
+		exit(EXIT_FAILURE);
+	}
+	return codec;
+}
+
+static FILE *openStream(char *filename, char *mode) {
+	if (strcmp(filename, "-") == 0) {
+		return mode[0] == 'r' ? stdin : stdout;
+	}
+
+	FILE *fp = fopen(filename, mode);
 	if (fp == NULL) {
-		fprintf(stderr, "error: failed to open '%s' for writing\n", filename);
+		fprintf(stderr, "error: failed to open '%s' for %s\n", filename,
+		        mode[0] == 'r' ? "reading" : "writing");
 		exit(EXIT_FAILURE);
 	}
+	return fp;
+}
 
-	fprintf(fp, "%s", encoding);
-	fclose(fp);
+////////////////////////////////////////////////////////////////////////
+
+static void usage(char *progName) {
+	fprintf(stderr,
+	        "usage: %s [--stats] [-w] <input filename> <tree filename>\n"
+	        "       %s -s <sample MB>[:<blocks>] [-r] <input filename> <tree filename>\n"
+	        "       %s <input filename> <tree filename> <encoding filename>\n"
+	        "       %s -a <input filename|-> <encoding filename|->\n"
+	        "       %s -A <input filename|-> <encoding filename|->\n"
+	        "       %s -B <block KB> <input filename|-> <encoding filename|->\n"
+	        "       %s -I <streams> <input filename|-> <tree filename> "
+	        "<encoding filename|->\n"
+	        "       %s -P <input filename|-> <tree filename> <encoding filename|->\n"
+	        "       %s -X <block KB> <input filename|-> <encoding filename|->\n"
+	        "       %s -T <tree filename> <corpus filename>...\n"
+	        "       %s -b <tree filename> <binary tree filename>\n"
+	        "       %s -S <socket path> <input filename> <tree filename> "
+	        "<encoding filename>\n",
+	        progName, progName, progName, progName, progName, progName, progName,
+	        progName, progName, progName, progName, progName);
+	exit(EXIT_FAILURE);
 }
 
 ////////////////////////////////////////////////////////////////////////
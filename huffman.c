@@ -8,95 +8,275 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <sys/types.h>
 
+#include "Alloc.h"
+#include "Codebook.h"
 #include "Counter.h"
 #include "File.h"
+#include "Stats.h"
+#include "Tokenizer.h"
 #include "huffman.h"
 
-// Structs definition
-struct huffmanEncodedData {
-    char letter;
-    char *encoding;
-};
-
 // Helper Functions
-struct huffmanTree *createHuffmanTreeNode(char *token, int frequency);
+struct huffmanTree *createHuffmanTreeNode(char *token, int64_t frequency);
 int compareHuffmanTreeNodesByFrequency(const void *a, const void *b);
 char *FileToString(File file);
-char *encodeCharacter(struct huffmanTree *tree, char inputCharacter);
-bool encodeCharacterDFS(struct huffmanTree *node, char inputCharacter, char *path, char **encoding);
+char *escapeToken(char *escapeCode, char *token, int tokenLen, char *buffer);
+char *nextCode(Codebook cb, char *text, size_t i, size_t *wordEnd, int *tokenLen);
+void writeToken(File file, char *token);
 
 // Task 1
 // Decode the encoded text using the huffman tree
 void decode(struct huffmanTree *tree, char *encoding, char *outputFilename) {
+	StatsBegin(STATS_DECODE);
+	StatsTreeShape(tree);
 	// Setup output file
 	struct file *outputFile = FileOpenToWrite(outputFilename);
     // Traverse the Huffman tree while decoding the text
 	struct huffmanTree *root = tree;
-    for (int i = 0; encoding[i] != '\0'; i++) {
-        if (encoding[i] == '0') {
+    bool loneLeaf = root->left == NULL && root->right == NULL;
+    for (size_t i = 0; encoding[i] != '\0'; i++) {
+        if (loneLeaf) {
+            // The lone leaf's code is a single 0, and no code starts with 1
+            if (encoding[i] == '1') {
+                fprintf(stderr, "error: the encoding has bits that start no code of the tree\n");
+                exit(EXIT_FAILURE);
+            } else if (encoding[i] != '0') {
+                continue;
+            }
+        } else if (encoding[i] == '0') {
             tree = tree->left;
         } else if (encoding[i] == '1') {
             tree = tree->right;
         }
 		// If leaf node, add character to output file
         if (tree->left == NULL && tree->right == NULL) {
-            FileWrite(outputFile, tree->token);
+            if (strcmp(tree->token, ESCAPE_TOKEN) == 0) {
+                // The token is not in the tree and follows as raw bytes
+                char token[MAX_TOKEN_LEN + 1];
+                if (!decodeEscapedToken(encoding, &i, token)) {
+                    break;
+                }
+                writeToken(outputFile, token);
+            } else {
+                writeToken(outputFile, tree->token);
+            }
             tree = root;
         }
     }
     FileClose(outputFile);
+    StatsEnd(STATS_DECODE);
 }
 
 // Task 3
 // Create a huffman tree from the input file
 struct huffmanTree *createHuffmanTree(char *inputFilename) {
+    struct counter *c = countTokens(inputFilename);
+    struct huffmanTree *huffmanRoot = createHuffmanTreeFromCounter(c);
+    CounterFree(c);
+    return huffmanRoot;
+}
+
+// Create a huffman tree whose alphabet contains whole words as well as characters
+// Words seen fewer than minWordFreq times are counted as separate characters
+struct huffmanTree *createHuffmanTreeWords(char *inputFilename, int minWordFreq) {
+    struct counter *c = countWordTokens(inputFilename, minWordFreq);
+    struct huffmanTree *huffmanRoot = createHuffmanTreeFromCounter(c);
+    CounterFree(c);
+    return huffmanRoot;
+}
+
+// Create a pretrained huffman tree from several corpora
+// The tree has an escape leaf, so it can encode any input (see encodeWithCodebook)
+struct huffmanTree *createPretrainedHuffmanTree(char **inputFilenames, int numFiles) {
+    // Read tokens from every corpus into one counter
+    struct counter *c = CounterNew();
+    char token[MAX_TOKEN_LEN + 1];
+    for (int f = 0; f < numFiles; f++) {
+        struct file *inputFile = FileOpenToRead(inputFilenames[f]);
+        while (FileReadToken(inputFile, token)) {
+            CounterAdd(c, token);
+        }
+        FileClose(inputFile);
+    }
+
+    // Give the escape leaf one occurrence per distinct token seen, as an
+    // estimate of how often new tokens turn up
+    int numItems = CounterNumItems(c);
+    CounterAddCount(c, ESCAPE_TOKEN, numItems > 0 ? numItems : 1);
+
+    struct huffmanTree *huffmanRoot = createHuffmanTreeFromCounter(c);
+    CounterFree(c);
+    return huffmanRoot;
+}
+
+// Count the characters of text, which need not end with a null-terminator.
+// A character cut off by the end of text is counted as the bytes left.
+Counter countTextTokens(const char *text, size_t len, uint64_t *numTokens) {
+    StatsBegin(STATS_COUNT);
+    Counter c = CounterNew();
+    char token[MAX_TOKEN_LEN + 1];
+    *numTokens = 0;
+    for (size_t i = 0; i < len; (*numTokens)++) {
+        int tokenLen = TokenCharLen((char *)&text[i]);
+        if (i + tokenLen > len) {
+            tokenLen = len - i;
+        }
+        memcpy(token, &text[i], tokenLen);
+        token[tokenLen] = '\0';
+        CounterAdd(c, token);
+        i += tokenLen;
+    }
+    StatsEnd(STATS_COUNT);
+    StatsAdd(STATS_TOKENS_IN, *numTokens);
+    StatsAdd(STATS_BYTES_IN, len);
+    return c;
+}
+
+// Count the frequency of every character in the input file
+Counter countTokens(char *inputFilename) {
     // Read tokens from the input file and count token frequencies
     struct file *inputFile = FileOpenToRead(inputFilename);
     struct counter *c = CounterNew();
     char token[MAX_TOKEN_LEN + 1];
+    // Reading and counting alternate token by token, so the loop is timed
+    // as a whole rather than paying for two timers per token
+    StatsBegin(STATS_COUNT);
+    uint64_t numTokens = 0;
+    uint64_t numBytes = 0;
     while (FileReadToken(inputFile, token)) {
-        if (isalpha(token[0]) || token[0] == ' ') {
-            CounterAdd(c, token);
-        }
+        numTokens++;
+        numBytes += strlen(token);
+        CounterAdd(c, token);
     }
+    StatsEnd(STATS_COUNT);
+    StatsAdd(STATS_TOKENS_IN, numTokens);
+    StatsAdd(STATS_BYTES_IN, numBytes);
     FileClose(inputFile);
+    return c;
+}
 
-    // Create leaf nodes for each token with its frequency
-    int numItems;
-    struct item *items = CounterItems(c, &numItems);    // 10 items in the array
-
-    // Allocate memory for nodes
-    struct huffmanTree **nodes = (struct huffmanTree **)malloc((numItems) * sizeof(struct huffmanTree));
-    for (int i = 0; i < numItems; i++) {
-        nodes[i] = createHuffmanTreeNode(items[i].token, items[i].freq);
+// Count the frequency of every token of the word alphabet in the input file
+Counter countWordTokens(char *inputFilename, int minWordFreq) {
+    // Get text from input file
+    struct file *inputFile = FileOpenToRead(inputFilename);
+    char *inputText = FileToString(inputFile);
+    FileClose(inputFile);
+    struct counter *c = CounterNew();
+    if (inputText == NULL) {
+        return c;
+    }
+    StatsBegin(STATS_COUNT);
+
+    // First pass: count every word that could become a token
+    struct counter *words = CounterNew();
+    char token[MAX_WORD_LEN + 1];
+    for (size_t i = 0; inputText[i] != '\0'; ) {
+        int wordLen = TokenWordLen(&inputText[i]);
+        if (TokenWordFits(wordLen)) {
+            memcpy(token, &inputText[i], wordLen);
+            token[wordLen] = '\0';
+            CounterAdd(words, token);
+        }
+        i += wordLen > 0 ? wordLen : TokenCharLen(&inputText[i]);
     }
 
-    // Create huffman tree by combining smallest nodes
-    while (numItems > 1) {
-        qsort(nodes, numItems, sizeof(struct huffmanTree *), compareHuffmanTreeNodesByFrequency);
-        // Create a new node with the two smallest frequency nodes as children
-        struct huffmanTree *newNode = createHuffmanTreeNode(NULL, nodes[0]->freq + nodes[1]->freq);
-        newNode->left = nodes[0];
-        newNode->right = nodes[1];
-
-        // Remove the two smallest nodes and add the new node
-        nodes[0] = newNode;
-        nodes[1] = nodes[numItems - 1];
-        numItems--;
+    // Second pass: count frequent words as tokens and spell out the rest
+    size_t wordEnd = 0;
+    for (size_t i = 0; inputText[i] != '\0'; ) {
+        int tokenLen = 0;
+        if (i >= wordEnd) {
+            int wordLen = TokenWordLen(&inputText[i]);
+            wordEnd = i + wordLen;
+            if (TokenWordFits(wordLen)) {
+                memcpy(token, &inputText[i], wordLen);
+                token[wordLen] = '\0';
+                if (CounterGet(words, token) >= minWordFreq) {
+                    tokenLen = wordLen;
+                }
+            }
+        }
+        if (tokenLen == 0) {
+            tokenLen = TokenCharLen(&inputText[i]);
+        }
+
+        memcpy(token, &inputText[i], tokenLen);
+        token[tokenLen] = '\0';
+        CounterAdd(c, token);
+        StatsAdd(STATS_TOKENS_IN, 1);
+        i += tokenLen;
     }
+    StatsEnd(STATS_COUNT);
 
-    struct huffmanTree *huffmanRoot = nodes[0];
+    CounterFree(words);
+    AllocFree(ALLOC_IO, inputText);
+    return c;
+}
 
-    // Free memory
-    free(nodes);
-    for (int i = 0; i < numItems; i++) {
-        free(items[i].token);
+// Count the characters of a sample of the input file: numBlocks blocks
+// spaced evenly across the file, sampleBytes in total, so one block is the
+// start of the file. Unless the sample covers the whole file, the counter
+// also gets an escape leaf weighted by the characters seen only once, the
+// Good-Turing estimate of how often unseen characters turn up.
+Counter countSampledTokens(char *inputFilename, int64_t sampleBytes, int numBlocks) {
+    FILE *fp = fopen(inputFilename, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "error: failed to open '%s' for reading\n", inputFilename);
+        exit(EXIT_FAILURE);
     }
-    free(items);
-    CounterFree(c);
+    fseeko(fp, 0, SEEK_END);
+    off_t fileSize = ftello(fp);
+    bool wholeFile = sampleBytes >= fileSize;
+    if (wholeFile || numBlocks < 1) {
+        numBlocks = 1;
+    }
+    size_t blockBytes = wholeFile ? fileSize : sampleBytes / numBlocks;
+    off_t stride = fileSize / numBlocks;
 
-    return huffmanRoot;
+    struct counter *c = CounterNew();
+    char *block = AllocMalloc(ALLOC_IO, blockBytes + 1);
+    char token[MAX_TOKEN_LEN + 1];
+    for (int b = 0; b < numBlocks; b++) {
+        StatsBegin(STATS_READ_INPUT);
+        fseeko(fp, b * stride, SEEK_SET);
+        size_t n = fread(block, 1, blockBytes, fp);
+        StatsEnd(STATS_READ_INPUT);
+        StatsAdd(STATS_BYTES_IN, n);
+
+        // Blocks may start and end part way through a character
+        size_t i = 0;
+        while (b > 0 && i < n && (block[i] & 0xC0) == 0x80) {
+            i++;
+        }
+        StatsBegin(STATS_COUNT);
+        while (i < n) {
+            int tokenLen = TokenCharLen(&block[i]);
+            if (i + tokenLen > n) {
+                break;
+            }
+            memcpy(token, &block[i], tokenLen);
+            token[tokenLen] = '\0';
+            CounterAdd(c, token);
+            StatsAdd(STATS_TOKENS_IN, 1);
+            i += tokenLen;
+        }
+        StatsEnd(STATS_COUNT);
+    }
+    AllocFree(ALLOC_IO, block);
+    fclose(fp);
+
+    if (!wholeFile) {
+        int numItems;
+        struct item *items = CounterItems(c, &numItems);
+        int64_t singletons = 0;
+        for (int i = 0; i < numItems; i++) {
+            singletons += items[i].freq == 1;
+        }
+        CounterFreeItems(items, numItems);
+        CounterAddCount(c, ESCAPE_TOKEN, singletons > 0 ? singletons : 1);
+    }
+    return c;
 }
 
 // Task 4
@@ -107,48 +287,151 @@ char *encode(struct huffmanTree *tree, char *inputFilename) {
         return NULL;
     }
 
+    Codebook cb = CodebookNew(tree);
+    char *encodedText = encodeWithCodebook(cb, inputFilename);
+    CodebookFree(cb);
+    return encodedText;
+}
+
+// Encode the input file using a codebook built from a huffman tree
+// Words are encoded as a single token when the codebook contains them, and
+// character by character otherwise. Characters that are not in the codebook
+// are escaped if the tree has an escape leaf.
+char *encodeWithCodebook(Codebook cb, char *inputFilename) {
     // Get text from input file
     struct file *inputFile = FileOpenToRead(inputFilename);
     char *inputText = FileToString(inputFile);
     FileClose(inputFile);
-   
-    // Initialize a buffer for encoded text
-    char *encodedText = malloc(1);
-    encodedText[0] = '\0';
+    if (inputText == NULL) {
+        inputText = AllocStrdup(ALLOC_IO, "");
+    }
+    StatsBegin(STATS_ENCODE);
+
+    // Initialize a buffer for encoded text that doubles as it fills
+    size_t capacity = 64;
+    size_t length = 0;
+    char *encodedText = AllocMalloc(ALLOC_BUFFER, capacity);
+
+    // Escaped characters are written as the escape code and 8 bits per byte
+    char *escapeCode = CodebookGet(cb, ESCAPE_TOKEN, strlen(ESCAPE_TOKEN));
+    char *escaped = NULL;
+    if (escapeCode != NULL) {
+        escaped = AllocMalloc(ALLOC_BUFFER, strlen(escapeCode) + 8 * MAX_TOKEN_LEN + 1);
+    }
 
     // Encode the text based on the Huffman tree
-    for (int i = 0; i < strlen(inputText); i++) {
-        // Get encoding of character
-        char *encoding = encodeCharacter(tree, inputText[i]);
+    size_t wordEnd = 0;
+    uint64_t numTokens = 0;
+    for (size_t i = 0; inputText[i] != '\0'; ) {
+        // Get encoding of the next token
+        int tokenLen;
+        char *encoding = nextCode(cb, inputText, i, &wordEnd, &tokenLen);
+        if (encoding == NULL && escapeCode != NULL) {
+            encoding = escapeToken(escapeCode, &inputText[i], tokenLen, escaped);
+        }
+        if (encoding == NULL) {
+            fprintf(stderr, "error: token '%.*s' is not in the huffman tree\n",
+                    tokenLen, &inputText[i]);
+            AllocFree(ALLOC_BUFFER, encodedText);
+            encodedText = NULL;
+            break;
+        }
 
-        // Allocate enough memory for the result, including previous contents
-        char *newEncodedText = (char *)malloc(strlen(encodedText) + strlen(encoding) + 1);
-        strcpy(newEncodedText, encodedText);
+        // Grow the buffer if needed and append the encoding
+        size_t encodingLen = strlen(encoding);
+        while (length + encodingLen + 1 > capacity) {
+            capacity *= 2;
+            encodedText = AllocRealloc(ALLOC_BUFFER, encodedText, capacity);
+        }
+        memcpy(encodedText + length, encoding, encodingLen);
+        length += encodingLen;
+        i += tokenLen;
+        numTokens++;
+    }
 
-        // Append the encoding to the newEncodedText
-        strcat(newEncodedText, encoding);
+    // Every token read from the input is written as one code
+    StatsAdd(STATS_TOKENS_IN, numTokens);
+    StatsAdd(STATS_TOKENS_OUT, numTokens);
+    if (encodedText != NULL) {
+        encodedText[length] = '\0';
+    }
+    AllocFree(ALLOC_BUFFER, escaped);
+    AllocFree(ALLOC_IO, inputText);
+    StatsEnd(STATS_ENCODE);
+    return encodedText;
+}
 
-        // Free the old encodedText and update the pointer
-        free(encodedText);
-        encodedText = newEncodedText;
+// Count the tree tokens that encodeWithCodebook would write for the input
+// file, without encoding it. Escaped characters are counted as ESCAPE_TOKEN,
+// and their raw bytes are added to escapedBytes. Returns NULL if the input
+// has a token that is neither in the codebook nor escapable.
+Counter countEncodedTokens(struct codebook *cb, char *inputFilename, int64_t *escapedBytes) {
+    struct file *inputFile = FileOpenToRead(inputFilename);
+    char *inputText = FileToString(inputFile);
+    FileClose(inputFile);
+    struct counter *c = CounterNew();
+    *escapedBytes = 0;
+    if (inputText == NULL) {
+        return c;
+    }
 
-        // Free the memory allocated for encoding
-        free(encoding);
+    bool canEscape = CodebookGet(cb, ESCAPE_TOKEN, strlen(ESCAPE_TOKEN)) != NULL;
+    char token[MAX_WORD_LEN + 1];
+    size_t wordEnd = 0;
+    for (size_t i = 0; inputText[i] != '\0'; ) {
+        int tokenLen;
+        if (nextCode(cb, inputText, i, &wordEnd, &tokenLen) != NULL) {
+            memcpy(token, &inputText[i], tokenLen);
+            token[tokenLen] = '\0';
+            CounterAdd(c, token);
+        } else if (canEscape) {
+            CounterAdd(c, ESCAPE_TOKEN);
+            *escapedBytes += tokenLen;
+        } else {
+            fprintf(stderr, "error: token '%.*s' is not in the huffman tree\n",
+                    tokenLen, &inputText[i]);
+            CounterFree(c);
+            c = NULL;
+            break;
+        }
+        i += tokenLen;
     }
+    AllocFree(ALLOC_IO, inputText);
+    return c;
+}
 
-    return encodedText;
+// Read the raw bytes of an escaped token, which start after encoding[*i]
+// Leaves *i at the last bit read. Returns false if the encoding ends first.
+bool decodeEscapedToken(char *encoding, size_t *i, char token[]) {
+    int len = 1;
+    for (int b = 0; b < len; b++) {
+        int byte = 0;
+        for (int k = 0; k < 8; k++) {
+            char bit = encoding[*i + 1];
+            if (bit != '0' && bit != '1') {
+                return false;
+            }
+            byte = (byte << 1) | (bit - '0');
+            (*i)++;
+        }
+        token[b] = (char)byte;
+        if (b == 0) {
+            len = TokenCharLen(token);
+        }
+    }
+    token[len] = '\0';
+    return true;
 }
 
 // -------------------------------------------- Helper Functions --------------------------------------------
 // Create a huffman tree node
-struct huffmanTree *createHuffmanTreeNode(char *token, int frequency) {
+struct huffmanTree *createHuffmanTreeNode(char *token, int64_t frequency) {
     // Allocate memory for the node
-    struct huffmanTree *newNode = (struct huffmanTree *)malloc(sizeof(struct huffmanTree));
-    
+    struct huffmanTree *newNode = AllocMalloc(ALLOC_TREE, sizeof(struct huffmanTree));
+
     // Copy the token into the node
     if (token != NULL) {
-        newNode->token = (char *)malloc(strlen(token) + 1);
-        newNode->token = strcpy(newNode->token, token);
+        newNode->token = AllocStrdup(ALLOC_TREE, token);
     } else {
         newNode->token = NULL;
     }
@@ -160,6 +443,74 @@ struct huffmanTree *createHuffmanTreeNode(char *token, int frequency) {
     return newNode;
 }
 
+// Create a huffman tree from the tokens and frequencies in a counter
+// Returns NULL if the counter is empty
+struct huffmanTree *createHuffmanTreeFromCounter(Counter c) {
+    // Create leaf nodes for each token with its frequency
+    StatsBegin(STATS_BUILD_TREE);
+    int numItems;
+    struct item *items = CounterItems(c, &numItems);
+    StatsAdd(STATS_DISTINCT_TOKENS, numItems);
+    if (numItems == 0) {
+        StatsEnd(STATS_BUILD_TREE);
+        return NULL;
+    }
+
+    // Allocate memory for nodes
+    struct huffmanTree **nodes = AllocMalloc(ALLOC_TREE, numItems * sizeof(struct huffmanTree *));
+    for (int i = 0; i < numItems; i++) {
+        nodes[i] = createHuffmanTreeNode(items[i].token, items[i].freq);
+    }
+
+    // Sort the leaves once. Merged nodes are created in non-decreasing order of
+    // frequency, so they can wait in a second queue instead of being re-sorted
+    qsort(nodes, numItems, sizeof(struct huffmanTree *), compareHuffmanTreeNodesByFrequency);
+    struct huffmanTree **merged = AllocMalloc(ALLOC_TREE, numItems * sizeof(struct huffmanTree *));
+    int leafFront = 0;
+    int mergedFront = 0;
+    int mergedBack = 0;
+
+    // Create huffman tree by combining smallest nodes
+    for (int remaining = numItems; remaining > 1; remaining--) {
+        struct huffmanTree *smallest[2];
+        for (int k = 0; k < 2; k++) {
+            if (mergedFront == mergedBack ||
+                    (leafFront < numItems && nodes[leafFront]->freq <= merged[mergedFront]->freq)) {
+                smallest[k] = nodes[leafFront++];
+            } else {
+                smallest[k] = merged[mergedFront++];
+            }
+        }
+
+        // Create a new node with the two smallest frequency nodes as children
+        struct huffmanTree *newNode = createHuffmanTreeNode(NULL, smallest[0]->freq + smallest[1]->freq);
+        newNode->left = smallest[0];
+        newNode->right = smallest[1];
+        merged[mergedBack++] = newNode;
+    }
+
+    struct huffmanTree *huffmanRoot = numItems == 1 ? nodes[0] : merged[mergedBack - 1];
+
+    // Free memory
+    AllocFree(ALLOC_TREE, merged);
+    AllocFree(ALLOC_TREE, nodes);
+    CounterFreeItems(items, numItems);
+
+    StatsEnd(STATS_BUILD_TREE);
+    StatsTreeShape(huffmanRoot);
+    return huffmanRoot;
+}
+
+// Free a tree built by one of the createHuffmanTree functions, node by node
+void destroyHuffmanTree(struct huffmanTree *tree) {
+    if (tree != NULL) {
+        destroyHuffmanTree(tree->left);
+        destroyHuffmanTree(tree->right);
+        AllocFree(ALLOC_TREE, tree->token);
+        AllocFree(ALLOC_TREE, tree);
+    }
+}
+
 // Compare two huffman tree nodes by frequency
 int compareHuffmanTreeNodesByFrequency(const void* a, const void* b) {
     // Set data types
@@ -176,6 +527,39 @@ int compareHuffmanTreeNodesByFrequency(const void* a, const void* b) {
     }
 }
 
+// Return the code of the token at text[i]: the whole word when the codebook
+// has it, otherwise the character. Sets tokenLen to the bytes the token
+// covers, and returns NULL (with tokenLen set to the character) if neither
+// is in the codebook. wordEnd tracks the word being spelled out.
+char *nextCode(Codebook cb, char *text, size_t i, size_t *wordEnd, int *tokenLen) {
+    char *code = NULL;
+    if (i >= *wordEnd) {
+        *tokenLen = TokenWordLen(&text[i]);
+        *wordEnd = i + *tokenLen;
+        if (TokenWordFits(*tokenLen)) {
+            code = CodebookGet(cb, &text[i], *tokenLen);
+        }
+    }
+    if (code == NULL) {
+        *tokenLen = TokenCharLen(&text[i]);
+        code = CodebookGet(cb, &text[i], *tokenLen);
+    }
+    return code;
+}
+
+// Write the escape code followed by the token's bytes, 8 bits each, into buffer
+char *escapeToken(char *escapeCode, char *token, int tokenLen, char *buffer) {
+    size_t codeLen = strlen(escapeCode);
+    memcpy(buffer, escapeCode, codeLen);
+    for (int b = 0; b < tokenLen; b++) {
+        for (int k = 7; k >= 0; k--) {
+            buffer[codeLen++] = (((unsigned char)token[b] >> k) & 1) ? '1' : '0';
+        }
+    }
+    buffer[codeLen] = '\0';
+    return buffer;
+}
+
 // Given a file, return a string containing the file's contents
 char *FileToString(File file) {
     // Check if argument is valid
@@ -183,87 +567,40 @@ char *FileToString(File file) {
         return NULL;
     }
 
+    StatsBegin(STATS_READ_INPUT);
     char arr[MAX_TOKEN_LEN + 1];
     char *string = NULL;
     size_t stringSize = 0;
+    size_t capacity = 0;
 
     while (FileReadToken(file, arr)) {
         size_t tokenLen = strlen(arr);
 
-        // Calculate the new size, including the null-terminator
-        size_t newSize = stringSize + tokenLen + 1;
-
-        // Allocate a new buffer
-        char *newString = (char *)realloc(string, newSize);
-        if (newString == NULL) {
-            free(string);
-            return NULL;
+        // Double the buffer when the token and null-terminator do not fit
+        if (stringSize + tokenLen + 1 > capacity) {
+            size_t newCapacity = capacity == 0 ? 4096 : capacity * 2;
+            string = AllocRealloc(ALLOC_IO, string, newCapacity);
+            capacity = newCapacity;
         }
 
-        // Copy the token into the new buffer
-        strncpy(newString + stringSize, arr, tokenLen);
+        // Copy the token into the buffer
+        memcpy(string + stringSize, arr, tokenLen);
 
         // Update the string size and the null-terminator
-        stringSize = newSize - 1;
-        newString[stringSize] = '\0';
-
-        string = newString;
+        stringSize += tokenLen;
+        string[stringSize] = '\0';
     }
 
+    StatsAdd(STATS_BYTES_IN, stringSize);
+    StatsEnd(STATS_READ_INPUT);
     return string;
 }
 
-// Encode a character using the huffman tree
-char *encodeCharacter(struct huffmanTree *tree, char inputCharacter) {
-    // Check if arguments are valid
-    if (tree == NULL) {
-        return NULL;
-    }
-
-    // Allocate memory for the encoding
-    char *encoding = malloc(1);
-    encoding[0] = '\0';
-    char *path = "";
-
-    // Traverse the tree to find the character
-    encodeCharacterDFS(tree, inputCharacter, path, &encoding);
-
-    return encoding;
+// Write a decoded token to the output file
+void writeToken(File file, char *token) {
+    StatsBegin(STATS_WRITE_OUTPUT);
+    FileWrite(file, token);
+    StatsEnd(STATS_WRITE_OUTPUT);
+    StatsAdd(STATS_TOKENS_OUT, 1);
+    StatsAdd(STATS_BYTES_OUT, strlen(token));
 }
-
-// DFS to find the encoding of a character
-bool encodeCharacterDFS(struct huffmanTree *node, char inputCharacter, char *path, char **encoding) {
-    // If tree is invalid
-    if (node == NULL) {
-        return false;
-    }
-
-    // If the node contains the character, store the encoding and return true
-    if (node->token && node->token[0] == inputCharacter) {
-        *encoding = strdup(path);
-        return true;
-    }
-
-    // Maximum path length of 10
-    char leftPath[10];
-    char rightPath[10];
-
-    // Recursively search the left and right subtrees
-    if (node->left) {
-        strcpy(leftPath, path);
-        strcat(leftPath, "0");
-        if (encodeCharacterDFS(node->left, inputCharacter, leftPath, encoding)) {
-            return true;
-        }
-    }
-
-    if (node->right) {
-        strcpy(rightPath, path);
-        strcat(rightPath, "1");
-        if (encodeCharacterDFS(node->right, inputCharacter, rightPath, encoding)) {
-            return true;
-        }
-    }
-
-    return false; // Character not found in this subtree
-}
\ No newline at end of file
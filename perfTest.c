@@ -0,0 +1,283 @@
+// Performance regression test for the static encoder and decoder
+//
+// For each corpus name.txt (with its tree in name.tree), checks that
+// encoding reproduces expected_encodings/name.enc byte for byte (when that
+// file is not empty) and that decoding gives back the input, then measures
+// encode and decode throughput and compares it with a baseline file. The
+// test fails if any output differs or if any throughput falls more than
+// the threshold below its baseline.
+//
+// Corpora smaller than MIN_GATED_BYTES are still checked for correctness,
+// but their timings are mostly file opening and too noisy to gate on.
+//
+// Baseline lines are "<corpus> <encode MB/s> <decode MB/s>"; lines starting
+// with '#' are ignored. -u rewrites the baseline from this run instead.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Alloc.h"
+#include "TreeIO.h"
+#include "huffman.h"
+
+#define DEFAULT_THRESHOLD 20.0
+#define MIN_RUNS 3
+#define MIN_SECONDS 0.3
+#define MAX_CORPORA 256
+#define MIN_GATED_BYTES (64 * 1024)
+
+struct result {
+    char *corpus;
+    long size;
+    double encodeRate;
+    double decodeRate;
+};
+
+static bool checkCorpus(char *corpus, struct result *r);
+static bool readBaseline(char *filename, char *corpus, double *encodeRate,
+                         double *decodeRate);
+static void writeBaseline(char *filename, struct result *results, int numResults);
+static bool compareRate(char *what, double rate, double baseline, double threshold);
+static char *readFile(char *filename, long *size);
+static char *siblingPath(char *corpus, char *dir, char *extension);
+static double now(void);
+
+static void usage(char *progName);
+
+int main(int argc, char *argv[]) {
+    char *baselineFilename = NULL;
+    double threshold = DEFAULT_THRESHOLD;
+    bool update = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:t:u")) != -1) {
+        if (opt == 'b') {
+            baselineFilename = optarg;
+        } else if (opt == 't') {
+            threshold = atof(optarg);
+        } else if (opt == 'u') {
+            update = true;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (baselineFilename == NULL || optind >= argc || argc - optind > MAX_CORPORA) {
+        usage(argv[0]);
+    }
+
+    struct result results[MAX_CORPORA];
+    int numResults = 0;
+    bool passed = true;
+
+    printf("%-32s %10s %10s %10s %10s\n", "corpus", "enc MB/s", "baseline",
+           "dec MB/s", "baseline");
+    for (int i = optind; i < argc; i++) {
+        struct result *r = &results[numResults++];
+        if (!checkCorpus(argv[i], r)) {
+            passed = false;
+            continue;
+        }
+
+        double encodeBaseline = 0;
+        double decodeBaseline = 0;
+        bool found = !update && readBaseline(baselineFilename, r->corpus,
+                                             &encodeBaseline, &decodeBaseline);
+        printf("%-32s %10.2f %10.2f %10.2f %10.2f\n", r->corpus, r->encodeRate,
+               encodeBaseline, r->decodeRate, decodeBaseline);
+        if (found && r->size >= MIN_GATED_BYTES) {
+            passed &= compareRate("encode", r->encodeRate, encodeBaseline, threshold);
+            passed &= compareRate("decode", r->decodeRate, decodeBaseline, threshold);
+        } else if (!update && !found) {
+            printf("  warning: no baseline for '%s'\n", r->corpus);
+        }
+    }
+
+    if (update) {
+        writeBaseline(baselineFilename, results, numResults);
+        printf("wrote '%s'\n", baselineFilename);
+    }
+    printf(passed ? "perf test passed\n" : "perf test FAILED\n");
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Checks the outputs of one corpus and measures its best throughput
+static bool checkCorpus(char *corpus, struct result *r) {
+    r->corpus = corpus;
+    char *treeFilename = siblingPath(corpus, NULL, ".tree");
+    char *expectedFilename = siblingPath(corpus, "expected_encodings", ".enc");
+    char *outputFilename = strdup("/tmp/perfTestXXXXXX");
+    int fd = mkstemp(outputFilename);
+    if (fd < 0) {
+        fprintf(stderr, "error: failed to create a temporary file\n");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    long size;
+    char *text = readFile(corpus, &size);
+    struct huffmanTree *tree = TreeIORead(treeFilename);
+    bool ok = true;
+
+    double encodeBest = 1e30;
+    double decodeBest = 1e30;
+    double spent = 0;
+    for (int run = 0; ok && (run < MIN_RUNS || spent < MIN_SECONDS); run++) {
+        double start = now();
+        char *encoding = encode(tree, corpus);
+        double encodeSeconds = now() - start;
+        if (encoding == NULL) {
+            printf("  FAIL: '%s' could not be encoded\n", corpus);
+            ok = false;
+            break;
+        }
+
+        start = now();
+        decode(tree, encoding, outputFilename);
+        double decodeSeconds = now() - start;
+
+        // Outputs only need checking once; later runs are for timing
+        if (run == 0) {
+            long expectedSize;
+            char *expected = readFile(expectedFilename, &expectedSize);
+            if (expectedSize > 0 && ((size_t)expectedSize != strlen(encoding) ||
+                    memcmp(expected, encoding, expectedSize) != 0)) {
+                printf("  FAIL: encoding of '%s' differs from '%s'\n", corpus,
+                       expectedFilename);
+                ok = false;
+            }
+            free(expected);
+
+            long decodedSize;
+            char *decoded = readFile(outputFilename, &decodedSize);
+            if (decodedSize != size || memcmp(decoded, text, size) != 0) {
+                printf("  FAIL: '%s' does not decode back to itself\n", corpus);
+                ok = false;
+            }
+            free(decoded);
+        }
+        AllocFree(ALLOC_BUFFER, encoding);
+
+        if (encodeSeconds < encodeBest) encodeBest = encodeSeconds;
+        if (decodeSeconds < decodeBest) decodeBest = decodeSeconds;
+        spent += encodeSeconds + decodeSeconds;
+    }
+
+    r->size = size;
+    r->encodeRate = size / 1e6 / encodeBest;
+    r->decodeRate = size / 1e6 / decodeBest;
+
+    unlink(outputFilename);
+    TreeIOFree(tree);
+    free(text);
+    free(outputFilename);
+    free(expectedFilename);
+    free(treeFilename);
+    return ok;
+}
+
+// Looks up the baseline rates of the corpus
+static bool readBaseline(char *filename, char *corpus, double *encodeRate,
+                         double *decodeRate) {
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        return false;
+    }
+
+    char line[1024];
+    char name[1024];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), fp) != NULL) {
+        found = line[0] != '#' &&
+                sscanf(line, "%1023s %lf %lf", name, encodeRate, decodeRate) == 3 &&
+                strcmp(name, corpus) == 0;
+    }
+    fclose(fp);
+    return found;
+}
+
+static void writeBaseline(char *filename, struct result *results, int numResults) {
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "error: failed to open '%s' for writing\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "# corpus encode_MB/s decode_MB/s\n");
+    for (int i = 0; i < numResults; i++) {
+        fprintf(fp, "%s %.2f %.2f\n", results[i].corpus, results[i].encodeRate,
+                results[i].decodeRate);
+    }
+    fclose(fp);
+}
+
+// Returns false if the rate is more than threshold percent below baseline
+static bool compareRate(char *what, double rate, double baseline, double threshold) {
+    double change = (rate - baseline) / baseline * 100;
+    if (change < -threshold) {
+        printf("  FAIL: %s throughput is %.1f%% below baseline (threshold %.1f%%)\n",
+               what, -change, threshold);
+        return false;
+    }
+    return true;
+}
+
+static char *readFile(char *filename, long *size) {
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "error: failed to open '%s' for reading\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char *text = malloc(*size + 1);
+    if (text == NULL) {
+        fprintf(stderr, "error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *size = fread(text, 1, *size, fp);
+    text[*size] = '\0';
+    fclose(fp);
+    return text;
+}
+
+// Returns dir/name.extension next to the corpus, where name is the corpus
+// file name without its extension
+static char *siblingPath(char *corpus, char *dir, char *extension) {
+    char *slash = strrchr(corpus, '/');
+    int dirLen = slash != NULL ? slash - corpus + 1 : 0;
+    char *name = corpus + dirLen;
+    char *dot = strrchr(name, '.');
+    int nameLen = dot != NULL ? dot - name : (int)strlen(name);
+
+    size_t size = strlen(corpus) + (dir != NULL ? strlen(dir) : 0) + strlen(extension) + 2;
+    char *path = malloc(size);
+    if (path == NULL) {
+        fprintf(stderr, "error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(path, size, "%.*s%s%s%.*s%s", dirLen, corpus, dir != NULL ? dir : "",
+             dir != NULL ? "/" : "", nameLen, name, extension);
+    return path;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+
+static void usage(char *progName) {
+    fprintf(stderr,
+            "usage: %s -b <baseline filename> [-t <threshold %%>] [-u] <corpus>...\n",
+            progName);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Checks that one-pass adaptive encodings round trip for any bytes, through
+# files and pipes, and that cut or foreign encodings are refused
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+n=0
+for f in task1/*.txt task3/*.txt task4/*.txt; do
+    ./encode -a "$f" "$dir/a.enc"
+    ./decode -a "$dir/a.enc" "$dir/a.txt"
+    cmp "$f" "$dir/a.txt"
+    n=$((n + 1))
+done
+echo "Test 1 passed! ($n files)"
+
+# Nothing, one byte, one symbol repeated, and bytes that are not text,
+# through stdin and stdout
+: > "$dir/e.txt"
+printf 'x' > "$dir/one.txt"
+head -c 5000 /dev/zero | tr '\000' 'q' > "$dir/run.txt"
+head -c 100000 /dev/urandom > "$dir/random.bin"
+for f in "$dir/e.txt" "$dir/one.txt" "$dir/run.txt" "$dir/random.bin"; do
+    ./encode -a - - < "$f" | ./decode -a - - | cmp "$f" -
+done
+echo "Test 2 passed!"
+
+# A symbol repeated costs about a bit each once the tree has it
+[ "$(./encode -a "$dir/run.txt" - | wc -c)" -lt 700 ]
+echo "Test 3 passed!"
+
+./encode -a task4/wonderland.txt "$dir/a.enc"
+head -c 2000 "$dir/a.enc" > "$dir/t.enc"
+if ./decode -a "$dir/t.enc" "$dir/a.txt" 2> /dev/null; then
+    exit 1
+fi
+if ./decode -a task4/wonderland.txt "$dir/a.txt" 2> /dev/null; then
+    exit 1
+fi
+echo "Test 4 passed!"
@@ -0,0 +1,72 @@
+#!/bin/sh
+# Checks the memory report and budget: nothing leaks in the main encode and
+# decode paths, and a budget below what a run needs stops it with an error
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# Prints the leaked bytes of every subsystem in a report, one per line
+leaks() {
+    python3 -c 'import json, sys
+for line in open(sys.argv[1]):
+    if line.startswith("{\"program\""):
+        for name, counts in json.loads(line)["memory"].items():
+            print(name, counts["leaked_bytes"])' "$1"
+}
+
+f=task4/war_and_peace.txt
+t=task4/war_and_peace.tree
+export HUFFMAN_MEM_REPORT=1
+./encode -w "$f" "$dir/w.tree" 2> "$dir/report"
+./encode "$f" "$t" "$dir/e.enc" 2>> "$dir/report"
+./decode "$t" "$dir/e.enc" "$dir/e.txt" 2>> "$dir/report"
+./encode -B 64 "$f" "$dir/b.enc" 2>> "$dir/report"
+./decode -B "$dir/b.enc" "$dir/b.txt" 2>> "$dir/report"
+./encode -P "$f" "$t" "$dir/p.enc" 2>> "$dir/report"
+./decode -P "$t" "$dir/p.enc" "$dir/p.txt" 2>> "$dir/report"
+./encode -a "$f" "$dir/a.enc" 2>> "$dir/report"
+./decode -a "$dir/a.enc" "$dir/a.txt" 2>> "$dir/report"
+cmp "$f" "$dir/e.txt"
+cmp "$f" "$dir/b.txt"
+cmp "$f" "$dir/p.txt"
+cmp "$f" "$dir/a.txt"
+[ "$(grep -c '"program"' "$dir/report")" -eq 9 ]
+leaks "$dir/report" > "$dir/leaks"
+[ -z "$(grep -v ' 0$' "$dir/leaks")" ]
+# The adaptive tree and bit writer are counted too
+tail -n 2 "$dir/report" | python3 -c 'import json, sys
+for line in sys.stdin:
+    memory = json.loads(line)["memory"]
+    assert memory["tree"]["allocs"] > 0 and memory["io"]["allocs"] > 0'
+echo "Test 1 passed!"
+
+# The report is off unless asked for
+HUFFMAN_MEM_REPORT=0 ./encode "$f" "$t" "$dir/e.enc" 2> "$dir/report"
+[ ! -s "$dir/report" ]
+unset HUFFMAN_MEM_REPORT
+echo "Test 2 passed!"
+
+# A budget the run fits in changes nothing; a smaller one names the
+# subsystem that went over
+HUFFMAN_MEM_BUDGET=64M ./encode -P "$f" "$t" "$dir/p.enc"
+cmp "$dir/e.enc" "$dir/p.enc"
+if HUFFMAN_MEM_BUDGET=1M ./encode -P "$f" "$t" "$dir/p.enc" 2> "$dir/error"; then
+    exit 1
+fi
+grep -q 'memory budget of 1048576 bytes exceeded: io' "$dir/error"
+if HUFFMAN_MEM_BUDGET=12x ./encode "$f" "$t" "$dir/e.enc" 2> /dev/null; then
+    exit 1
+fi
+echo "Test 3 passed!"
+
+# The tree tools report their allocations too, and leak nothing
+export HUFFMAN_MEM_REPORT=1
+./treePrinter -j "$t" "$dir/t.json" 2> "$dir/report"
+./treeStats "$t" "$f" > /dev/null 2>> "$dir/report"
+./treeCodegen "$t" "$dir/codec.c" 2>> "$dir/report"
+unset HUFFMAN_MEM_REPORT
+[ "$(grep -c '"program"' "$dir/report")" -eq 3 ]
+leaks "$dir/report" > "$dir/leaks"
+[ -z "$(grep -v ' 0$' "$dir/leaks")" ]
+echo "Test 4 passed!"
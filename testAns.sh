@@ -0,0 +1,50 @@
+#!/bin/sh
+# Checks that tANS encodings round trip, come out smaller than the packed
+# huffman encoding of the same counts, and are refused when damaged
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+n=0
+for f in task1/*.txt task3/*.txt task4/*.txt; do
+    ./encode -A "$f" "$dir/a.enc"
+    ./decode -A "$dir/a.enc" "$dir/a.txt"
+    cmp "$f" "$dir/a.txt"
+    n=$((n + 1))
+done
+echo "Test 1 passed! ($n files)"
+
+# Characters outside ASCII, a single repeated character, and nothing
+printf 'h\303\251llo \342\230\203 w\303\266rld \346\227\245\346\234\254\n' > "$dir/u.txt"
+cat task1/anti-hero.txt >> "$dir/u.txt"
+printf 'aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa' > "$dir/r.txt"
+: > "$dir/e.txt"
+for f in "$dir/u.txt" "$dir/r.txt" "$dir/e.txt"; do
+    ./encode -A - - < "$f" | ./decode -A - - | cmp "$f" -
+done
+echo "Test 2 passed!"
+
+# The whole file, table included, is smaller than the huffman bits alone
+for f in task4/war_and_peace.txt task4/wonderland.txt; do
+    ./encode -A "$f" "$dir/a.enc"
+    packed=$(./treeStats "${f%.txt}.tree" "$f" | sed -n 's/^  packed: \([0-9]*\) bytes$/\1/p')
+    [ "$(stat -c %s "$dir/a.enc")" -lt "$packed" ]
+done
+echo "Test 3 passed!"
+
+./encode -A task4/wonderland.txt "$dir/a.enc"
+head -c 1000 "$dir/a.enc" > "$dir/t.enc"
+if ./decode -A "$dir/t.enc" "$dir/a.txt" 2> /dev/null; then
+    exit 1
+fi
+size=$(stat -c %s "$dir/a.enc")
+cp "$dir/a.enc" "$dir/c.enc"
+printf '\125' | dd of="$dir/c.enc" bs=1 seek=$((size / 2)) conv=notrunc 2> /dev/null
+if ./decode -A "$dir/c.enc" "$dir/a.txt" 2> /dev/null && cmp -s "$dir/a.txt" task4/wonderland.txt; then
+    exit 1
+fi
+if printf 'a\000b' | ./encode -A - "$dir/z.enc" 2> /dev/null; then
+    exit 1
+fi
+echo "Test 4 passed!"
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Runs batch over every task directory and checks that its trees and
+# encodings match the ones produced by encode one file at a time
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# A large input makes batch split a file into several chunks
+for i in 1 2 3; do
+    cat task4/war_and_peace.txt
+done > "$dir/big.txt"
+
+./batch -j 4 "$dir/out" task1 task4 "$dir/big.txt"
+
+n=0
+for f in task1/*.txt task4/*.txt "$dir/big.txt"; do
+    name=$(basename "$f" .txt)
+    ./encode "$f" "$dir/expected.tree"
+    ./encode "$f" "$dir/expected.tree" "$dir/expected.enc"
+    cmp "$dir/expected.tree" "$dir/out/$name.tree"
+    cmp "$dir/expected.enc" "$dir/out/$name.enc"
+    n=$((n + 1))
+done
+echo "Test 1 passed! ($n files)"
+
+./batch -w "$dir/words" "$dir/big.txt"
+./encode -w "$dir/big.txt" "$dir/expected.tree"
+./encode "$dir/big.txt" "$dir/expected.tree" "$dir/expected.enc"
+cmp "$dir/expected.tree" "$dir/words/big.tree"
+cmp "$dir/expected.enc" "$dir/words/big.enc"
+echo "Test 2 passed!"
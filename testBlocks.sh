@@ -0,0 +1,84 @@
+#!/bin/sh
+# Checks that block encodings round trip, that blocks of a mixed text beat
+# a single tree, and that damaged encodings are refused
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+n=0
+: > "$dir/empty.txt"
+for f in task4/*.txt "$dir/empty.txt"; do
+    for kb in 1 64 4096; do
+        ./encode -B "$kb" "$f" "$dir/b.enc"
+        ./decode -B "$dir/b.enc" "$dir/b.txt"
+        cmp "$f" "$dir/b.txt"
+        n=$((n + 1))
+    done
+done
+echo "Test 1 passed! ($n encodings)"
+
+# de_anima mixes Greek and English, so trees fitted to each part win even
+# after paying for their headers; the single tree is the tree file plus the
+# packed bits of its encoding
+f=task4/de_anima.txt
+./encode "$f" "$dir/s.tree"
+./encode "$f" "$dir/s.tree" "$dir/s.enc"
+single=$(( $(wc -c < "$dir/s.tree") + ($(wc -c < "$dir/s.enc") + 7) / 8 ))
+./encode -B 256 "$f" "$dir/b.enc"
+blocks=$(wc -c < "$dir/b.enc")
+[ "$blocks" -lt "$single" ]
+echo "Test 2 passed! ($blocks bytes against $single)"
+
+# Truncated encodings and text are not block encodings
+./encode -B 64 task4/wonderland.txt "$dir/b.enc"
+head -c 1000 "$dir/b.enc" > "$dir/t.enc"
+! ./decode -B "$dir/t.enc" "$dir/b.txt" 2>/dev/null
+! ./decode -B task4/wonderland.txt "$dir/b.txt" 2>/dev/null
+echo "Test 3 passed!"
+
+# A longer file being overwritten is cut to the decoded size, and a mapped
+# file, stdout and a pipe all get the same bytes
+f=task4/war_and_peace.txt
+./encode -B 64 task4/wonderland.txt "$dir/b.enc"
+cp "$f" "$dir/b.txt"
+./decode -B "$dir/b.enc" "$dir/b.txt"
+cmp task4/wonderland.txt "$dir/b.txt"
+./decode -B "$dir/b.enc" - | cmp task4/wonderland.txt -
+./decode -B - - < "$dir/b.enc" | cat | cmp task4/wonderland.txt -
+./decode -B "$dir/b.enc" /dev/null
+./encode -B 64 "$dir/empty.txt" "$dir/e.enc"
+./decode -B "$dir/e.enc" "$dir/b.txt"
+[ ! -s "$dir/b.txt" ]
+echo "Test 4 passed!"
+
+# A NUL byte cannot be a token, so it is refused rather than written into
+# an encoding that will not decode; -X takes any bytes
+printf 'ab\000cd\000\000ef' > "$dir/nul.txt"
+if ./encode -B 64 "$dir/nul.txt" "$dir/n.enc" 2> /dev/null; then
+    exit 1
+fi
+./encode -X 64 "$dir/nul.txt" "$dir/n.enc"
+./decode -X "$dir/n.enc" - | cmp "$dir/nul.txt" -
+echo "Test 5 passed!"
+
+# A block claiming more text than its bits can hold is refused before any
+# output is made, and a block that fails to decode leaves no output behind
+printf 'HUFB\001\0\0\0\001\0\0\0\001\0\0\0\0\312\232\073\0\0\0\0' > "$dir/big.enc"
+printf '\002\0\0\0\001a\001\001b\001' >> "$dir/big.enc"
+printf '\0\0\0\0\0\312\232\073\010\0\0\0\0\0\0\0\0' >> "$dir/big.enc"
+rm -f "$dir/b.txt"
+if ./decode -B "$dir/big.enc" "$dir/b.txt" 2> /dev/null; then
+    exit 1
+fi
+[ ! -e "$dir/b.txt" ]
+./encode -B 64 task4/wonderland.txt "$dir/b.enc"
+size=$(stat -c %s "$dir/b.enc")
+cp "$dir/b.enc" "$dir/c.enc"
+printf '\125\252\125\252' | dd of="$dir/c.enc" bs=1 seek=$((size - 500)) conv=notrunc 2> /dev/null
+cp task4/war_and_peace.txt "$dir/b.txt"
+if ./decode -B "$dir/c.enc" "$dir/b.txt" 2> /dev/null; then
+    exit 1
+fi
+[ ! -e "$dir/b.txt" ]
+echo "Test 6 passed!"
@@ -0,0 +1,55 @@
+#!/bin/sh
+# Checks that transformed encodings round trip for any bytes and block
+# size, shrink prose well below its huffman encoding, and are refused when
+# damaged
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+n=0
+for f in task1/*.txt task3/*.txt task4/*.txt; do
+    for kb in 1 900; do
+        ./encode -X "$kb" "$f" "$dir/x.enc"
+        ./decode -X "$dir/x.enc" "$dir/x.txt"
+        cmp "$f" "$dir/x.txt"
+        n=$((n + 1))
+    done
+done
+echo "Test 1 passed! ($n encodings)"
+
+# Nothing, one byte, a long run, a block that repeats itself, and bytes
+# that are not text, through stdin and stdout
+: > "$dir/e.txt"
+printf 'x' > "$dir/one.txt"
+head -c 100000 /dev/zero | tr '\000' 'a' > "$dir/run.txt"
+for i in $(seq 1000); do printf 'abcab'; done > "$dir/period.txt"
+head -c 300000 /dev/urandom > "$dir/random.bin"
+cat "$dir/random.bin" task4/wonderland.txt "$dir/run.txt" > "$dir/mixed.bin"
+for f in "$dir/e.txt" "$dir/one.txt" "$dir/run.txt" "$dir/period.txt" "$dir/random.bin" \
+         "$dir/mixed.bin"; do
+    ./encode -X 64 - - < "$f" | ./decode -X - - | cmp "$f" -
+done
+echo "Test 2 passed!"
+
+# War and peace comes out at less than two thirds of its packed huffman bits
+f=task4/war_and_peace.txt
+./encode -X 900 "$f" "$dir/x.enc"
+packed=$(./treeStats "${f%.txt}.tree" "$f" | sed -n 's/^  packed: \([0-9]*\) bytes$/\1/p')
+[ $(($(stat -c %s "$dir/x.enc") * 3)) -lt $((packed * 2)) ]
+echo "Test 3 passed!"
+
+./encode -X 64 task4/wonderland.txt "$dir/x.enc"
+head -c 1000 "$dir/x.enc" > "$dir/t.enc"
+if ./decode -X "$dir/t.enc" "$dir/x.txt" 2> /dev/null; then
+    exit 1
+fi
+cp "$dir/x.enc" "$dir/c.enc"
+printf '\377\377\377\377' | dd of="$dir/c.enc" bs=1 seek=24 conv=notrunc 2> /dev/null
+if ./decode -X "$dir/c.enc" "$dir/x.txt" 2> /dev/null; then
+    exit 1
+fi
+if ./decode -X task4/wonderland.txt "$dir/x.txt" 2> /dev/null; then
+    exit 1
+fi
+echo "Test 4 passed!"
@@ -0,0 +1,62 @@
+#!/bin/sh
+# Checks that the tree cache changes nothing but speed: trees, encodings
+# and decodings from a cold cache and from cache hits match those made
+# without it, and a missing cache directory is only a miss
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+mkdir "$dir/cache"
+
+# Writes the tree, encoding and decoding of the input to <prefix>.tree,
+# .enc and .txt, and checks the decoding
+run() {
+    ./encode "$1" "$2.tree"
+    ./encode "$1" "$2.tree" "$2.enc"
+    ./decode "$2.tree" "$2.enc" "$2.txt"
+    cmp "$1" "$2.txt"
+}
+
+n=0
+for f in task4/*.txt; do
+    run "$f" "$dir/plain"
+    HUFFMAN_CACHE_DIR="$dir/cache" run "$f" "$dir/cold"
+    entries=$(ls "$dir/cache" | wc -l)
+    HUFFMAN_CACHE_DIR="$dir/cache" run "$f" "$dir/hit"
+    [ "$(ls "$dir/cache" | wc -l)" -eq "$entries" ]
+    for ext in tree enc; do
+        cmp "$dir/plain.$ext" "$dir/cold.$ext"
+        cmp "$dir/plain.$ext" "$dir/hit.$ext"
+    done
+    n=$((n + 1))
+done
+echo "Test 1 passed! ($n files)"
+
+# The same text twice has the same histogram shape, so it gets the cached
+# tree without adding an entry
+f=task4/wonderland.txt
+run "$f" "$dir/plain"
+cat "$f" "$f" > "$dir/twice.txt"
+entries=$(ls "$dir/cache" | wc -l)
+HUFFMAN_CACHE_DIR="$dir/cache" ./encode "$dir/twice.txt" "$dir/twice.tree"
+[ "$(ls "$dir/cache" | wc -l)" -eq "$entries" ]
+cmp "$dir/plain.tree" "$dir/twice.tree"
+echo "Test 2 passed!"
+
+HUFFMAN_CACHE_DIR="$dir/missing" run "$f" "$dir/missing"
+cmp "$dir/plain.tree" "$dir/missing.tree"
+cmp "$dir/plain.enc" "$dir/missing.enc"
+echo "Test 3 passed!"
+
+# A cached codebook whose count is far more than its file holds is a miss,
+# even when the table for that count could not be allocated
+HUFFMAN_CACHE_DIR="$dir/cache" ./encode "$f" "$dir/plain.tree" "$dir/plain.enc"
+for count in 1000000000 200000000; do
+    for cb in "$dir"/cache/*.cb; do
+        { echo "$count"; tail -n +2 "$cb"; } > "$dir/cb" && mv "$dir/cb" "$cb"
+    done
+    HUFFMAN_MEM_BUDGET=64M HUFFMAN_CACHE_DIR="$dir/cache" \
+        timeout 10 ./encode "$f" "$dir/plain.tree" "$dir/bad.enc"
+    cmp "$dir/plain.enc" "$dir/bad.enc"
+done
+echo "Test 4 passed!"
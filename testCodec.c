@@ -0,0 +1,231 @@
+// Main program for testing the HuffmanCodec ADT
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Counter.h"
+#include "HuffmanCodec.h"
+#include "Tokenizer.h"
+#include "TreeIO.h"
+#include "huffman.h"
+
+static void test1(void);
+static void test2(void);
+static void test3(void);
+static void test4(void);
+static void test5(void);
+static void test6(void);
+
+static HuffmanCodec codecForText(char *text);
+static HuffmanCodec combCodec(void);
+
+int main(void) {
+    test1();
+    test2();
+    test3();
+    test4();
+    test5();
+    test6();
+}
+
+// Round trip through a codec built from the text's own histogram
+static void test1(void) {
+    char *text = "she sells sea shells by the sea shore";
+    HuffmanCodec codec = codecForText(text);
+
+    unsigned char encoded[100];
+    int64_t numBits = CodecEncode(codec, text, strlen(text), encoded, sizeof(encoded));
+    assert(numBits > 0 && numBits < 8 * (int64_t)strlen(text));
+
+    char decoded[100];
+    int64_t len = CodecDecode(codec, encoded, numBits, decoded, sizeof(decoded));
+    assert(len == (int64_t)strlen(text));
+    assert(memcmp(decoded, text, len) == 0);
+
+    CodecFree(codec);
+
+    printf("Test 1 passed!\n");
+}
+
+// The same context can be reused for many buffers
+static void test2(void) {
+    HuffmanCodec codec = codecForText("abracadabra");
+
+    char *messages[4] = {"abra", "cadabra", "a", "rabbacadrab"};
+    for (int i = 0; i < 4; i++) {
+        unsigned char encoded[32];
+        char decoded[32];
+        size_t len = strlen(messages[i]);
+        assert(CodecMaxEncodedSize(codec, len) <= sizeof(encoded));
+        int64_t numBits = CodecEncode(codec, messages[i], len, encoded, sizeof(encoded));
+        assert(numBits > 0);
+        assert(CodecDecode(codec, encoded, numBits, decoded, sizeof(decoded)) == (int64_t)len);
+        assert(memcmp(decoded, messages[i], len) == 0);
+    }
+
+    // Tokens missing from the tree cannot be encoded without an escape leaf
+    unsigned char encoded[32];
+    assert(CodecEncode(codec, "abz", 3, encoded, sizeof(encoded)) == -1);
+
+    CodecFree(codec);
+
+    printf("Test 2 passed!\n");
+}
+
+// Output buffers that are too small are reported, not overrun
+static void test3(void) {
+    char *text = "peter piper picked a peck of pickled peppers";
+    HuffmanCodec codec = codecForText(text);
+
+    unsigned char encoded[64];
+    assert(CodecEncode(codec, text, strlen(text), encoded, 2) == -1);
+    int64_t numBits = CodecEncode(codec, text, strlen(text), encoded, sizeof(encoded));
+    assert(numBits > 0);
+
+    char decoded[64];
+    assert(CodecDecode(codec, encoded, numBits, decoded, 5) == -1);
+    assert(CodecDecode(codec, encoded, numBits - 1, decoded, sizeof(decoded)) == -1);
+
+    CodecFree(codec);
+
+    printf("Test 3 passed!\n");
+}
+
+// Characters that are not in a tree with an escape leaf are escaped
+static void test4(void) {
+    Counter c = CounterNew();
+    char *tokens[6] = {"a", "b", "b", "c", "c", ESCAPE_TOKEN};
+    for (int i = 0; i < 6; i++) {
+        CounterAdd(c, tokens[i]);
+    }
+    HuffmanCodec codec = CodecNewFromCounter(c);
+    CounterFree(c);
+
+    char *text = "abc \xc3\xa9z";
+    unsigned char encoded[64];
+    int64_t numBits = CodecEncode(codec, text, strlen(text), encoded, sizeof(encoded));
+    assert(numBits > 0);
+
+    char decoded[64];
+    int64_t len = CodecDecode(codec, encoded, numBits, decoded, sizeof(decoded));
+    assert(len == (int64_t)strlen(text));
+    assert(memcmp(decoded, text, len) == 0);
+
+    CodecFree(codec);
+
+    printf("Test 4 passed!\n");
+}
+
+// Codes far longer than the lookup table decode through the tree walk
+static void test5(void) {
+    HuffmanCodec codec = combCodec();
+
+    char *text = "onAmBlaCkDjEiFhGgHfIeJdKcLbMaNZOYPXQWRVSUTnoA";
+    size_t len = strlen(text);
+    unsigned char encoded[512];
+    int64_t numBits = CodecEncode(codec, text, len, encoded, sizeof(encoded));
+    assert(numBits > 0);
+
+    char decoded[64];
+    assert(CodecDecode(codec, encoded, numBits, decoded, sizeof(decoded)) == (int64_t)len);
+    assert(memcmp(decoded, text, len) == 0);
+
+    // A long code cut short is not mistaken for a shorter one
+    assert(CodecDecode(codec, encoded, 39, decoded, sizeof(decoded)) == -1);
+
+    CodecFree(codec);
+
+    printf("Test 5 passed!\n");
+}
+
+// Interleaved streams round trip for every stream count, through long codes
+// and escapes, and streams that do not all end together are rejected
+static void test6(void) {
+    size_t len = 20000;
+    char *texts[2] = {malloc(len), malloc(len)};
+    char *decoded = malloc(len);
+    assert(texts[0] != NULL && texts[1] != NULL && decoded != NULL);
+    char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmno";
+    srand(6);
+    for (size_t i = 0; i < len; i++) {
+        texts[0][i] = alphabet[rand() % (rand() % 41 + 1)];
+    }
+    // Everything but a and c is escaped, including some two byte characters
+    memcpy(texts[1], texts[0], len);
+    for (size_t i = 0; i + 2 <= len; i += 997) {
+        memcpy(&texts[1][i], "\xc3\xa9", 2);
+    }
+    HuffmanCodec codecs[2] = {combCodec(), codecForText("aac\xff")};
+
+    for (int c = 0; c < 2; c++) {
+        size_t cap = CodecMaxEncodedSize(codecs[c], len);
+        unsigned char *single = malloc(cap);
+        unsigned char *encoded = malloc(cap);
+        assert(single != NULL && encoded != NULL);
+        int64_t numBits = CodecEncode(codecs[c], texts[c], len, single, cap);
+        assert(numBits > 0);
+
+        for (int numStreams = 1; numStreams <= CODEC_MAX_STREAMS; numStreams++) {
+            uint64_t streamBits[CODEC_MAX_STREAMS];
+            int64_t numBytes = CodecEncodeStreams(codecs[c], texts[c], len, numStreams,
+                                                  encoded, cap, streamBits);
+            assert(numBytes > 0);
+            if (numStreams == 1) {
+                assert(streamBits[0] == (uint64_t)numBits);
+                assert(memcmp(encoded, single, numBytes) == 0);
+            }
+            assert(CodecDecodeStreams(codecs[c], encoded, numStreams, streamBits,
+                                      decoded, len) == (int64_t)len);
+            assert(memcmp(decoded, texts[c], len) == 0);
+
+            streamBits[numStreams - 1]--;
+            assert(CodecDecodeStreams(codecs[c], encoded, numStreams, streamBits,
+                                      decoded, len) == -1);
+        }
+        free(single);
+        free(encoded);
+        CodecFree(codecs[c]);
+    }
+    free(texts[0]);
+    free(texts[1]);
+    free(decoded);
+
+    printf("Test 6 passed!\n");
+}
+
+// Returns a codec for a comb whose leaf at depth d has a d bit code, down
+// to 40 bits
+static HuffmanCodec combCodec(void) {
+    char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmno";
+    int numLeaves = strlen(alphabet);
+    char tree[256];
+    int n = 0;
+    for (int i = 0; i < numLeaves - 1; i++) {
+        n += sprintf(&tree[n], "(%c,", alphabet[i]);
+    }
+    n += sprintf(&tree[n], "%c", alphabet[numLeaves - 1]);
+    for (int i = 0; i < numLeaves - 1; i++) {
+        tree[n++] = ')';
+    }
+    struct huffmanTree *t = TreeIOParse(tree, n);
+    assert(t != NULL);
+    HuffmanCodec codec = CodecNewFromTree(t);
+    TreeIOFree(t);
+    assert(codec != NULL);
+    return codec;
+}
+
+// Builds a codec from the characters of the text
+static HuffmanCodec codecForText(char *text) {
+    Counter c = CounterNew();
+    char token[2] = {0};
+    for (int i = 0; text[i] != '\0'; i++) {
+        token[0] = text[i];
+        CounterAdd(c, token);
+    }
+    HuffmanCodec codec = CodecNewFromCounter(c);
+    CounterFree(c);
+    return codec;
+}
@@ -0,0 +1,73 @@
+#!/bin/sh
+# Checks that codecs generated by treeCodegen compile cleanly and write
+# exactly what encode and decode write with the same tree
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cc=${CC:-cc}
+
+# Generates and compiles the codec for a tree, then checks it on an input
+check() {
+    ./treeCodegen "$1" "$dir/codec.c"
+    $cc -O2 -Wall -Wextra -Werror -o "$dir/codec" "$dir/codec.c"
+    ./encode "$2" "$1" "$dir/e.enc"
+    "$dir/codec" -e "$2" "$dir/g.enc"
+    cmp "$dir/e.enc" "$dir/g.enc"
+    "$dir/codec" -d "$dir/e.enc" "$dir/g.txt"
+    cmp "$2" "$dir/g.txt"
+}
+
+n=0
+for f in task4/*.txt; do
+    check "${f%.txt}.tree" "$f"
+    n=$((n + 1))
+done
+echo "Test 1 passed! ($n trees)"
+
+# A word alphabet, and characters that are only in the escape leaf
+./encode -w task4/tell-tale_heart.txt "$dir/w.tree"
+check "$dir/w.tree" task4/tell-tale_heart.txt
+printf 'h\303\251llo \342\230\203 w\303\266rld \346\227\245\346\234\254\n' > "$dir/u.txt"
+cat task1/anti-hero.txt >> "$dir/u.txt"
+check pretrained/task4.tree "$dir/u.txt"
+printf 'aaaaaaa' > "$dir/a.txt"
+./encode "$dir/a.txt" "$dir/a.tree"
+check "$dir/a.tree" "$dir/a.txt"
+printf '0101' > "$dir/bad.enc"
+if "$dir/codec" -d "$dir/bad.enc" "$dir/g.txt" 2> /dev/null; then
+    exit 1
+fi
+echo "Test 2 passed!"
+
+# Without main, two trees link into one program under their own names
+./treeCodegen -n wonderland task4/wonderland.tree "$dir/a.c"
+./treeCodegen -n heart "$dir/w.tree" "$dir/b.c"
+cat > "$dir/main.c" <<'EOF'
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+char *wonderlandEncode(const char *text, size_t len, size_t *encodingLen);
+char *wonderlandDecode(const char *encoding, size_t len, size_t *textLen);
+char *heartEncode(const char *text, size_t len, size_t *encodingLen);
+char *heartDecode(const char *encoding, size_t len, size_t *textLen);
+
+int main(void) {
+    char *text = "It was the best of times";
+    size_t len = strlen(text), encodingLen, textLen;
+    char *a = wonderlandEncode(text, len, &encodingLen);
+    char *b = wonderlandDecode(a, encodingLen, &textLen);
+    char *c = heartEncode(text, len, &encodingLen);
+    char *d = heartDecode(c, encodingLen, &textLen);
+    int ok = strcmp(b, text) == 0 && strcmp(d, text) == 0;
+    free(a);
+    free(b);
+    free(c);
+    free(d);
+    return ok ? 0 : 1;
+}
+EOF
+$cc -O2 -Wall -Werror -DTREE_CODEC_NO_MAIN -o "$dir/linked" "$dir/main.c" "$dir/a.c" "$dir/b.c"
+"$dir/linked"
+echo "Test 3 passed!"
@@ -10,11 +10,13 @@
 static void test1(void);
 static void test2(void);
 static void test3(void);
+static void test4(void);
 
 int main(void) {
     test1();
     test2();
     test3();
+    test4();
 }
 
 static void test1(void) {
@@ -105,3 +107,21 @@ static void test3(void) {
 
     printf("Test 3 passed!\n");
 }
+
+static void test4(void) {
+    Counter counter = CounterNew();
+
+    CounterAddCount(counter, "dog", 3);
+    CounterAdd(counter, "dog");
+    CounterAddCount(counter, "cat", 2);
+    CounterAddCount(counter, "emu", 0);
+
+    assert(CounterNumItems(counter) == 2);
+    assert(CounterGet(counter, "dog") == 4);
+    assert(CounterGet(counter, "cat") == 2);
+    assert(CounterGet(counter, "emu") == 0);
+
+    CounterFree(counter);
+
+    printf("Test 4 passed!\n");
+}
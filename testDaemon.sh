@@ -0,0 +1,61 @@
+#!/bin/sh
+# Round trips the task4 inputs through a local huffmand and checks that the
+# daemon's encodings match the ones produced by encode on its own
+
+set -e
+dir=$(mktemp -d)
+./huffmand -j 4 "$dir/huffmand.sock" &
+pid=$!
+trap 'kill $pid 2>/dev/null; rm -rf "$dir"' EXIT
+while [ ! -S "$dir/huffmand.sock" ]; do
+    sleep 0.1
+done
+
+n=0
+for f in task4/*.txt; do
+    tree=${f%.txt}.tree
+    ./encode "$f" "$tree" "$dir/expected.enc"
+    ./encode -S "$dir/huffmand.sock" "$f" "$tree" "$dir/actual.enc"
+    cmp "$dir/expected.enc" "$dir/actual.enc"
+    ./decode -S "$dir/huffmand.sock" "$tree" "$dir/actual.enc" "$dir/actual.txt"
+    cmp "$f" "$dir/actual.txt"
+    n=$((n + 1))
+    echo "Test $n passed!"
+done
+
+# Requests that cannot be served get an error, and the daemon keeps
+# serving: bits that end inside a code, and, under a memory budget, an
+# output too large to make room for
+tree=task4/wonderland.tree
+printf 1 > "$dir/bad.enc"
+if ./decode -S "$dir/huffmand.sock" "$tree" "$dir/bad.enc" "$dir/actual.txt" 2> /dev/null; then
+    exit 1
+fi
+HUFFMAN_MEM_BUDGET=8M ./huffmand -j 2 "$dir/small.sock" &
+small=$!
+trap 'kill $pid $small 2>/dev/null; rm -rf "$dir"' EXIT
+while [ ! -S "$dir/small.sock" ]; do
+    sleep 0.1
+done
+head -c 8000000 /dev/zero | tr '\000' '0' > "$dir/big.enc"
+if ./decode -S "$dir/small.sock" "$tree" "$dir/big.enc" "$dir/actual.txt" 2> /dev/null; then
+    exit 1
+fi
+head -c 2000 task4/wonderland.txt > "$dir/small.txt"
+./encode -S "$dir/small.sock" "$dir/small.txt" "$tree" "$dir/small.enc"
+./decode -S "$dir/small.sock" "$tree" "$dir/small.enc" "$dir/actual.txt"
+cmp "$dir/small.txt" "$dir/actual.txt"
+echo "Test $((n + 1)) passed!"
+
+# A tree file rewritten while the daemon runs is loaded again
+cp task4/wonderland.tree "$dir/t.tree"
+./encode -S "$dir/huffmand.sock" "$dir/small.txt" "$dir/t.tree" "$dir/actual.enc"
+printf 'abbbbcc' > "$dir/abc.txt"
+./encode "$dir/abc.txt" "$dir/abc.tree"
+cp "$dir/abc.tree" "$dir/t.tree"
+./encode "$dir/abc.txt" "$dir/abc.tree" "$dir/expected.enc"
+./encode -S "$dir/huffmand.sock" "$dir/abc.txt" "$dir/t.tree" "$dir/actual.enc"
+cmp "$dir/expected.enc" "$dir/actual.enc"
+./decode -S "$dir/huffmand.sock" "$dir/t.tree" "$dir/actual.enc" "$dir/actual.txt"
+cmp "$dir/abc.txt" "$dir/actual.txt"
+echo "Test $((n + 2)) passed!"
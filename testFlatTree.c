@@ -0,0 +1,154 @@
+// Main program for testing the FlatTree binary tree file format
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FlatTree.h"
+#include "TreeIO.h"
+#include "huffman.h"
+
+#define VERSION_OFFSET 4
+
+static void test1(void);
+static void test2(void);
+static void test3(void);
+
+static char *writeTempTree(char *text, char *path);
+static void corruptByte(char *path, long offset, int value);
+static char *readAll(char *path, long *size);
+
+int main(void) {
+    test1();
+    test2();
+    test3();
+}
+
+// A mapped tree decodes like the tree it was written from
+static void test1(void) {
+    char path[] = "/tmp/testFlatTreeXXXXXX";
+    char outPath[] = "/tmp/testFlatTreeOutXXXXXX";
+    close(mkstemp(outPath));
+    writeTempTree("((a,b),(\\,,\xc3\xa9))", path);
+
+    FlatTree ft = FlatTreeMap(path);
+    assert(ft != NULL);
+    FlatTreeDecode(ft, "0001101100", outPath);
+    FlatTreeFree(ft);
+
+    long size;
+    char *decoded = readAll(outPath, &size);
+    assert(size == 6 && memcmp(decoded, "ab,\xc3\xa9" "a", 6) == 0);
+    free(decoded);
+
+    // A tree may be a single leaf
+    writeTempTree("x", path);
+    ft = FlatTreeMap(path);
+    assert(ft != NULL);
+    FlatTreeFree(ft);
+
+    unlink(path);
+    unlink(outPath);
+    printf("Test 1 passed!\n");
+}
+
+// Damaged, truncated, foreign and missing files are rejected
+static void test2(void) {
+    char path[] = "/tmp/testFlatTreeXXXXXX";
+    char *text = "((a,b),c)";
+
+    // A flipped token byte fails the checksum
+    writeTempTree(text, path);
+    long size;
+    free(readAll(path, &size));
+    corruptByte(path, size - 2, 'z');
+    assert(FlatTreeMap(path) == NULL);
+
+    // An unknown version is refused
+    writeTempTree(text, path);
+    corruptByte(path, VERSION_OFFSET, 99);
+    assert(FlatTreeMap(path) == NULL);
+
+    // So is a file missing its last byte
+    writeTempTree(text, path);
+    assert(truncate(path, size - 1) == 0);
+    assert(FlatTreeMap(path) == NULL);
+
+    // A text tree and a file shorter than the header are not flat trees
+    FILE *fp = fopen(path, "w");
+    fputs(text, fp);
+    fclose(fp);
+    assert(FlatTreeMap(path) == NULL);
+
+    unlink(path);
+    assert(FlatTreeMap(path) == NULL);
+    printf("Test 2 passed!\n");
+}
+
+// A stream read gives the same tree as a mapping
+static void test3(void) {
+    char path[] = "/tmp/testFlatTreeXXXXXX";
+    char outPath[] = "/tmp/testFlatTreeOutXXXXXX";
+    close(mkstemp(outPath));
+    writeTempTree("(a,(b,c))", path);
+
+    FILE *fp = fopen(path, "rb");
+    FlatTree ft = FlatTreeRead(fp);
+    fclose(fp);
+    assert(ft != NULL);
+    FlatTreeDecode(ft, "01110", outPath);
+    FlatTreeFree(ft);
+
+    long size;
+    char *decoded = readAll(outPath, &size);
+    assert(size == 3 && memcmp(decoded, "acb", 3) == 0);
+    free(decoded);
+
+    unlink(path);
+    unlink(outPath);
+    printf("Test 3 passed!\n");
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Writes the flat form of the text tree to a new temporary file at path,
+// or over path if it has already been created
+static char *writeTempTree(char *text, char *path) {
+    if (strstr(path, "XXXXXX") != NULL) {
+        close(mkstemp(path));
+    }
+    struct huffmanTree *tree = TreeIOParse(text, strlen(text));
+    assert(tree != NULL);
+    FlatTree ft = FlatTreeNew(tree);
+    TreeIOFree(tree);
+
+    FILE *fp = fopen(path, "wb");
+    assert(fp != NULL);
+    FlatTreeWrite(ft, fp);
+    fclose(fp);
+    FlatTreeFree(ft);
+    return path;
+}
+
+static void corruptByte(char *path, long offset, int value) {
+    FILE *fp = fopen(path, "r+b");
+    assert(fp != NULL);
+    fseek(fp, offset, SEEK_SET);
+    fputc(value, fp);
+    fclose(fp);
+}
+
+static char *readAll(char *path, long *size) {
+    FILE *fp = fopen(path, "rb");
+    assert(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = malloc(*size + 1);
+    assert(data != NULL);
+    assert(fread(data, 1, *size, fp) == (size_t)*size);
+    fclose(fp);
+    return data;
+}
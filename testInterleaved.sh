@@ -0,0 +1,24 @@
+#!/bin/sh
+# Checks that interleaved encodings round trip for several stream counts,
+# and that they are refused with a different tree or when truncated
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+n=0
+for f in task4/*.txt; do
+    for streams in 1 4 16; do
+        ./encode -I "$streams" "$f" "${f%.txt}.tree" "$dir/i.enc"
+        ./decode -I "${f%.txt}.tree" "$dir/i.enc" "$dir/i.txt"
+        cmp "$f" "$dir/i.txt"
+        n=$((n + 1))
+    done
+done
+echo "Test 1 passed! ($n encodings)"
+
+./encode -I 4 task4/wonderland.txt task4/wonderland.tree "$dir/i.enc"
+! ./decode -I task4/war_and_peace.tree "$dir/i.enc" "$dir/i.txt" 2>/dev/null
+head -c 1000 "$dir/i.enc" > "$dir/t.enc"
+! ./decode -I task4/wonderland.tree "$dir/t.enc" "$dir/i.txt" 2>/dev/null
+echo "Test 2 passed!"
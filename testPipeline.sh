@@ -0,0 +1,82 @@
+#!/bin/sh
+# Checks that pipelined encoding and decoding give exactly the output of
+# the unpipelined programs, across chunk boundaries and with word trees
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+n=0
+for f in task4/*.txt; do
+    ./encode "$f" "${f%.txt}.tree" "$dir/e.enc"
+    ./encode -P "$f" "${f%.txt}.tree" "$dir/p.enc"
+    cmp "$dir/e.enc" "$dir/p.enc"
+    ./decode -P "${f%.txt}.tree" "$dir/p.enc" "$dir/p.txt"
+    cmp "$f" "$dir/p.txt"
+    n=$((n + 1))
+done
+echo "Test 1 passed! ($n files)"
+
+# Several chunks of a word alphabet, through stdin and stdout
+f=task4/war_and_peace.txt
+./encode -w "$f" "$dir/w.tree"
+./encode "$f" "$dir/w.tree" "$dir/e.enc"
+./encode -P - "$dir/w.tree" - < "$f" > "$dir/p.enc"
+cmp "$dir/e.enc" "$dir/p.enc"
+./decode -P "$dir/w.tree" - - < "$dir/p.enc" | cmp "$f" -
+echo "Test 2 passed!"
+
+# An encoding cut inside a code is refused
+head -c 1000001 "$dir/p.enc" > "$dir/t.enc"
+! ./decode -P "$dir/w.tree" "$dir/t.enc" "$dir/t.txt" 2>/dev/null
+echo "Test 3 passed!"
+
+# A lone leaf has a 1 bit code on every path, so the encoding still
+# counts its tokens
+printf 'aaaaaaa' > "$dir/a.txt"
+./encode "$dir/a.txt" "$dir/a.tree"
+./encode "$dir/a.txt" "$dir/a.tree" "$dir/e.enc"
+./encode -P "$dir/a.txt" "$dir/a.tree" "$dir/p.enc"
+[ "$(cat "$dir/e.enc")" = 0000000 ]
+cmp "$dir/e.enc" "$dir/p.enc"
+./decode "$dir/a.tree" "$dir/e.enc" "$dir/e.txt"
+cmp "$dir/a.txt" "$dir/e.txt"
+./decode -P "$dir/a.tree" "$dir/e.enc" "$dir/p.txt"
+cmp "$dir/a.txt" "$dir/p.txt"
+./encode -b "$dir/a.tree" "$dir/a.bin"
+./decode "$dir/a.bin" "$dir/e.enc" "$dir/b.txt"
+cmp "$dir/a.txt" "$dir/b.txt"
+
+# and no code starts with a 1, for every decoder
+printf '0101' > "$dir/bad.enc"
+for flag in "" -P; do
+    if ./decode $flag "$dir/a.tree" "$dir/bad.enc" "$dir/bad.txt" 2> /dev/null; then
+        exit 1
+    fi
+done
+if ./decode "$dir/a.bin" "$dir/bad.enc" "$dir/bad.txt" 2> /dev/null; then
+    exit 1
+fi
+echo "Test 4 passed!"
+
+# Chunks with no ASCII byte that is not a letter are cut between characters,
+# or inside a run of letters too long to be a word
+python3 -c 'import sys; sys.stdout.write("日本語" * 800000)' > "$dir/cjk.txt"
+python3 -c 'import sys; sys.stdout.write("ab" * 1500000 + " ab ab\n")' > "$dir/run.txt"
+for f in "$dir/cjk.txt" "$dir/run.txt"; do
+    for mode in "" -w; do
+        ./encode $mode "$f" "$dir/x.tree"
+        ./encode "$f" "$dir/x.tree" "$dir/e.enc"
+        ./encode -P "$f" "$dir/x.tree" "$dir/p.enc"
+        cmp "$dir/e.enc" "$dir/p.enc"
+    done
+done
+
+# Bytes with no token boundary at all stop the encoding rather than
+# growing the chunk without limit
+head -c 5000000 /dev/zero | tr '\000' '\200' > "$dir/cont.txt"
+if ./encode -P "$dir/cont.txt" pretrained/task4.tree "$dir/p.enc" 2> "$dir/error"; then
+    exit 1
+fi
+grep -q 'no token boundary' "$dir/error"
+echo "Test 5 passed!"
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Checks that a tree trained with encode -T matches the shipped one, and
+# that its escape leaf carries characters it was never trained on through
+# every decoder, while small inputs stay smaller than with their own tree
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+./encode -T "$dir/p.tree" task4/*.txt
+cmp pretrained/task4.tree "$dir/p.tree"
+echo "Test 1 passed!"
+
+# Accented letters, a snowman, CJK and an emoji, none of them in task4
+printf 'h\303\251llo \342\230\203 w\303\266rld \346\227\245\346\234\254 \360\237\230\200\n' > "$dir/u.txt"
+cat task1/anti-hero.txt >> "$dir/u.txt"
+t=pretrained/task4.tree
+./encode "$dir/u.txt" "$t" "$dir/u.enc"
+./encode -P "$dir/u.txt" "$t" "$dir/p.enc"
+cmp "$dir/u.enc" "$dir/p.enc"
+./decode "$t" "$dir/u.enc" "$dir/u.txt.out"
+cmp "$dir/u.txt" "$dir/u.txt.out"
+./decode -P "$t" "$dir/u.enc" - | cmp "$dir/u.txt" -
+./encode -b "$t" "$dir/p.bin"
+./decode "$dir/p.bin" "$dir/u.enc" "$dir/b.txt"
+cmp "$dir/u.txt" "$dir/b.txt"
+mkdir "$dir/cache"
+HUFFMAN_CACHE_DIR="$dir/cache" ./decode "$t" "$dir/u.enc" "$dir/c.txt"
+cmp "$dir/u.txt" "$dir/c.txt"
+echo "Test 2 passed!"
+
+# A short input needs no tree file with the pretrained tree, and its bits
+# alone are fewer than its own tree file and bits together
+f=task4/sea_shells.txt
+./encode "$f" "$t" "$dir/s.enc"
+./encode "$f" "$dir/own.tree"
+./encode "$f" "$dir/own.tree" "$dir/own.enc"
+[ "$(wc -c < "$dir/s.enc")" -lt $(($(wc -c < "$dir/own.tree") * 8 + $(wc -c < "$dir/own.enc"))) ]
+echo "Test 3 passed!"
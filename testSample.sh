@@ -0,0 +1,26 @@
+#!/bin/sh
+# Checks that trees built from a sample of the input still round trip,
+# escaping the characters the sample missed
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+n=0
+for f in task4/*.txt; do
+    for sample in 0.001 0.001:4 64; do
+        ./encode -s "$sample" "$f" "$dir/s.tree"
+        ./encode "$f" "$dir/s.tree" "$dir/s.enc"
+        ./decode "$dir/s.tree" "$dir/s.enc" "$dir/s.txt"
+        cmp "$f" "$dir/s.txt"
+        n=$((n + 1))
+    done
+done
+echo "Test 1 passed! ($n samples)"
+
+# A sample covering the whole input gives the exact tree, with no loss
+./encode -s 64 -r task4/wonderland.txt "$dir/s.tree" > "$dir/report.txt"
+./encode task4/wonderland.txt "$dir/exact.tree"
+cmp "$dir/s.tree" "$dir/exact.tree"
+grep -q '^ratio loss: 0.000%$' "$dir/report.txt"
+echo "Test 2 passed!"
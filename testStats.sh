@@ -0,0 +1,54 @@
+#!/bin/sh
+# Checks that --stats and HUFFMAN_STATS report one JSON object with the
+# phases that ran and counters that match the files, and that nothing is
+# reported otherwise
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# Checks the report in $1 against the program name, a phase that must
+# have run, and the expected bytes in and out
+check() {
+    python3 -c 'import json, sys
+lines = [line for line in open(sys.argv[1]) if line.startswith("{")]
+assert len(lines) == 1, lines
+report = json.loads(lines[0])
+assert report["program"] == sys.argv[2], report
+assert report["phases"][sys.argv[3]]["calls"] >= 1, report
+assert report["phases"]["total"]["wall_s"] >= 0, report
+assert report["counters"]["bytes_in"] == int(sys.argv[4]), report
+assert report["counters"]["bytes_out"] == int(sys.argv[5]), report' "$@"
+}
+
+f=task4/wonderland.txt
+t=task4/wonderland.tree
+./encode --stats "$f" "$t" "$dir/e.enc" 2> "$dir/report"
+check "$dir/report" encode encode "$(wc -c < "$f")" "$(wc -c < "$dir/e.enc")"
+./decode --stats "$t" "$dir/e.enc" "$dir/e.txt" 2> "$dir/report"
+check "$dir/report" decode decode "$(wc -c < "$dir/e.enc")" "$(wc -c < "$f")"
+cmp "$f" "$dir/e.txt"
+echo "Test 1 passed!"
+
+# The environment turns them on too
+HUFFMAN_STATS=1 ./encode "$f" "$t" "$dir/h.enc" 2> "$dir/report"
+check "$dir/report" encode encode "$(wc -c < "$f")" "$(wc -c < "$dir/h.enc")"
+HUFFMAN_STATS=1 ./decode "$t" "$dir/h.enc" "$dir/h.txt" 2> "$dir/report"
+check "$dir/report" decode decode "$(wc -c < "$dir/h.enc")" "$(wc -c < "$f")"
+
+# and in block mode
+HUFFMAN_STATS=1 ./encode -B 64 "$f" "$dir/b.enc" 2> "$dir/report"
+check "$dir/report" encode encode "$(wc -c < "$f")" "$(wc -c < "$dir/b.enc")"
+HUFFMAN_STATS=1 ./decode -B "$dir/b.enc" "$dir/b.txt" 2> "$dir/report"
+check "$dir/report" decode decode "$(wc -c < "$dir/b.enc")" "$(wc -c < "$f")"
+cmp "$f" "$dir/b.txt"
+echo "Test 2 passed!"
+
+# Off by default and with HUFFMAN_STATS=0, and the output is unchanged
+./encode "$f" "$t" "$dir/plain.enc" 2> "$dir/report"
+[ ! -s "$dir/report" ]
+HUFFMAN_STATS=0 ./encode "$f" "$t" "$dir/zero.enc" 2> "$dir/report"
+[ ! -s "$dir/report" ]
+cmp "$dir/e.enc" "$dir/plain.enc"
+cmp "$dir/e.enc" "$dir/zero.enc"
+echo "Test 3 passed!"
@@ -0,0 +1,142 @@
+// Main program for testing the TreeIO module
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "TreeIO.h"
+#include "huffman.h"
+
+static void test1(void);
+static void test2(void);
+static void test3(void);
+static void test4(void);
+static void test5(void);
+
+static int depthOfLeftmostLeaf(struct huffmanTree *t);
+
+int main(void) {
+    test1();
+    test2();
+    test3();
+    test4();
+    test5();
+}
+
+// Internal nodes and leaves are placed as written
+static void test1(void) {
+    char *text = "((a,b),c)";
+    struct huffmanTree *t = TreeIOParse(text, strlen(text));
+    assert(t != NULL);
+    assert(t->token == NULL);
+    assert(strcmp(t->left->left->token, "a") == 0);
+    assert(strcmp(t->left->right->token, "b") == 0);
+    assert(strcmp(t->right->token, "c") == 0);
+    assert(t->right->left == NULL && t->right->right == NULL);
+    TreeIOFree(t);
+
+    // A tree may be a single leaf
+    t = TreeIOParse("x", 1);
+    assert(t != NULL && strcmp(t->token, "x") == 0);
+    TreeIOFree(t);
+
+    printf("Test 1 passed!\n");
+}
+
+// Escaped characters and multi-byte tokens are read back unescaped
+static void test2(void) {
+    char *text = "((\\(,\\)),(\\,,(\\\\,\xc3\xa9)))";
+    struct huffmanTree *t = TreeIOParse(text, strlen(text));
+    assert(t != NULL);
+    assert(strcmp(t->left->left->token, "(") == 0);
+    assert(strcmp(t->left->right->token, ")") == 0);
+    assert(strcmp(t->right->left->token, ",") == 0);
+    assert(strcmp(t->right->right->left->token, "\\") == 0);
+    assert(strcmp(t->right->right->right->token, "\xc3\xa9") == 0);
+    TreeIOFree(t);
+
+    printf("Test 2 passed!\n");
+}
+
+// Degenerate trees far deeper than the call stack could recurse load fine
+static void test3(void) {
+    int depth = 1000000;
+    char *text = malloc(3 * depth + 1);
+    int len = 0;
+    for (int i = 0; i < depth; i++) {
+        text[len++] = '(';
+    }
+    text[len++] = 'a';
+    for (int i = 0; i < depth; i++) {
+        text[len++] = ',';
+        text[len++] = ')';
+    }
+
+    // Every right child is an empty token between ',' and ')'
+    struct huffmanTree *t = TreeIOParse(text, len);
+    assert(t != NULL);
+    assert(depthOfLeftmostLeaf(t) == depth);
+    TreeIOFree(t);
+    free(text);
+
+    printf("Test 3 passed!\n");
+}
+
+// Malformed trees are rejected
+static void test4(void) {
+    char *bad[5] = {"", "(a,b", "(a)", "(a,b))", "((a,b),c"};
+    for (int i = 0; i < 5; i++) {
+        assert(TreeIOParse(bad[i], strlen(bad[i])) == NULL);
+    }
+    assert(TreeIOLoad("no/such/file.tree") == NULL);
+
+    printf("Test 4 passed!\n");
+}
+
+// Written trees read back as the text they were parsed from, however deep
+static void test5(void) {
+    int depth = 1000000;
+    char *deep = malloc(4 * depth + 2);
+    int len = 0;
+    for (int i = 0; i < depth; i++) {
+        deep[len++] = '(';
+    }
+    deep[len++] = 'a';
+    for (int i = 0; i < depth; i++) {
+        deep[len++] = ',';
+        deep[len++] = 'b';
+        deep[len++] = ')';
+    }
+    deep[len] = '\0';
+
+    char *texts[3] = {"x", "((\\(,\\)),(\\,,(\\\\,\xc3\xa9)))", deep};
+    for (int i = 0; i < 3; i++) {
+        struct huffmanTree *t = TreeIOParse(texts[i], strlen(texts[i]));
+        assert(t != NULL);
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        TreeIOWrite(t, fp);
+        TreeIOFree(t);
+
+        size_t n = strlen(texts[i]);
+        char *written = malloc(n + 1);
+        rewind(fp);
+        assert(fread(written, 1, n + 1, fp) == n);
+        assert(memcmp(written, texts[i], n) == 0);
+        free(written);
+        fclose(fp);
+    }
+    free(deep);
+
+    printf("Test 5 passed!\n");
+}
+
+static int depthOfLeftmostLeaf(struct huffmanTree *t) {
+    int depth = 0;
+    while (t->left != NULL) {
+        t = t->left;
+        depth++;
+    }
+    return depth;
+}
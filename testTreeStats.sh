@@ -0,0 +1,33 @@
+#!/bin/sh
+# Checks that treeStats predicts the exact size of every encoding
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+check() {
+    ./encode "$1" "$2" "$dir/out.enc"
+    predicted=$(./treeStats "$2" "$1" | sed -n 's/^  as text: \([0-9]*\) bytes$/\1/p')
+    actual=$(wc -c < "$dir/out.enc")
+    if [ "$predicted" -ne "$actual" ]; then
+        echo "FAIL: predicted $predicted bytes for '$1' with '$2', got $actual"
+        exit 1
+    fi
+}
+
+n=0
+for t in task1/*.tree task4/*.tree; do
+    check "${t%.tree}.txt" "$t"
+    n=$((n + 1))
+done
+echo "Test 1 passed! ($n files)"
+
+# Word alphabets and a pretrained tree that escapes unseen characters
+./encode -w task4/war_and_peace.txt "$dir/words.tree"
+check task4/war_and_peace.txt "$dir/words.tree"
+./encode -w task4/wonderland.txt "$dir/words.tree"
+check task4/wonderland.txt "$dir/words.tree"
+printf 'caf\303\251 \342\202\254 \360\237\230\200\n' > "$dir/escapes.txt"
+check "$dir/escapes.txt" pretrained/task4.tree
+check task1/sea_shells.txt pretrained/task4.tree
+echo "Test 2 passed!"
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Checks that word trees round trip through encode and decode, including
+# words that are only coded as characters, and beat the character tree on
+# long prose
+
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+n=0
+for f in task4/*.txt; do
+    ./encode -w "$f" "$dir/w.tree"
+    ./encode "$f" "$dir/w.tree" "$dir/w.enc"
+    ./decode "$dir/w.tree" "$dir/w.enc" "$dir/w.txt"
+    cmp "$f" "$dir/w.txt"
+    n=$((n + 1))
+done
+echo "Test 1 passed! ($n files)"
+
+# Text with words the tree never saw, spelled out from its characters
+f=task4/war_and_peace.txt
+./encode -w "$f" "$dir/w.tree"
+tr 'a-z' 'b-za' < "$f" | cat "$f" - > "$dir/mixed.txt"
+./encode "$dir/mixed.txt" "$dir/w.tree" "$dir/m.enc"
+./decode "$dir/w.tree" "$dir/m.enc" "$dir/m.txt"
+cmp "$dir/mixed.txt" "$dir/m.txt"
+echo "Test 2 passed!"
+
+# War and peace takes at least a third fewer bits with words
+./encode "$f" "$dir/w.tree" "$dir/w.enc"
+./encode "$f" task4/war_and_peace.tree "$dir/c.enc"
+[ $(($(wc -c < "$dir/w.enc") * 3)) -lt $(($(wc -c < "$dir/c.enc") * 2)) ]
+echo "Test 3 passed!"
@@ -0,0 +1,87 @@
+// Main program for testing the WorkPool ADT
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "WorkPool.h"
+
+static void test1(void);
+static void test2(void);
+static void test3(void);
+
+static void addOne(WorkPool pool, void *arg);
+static void spawnTree(WorkPool pool, void *arg);
+
+static atomic_long total;
+
+int main(void) {
+    test1();
+    test2();
+    test3();
+}
+
+// Every task submitted from outside the pool runs exactly once
+static void test1(void) {
+    WorkPool pool = WorkPoolNew(4);
+    atomic_store(&total, 0);
+    for (int i = 0; i < 1000; i++) {
+        WorkPoolSubmit(pool, addOne, NULL);
+    }
+    WorkPoolWait(pool);
+    assert(atomic_load(&total) == 1000);
+
+    // The pool can be waited on again after more work arrives
+    WorkPoolSubmit(pool, addOne, NULL);
+    WorkPoolWait(pool);
+    assert(atomic_load(&total) == 1001);
+
+    WorkPoolFree(pool);
+
+    printf("Test 1 passed!\n");
+}
+
+// Waiting covers tasks submitted by other tasks
+static void test2(void) {
+    WorkPool pool = WorkPoolNew(4);
+    atomic_store(&total, 0);
+    long depth = 12;
+    WorkPoolSubmit(pool, spawnTree, (void *)depth);
+    WorkPoolWait(pool);
+    assert(atomic_load(&total) == (1 << 12));
+    WorkPoolFree(pool);
+
+    printf("Test 2 passed!\n");
+}
+
+// A single worker still finishes nested work
+static void test3(void) {
+    WorkPool pool = WorkPoolNew(1);
+    assert(WorkPoolNumWorkers(pool) == 1);
+    atomic_store(&total, 0);
+    long depth = 8;
+    WorkPoolSubmit(pool, spawnTree, (void *)depth);
+    WorkPoolWait(pool);
+    assert(atomic_load(&total) == (1 << 8));
+    WorkPoolFree(pool);
+
+    printf("Test 3 passed!\n");
+}
+
+static void addOne(WorkPool pool, void *arg) {
+    (void)pool;
+    (void)arg;
+    atomic_fetch_add(&total, 1);
+}
+
+// Splits into two tasks until depth reaches 0, then counts one leaf
+static void spawnTree(WorkPool pool, void *arg) {
+    long depth = (long)arg;
+    if (depth == 0) {
+        atomic_fetch_add(&total, 1);
+        return;
+    }
+    WorkPoolSubmit(pool, spawnTree, (void *)(depth - 1));
+    WorkPoolSubmit(pool, spawnTree, (void *)(depth - 1));
+}
@@ -0,0 +1,349 @@
+// Canvas viewer for the layout written by "treePrinter -j"
+//
+// The JSON holds parallel arrays indexed by node in pre-order (left, right,
+// depth, size, x, p, token), so nothing is laid out here: a node is drawn at
+// column x and row depth. Only the nodes above a collapsed node are drawn,
+// and the tree starts collapsed at the deepest level that keeps the first
+// view small, so large alphabets open quickly and are expanded on demand.
+
+(function() {
+  var MAX_INITIAL_NODES = 2000;
+  var NODE_RADIUS = 6;
+  var MIN_LABEL_SPACING = 14;
+
+  var tree = null;
+  var parent = null;
+  var collapsed = null;
+  var visible = [];
+  var view = {sx: 1, sy: 1, ox: 0, oy: 0};
+  var canvas, ctx, selected = -1;
+
+  window.addEventListener('DOMContentLoaded', function() {
+    canvas = document.getElementById('view');
+    ctx = canvas.getContext('2d');
+    window.addEventListener('resize', function() { resize(); draw(); });
+    resize();
+    bindInput();
+
+    var match = /[?&]data=([^&]+)/.exec(window.location.search);
+    if (match) {
+      fetch(decodeURIComponent(match[1]))
+        .then(function(response) { return response.json(); })
+        .then(load)
+        .catch(function(err) { showSummary('failed to load data: ' + err); });
+    }
+  });
+
+  ////////////////////////////////////////////////////////////////////////
+
+  function load(data) {
+    var start = performance.now();
+    tree = data;
+    var n = tree.nodes;
+    parent = new Int32Array(n).fill(-1);
+    for (var i = 0; i < n; i++) {
+      if (tree.left[i] >= 0) {
+        parent[tree.left[i]] = i;
+        parent[tree.right[i]] = i;
+      }
+    }
+
+    collapseTo(initialDepth());
+    selected = -1;
+    fit();
+    draw();
+    showSummary(n + ' nodes, ' + tree.leaves + ' leaves, max depth ' + tree.maxDepth +
+                ' (shown in ' + Math.round(performance.now() - start) + ' ms)');
+  }
+
+  // The deepest level such that every node above it fits in the first view
+  function initialDepth() {
+    var perDepth = new Array(tree.maxDepth + 1).fill(0);
+    for (var i = 0; i < tree.nodes; i++) {
+      perDepth[tree.depth[i]]++;
+    }
+    var total = 0;
+    for (var d = 0; d <= tree.maxDepth; d++) {
+      total += perDepth[d];
+      if (total > MAX_INITIAL_NODES) {
+        return Math.max(d - 1, 1);
+      }
+    }
+    return tree.maxDepth;
+  }
+
+  function collapseTo(depth) {
+    collapsed = new Uint8Array(tree.nodes);
+    for (var i = 0; i < tree.nodes; i++) {
+      if (tree.left[i] >= 0 && tree.depth[i] >= depth) {
+        collapsed[i] = 1;
+      }
+    }
+    updateVisible();
+  }
+
+  // Collects the nodes reachable from the root without passing a collapsed
+  // node, without recursion since trees may be very deep
+  function updateVisible() {
+    visible = [];
+    var stack = [0];
+    while (stack.length > 0) {
+      var i = stack.pop();
+      visible.push(i);
+      if (tree.left[i] >= 0 && !collapsed[i]) {
+        stack.push(tree.right[i]);
+        stack.push(tree.left[i]);
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+
+  function resize() {
+    var ratio = window.devicePixelRatio || 1;
+    canvas.width = window.innerWidth * ratio;
+    canvas.height = window.innerHeight * ratio;
+    canvas.style.width = window.innerWidth + 'px';
+    canvas.style.height = window.innerHeight + 'px';
+    ctx.setTransform(ratio, 0, 0, ratio, 0, 0);
+  }
+
+  // Scales columns and rows separately, since wide alphabets make trees far
+  // wider than they are deep
+  function fit() {
+    var minX = Infinity, maxX = -Infinity, maxDepth = 0;
+    visible.forEach(function(i) {
+      minX = Math.min(minX, tree.x[i]);
+      maxX = Math.max(maxX, tree.x[i]);
+      maxDepth = Math.max(maxDepth, tree.depth[i]);
+    });
+    var margin = 40;
+    var width = window.innerWidth - 2 * margin;
+    var height = window.innerHeight - 2 * margin - 60;
+    view.sx = width / Math.max(maxX - minX, 1);
+    view.sy = Math.min(height / Math.max(maxDepth, 1), 80);
+    view.ox = margin - minX * view.sx;
+    view.oy = margin + 60;
+  }
+
+  function screenX(i) { return tree.x[i] * view.sx + view.ox; }
+  function screenY(i) { return tree.depth[i] * view.sy + view.oy; }
+
+  function draw() {
+    ctx.clearRect(0, 0, window.innerWidth, window.innerHeight);
+    if (tree === null) {
+      return;
+    }
+    var width = window.innerWidth, height = window.innerHeight;
+    var labels = view.sx >= MIN_LABEL_SPACING;
+    var onScreen = function(x, y) {
+      return x > -50 && x < width + 50 && y > -50 && y < height + 50;
+    };
+
+    // Edges in one path
+    ctx.beginPath();
+    ctx.strokeStyle = '#9dbaea';
+    ctx.lineWidth = 2;
+    visible.forEach(function(i) {
+      var p = parent[i];
+      if (p < 0) {
+        return;
+      }
+      var x = screenX(i), y = screenY(i), px = screenX(p), py = screenY(p);
+      if (onScreen(x, y) || onScreen(px, py)) {
+        ctx.moveTo(px, py);
+        ctx.lineTo(x, y);
+      }
+    });
+    ctx.stroke();
+
+    ctx.font = '12px helvetica';
+    ctx.textAlign = 'center';
+    ctx.textBaseline = 'middle';
+    visible.forEach(function(i) {
+      var x = screenX(i), y = screenY(i);
+      if (!onScreen(x, y)) {
+        return;
+      }
+      var leaf = tree.left[i] < 0;
+      if (!leaf && collapsed[i]) {
+        // A collapsed subtree is a triangle labelled with its leaf count
+        ctx.fillStyle = '#6c8ebf';
+        ctx.beginPath();
+        ctx.moveTo(x, y - NODE_RADIUS);
+        ctx.lineTo(x - NODE_RADIUS, y + NODE_RADIUS);
+        ctx.lineTo(x + NODE_RADIUS, y + NODE_RADIUS);
+        ctx.fill();
+        if (labels) {
+          ctx.fillStyle = '#333';
+          ctx.fillText('+' + tree.size[i], x, y + NODE_RADIUS + 9);
+        }
+        return;
+      }
+      ctx.fillStyle = i === selected ? '#e07000' : leaf ? '#11479e' : '#9dbaea';
+      ctx.beginPath();
+      ctx.arc(x, y, NODE_RADIUS, 0, 2 * Math.PI);
+      ctx.fill();
+      if (leaf && labels) {
+        ctx.fillStyle = '#333';
+        ctx.fillText(tokenLabel(i), x, y + NODE_RADIUS + 9);
+      }
+    });
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+
+  function bindInput() {
+    document.getElementById('file').addEventListener('change', function(e) {
+      if (e.target.files.length > 0) {
+        readFile(e.target.files[0]);
+      }
+    });
+    window.addEventListener('dragover', function(e) { e.preventDefault(); });
+    window.addEventListener('drop', function(e) {
+      e.preventDefault();
+      if (e.dataTransfer.files.length > 0) {
+        readFile(e.dataTransfer.files[0]);
+      }
+    });
+
+    var drag = null;
+    canvas.addEventListener('mousedown', function(e) {
+      drag = {x: e.clientX, y: e.clientY, moved: false};
+    });
+    window.addEventListener('mousemove', function(e) {
+      if (drag === null) {
+        return;
+      }
+      var dx = e.clientX - drag.x, dy = e.clientY - drag.y;
+      if (drag.moved || Math.abs(dx) + Math.abs(dy) > 3) {
+        drag.moved = true;
+        view.ox += dx;
+        view.oy += dy;
+        drag.x = e.clientX;
+        drag.y = e.clientY;
+        draw();
+      }
+    });
+    window.addEventListener('mouseup', function(e) {
+      if (drag !== null && !drag.moved) {
+        click(e.clientX, e.clientY);
+      }
+      drag = null;
+    });
+
+    canvas.addEventListener('wheel', function(e) {
+      e.preventDefault();
+      var factor = Math.exp(-e.deltaY * 0.002);
+      view.ox = e.clientX - (e.clientX - view.ox) * factor;
+      view.oy = e.clientY - (e.clientY - view.oy) * factor;
+      view.sx *= factor;
+      view.sy *= factor;
+      draw();
+    }, {passive: false});
+
+    window.addEventListener('keydown', function(e) {
+      if (tree === null) {
+        return;
+      }
+      if (e.key === 'f') {
+        fit();
+      } else if (e.key === 'e') {
+        collapsed.fill(0);
+        updateVisible();
+        fit();
+      } else if (e.key === 'c') {
+        collapseTo(initialDepth());
+        fit();
+      }
+      draw();
+    });
+  }
+
+  function readFile(file) {
+    var reader = new FileReader();
+    reader.onload = function() {
+      try {
+        load(JSON.parse(reader.result));
+      } catch (err) {
+        showSummary('not a treePrinter -j file: ' + err);
+      }
+    };
+    reader.readAsText(file);
+  }
+
+  // Toggles the internal node under the cursor and shows its details
+  function click(x, y) {
+    var i = nodeAt(x, y);
+    if (i < 0) {
+      return;
+    }
+    selected = i;
+    if (tree.left[i] >= 0) {
+      collapsed[i] = collapsed[i] ? 0 : 1;
+      // Open the children of a newly expanded node one level at a time
+      if (!collapsed[i]) {
+        [tree.left[i], tree.right[i]].forEach(function(c) {
+          if (tree.left[c] >= 0) {
+            collapsed[c] = 1;
+          }
+        });
+      }
+      updateVisible();
+    }
+    showInfo(i);
+    draw();
+  }
+
+  function nodeAt(x, y) {
+    var best = -1, bestDistance = (NODE_RADIUS + 3) * (NODE_RADIUS + 3);
+    visible.forEach(function(i) {
+      var dx = screenX(i) - x, dy = screenY(i) - y;
+      var d = dx * dx + dy * dy;
+      if (d <= bestDistance) {
+        best = i;
+        bestDistance = d;
+      }
+    });
+    return best;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+
+  function codeOf(i) {
+    var bits = [];
+    for (; parent[i] >= 0; i = parent[i]) {
+      bits.push(tree.left[parent[i]] === i ? '0' : '1');
+    }
+    return bits.reverse().join('');
+  }
+
+  function tokenLabel(i) {
+    if (i === tree.escape) {
+      return 'ESC';
+    }
+    return tree.token[i].replace(/\n/g, '\\n').replace(/\r/g, '\\r')
+                        .replace(/\t/g, '\\t').replace(/ /g, '\u2423');
+  }
+
+  function showInfo(i) {
+    var leaf = tree.left[i] < 0;
+    var rows = [
+      leaf ? 'token: ' + tokenLabel(i) : 'internal node, ' + tree.size[i] + ' leaves',
+      'code: ' + (codeOf(i) || '(root)'),
+      'depth: ' + tree.depth[i],
+      'probability: ' + tree.p[i].toPrecision(3),
+    ];
+    var info = document.getElementById('info');
+    info.textContent = '';
+    rows.forEach(function(row) {
+      var div = document.createElement('div');
+      div.textContent = row;
+      info.appendChild(div);
+    });
+  }
+
+  function showSummary(text) {
+    document.getElementById('summary').textContent = text;
+  }
+})();
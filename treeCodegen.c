@@ -0,0 +1,660 @@
+// Generates the C source of an encoder and decoder specialized to one tree
+//
+// The generated file holds the code of every leaf as a constant, found
+// through a byte table for single-byte tokens and a hash table laid out
+// here for longer ones, and decodes with a state machine that has one
+// label per internal node and the token of every leaf inlined. Nothing is
+// loaded or built when it runs, and the compiler sees the exact code set.
+//
+// The file compiles on its own into a program that reads and writes the
+// same files as encode and decode with the tree:
+//   treeCodegen task4/wonderland.tree wonderland.c
+//   cc -O2 -o wonderland wonderland.c
+//   ./wonderland -e <input file> <encoding file>
+//   ./wonderland -d <encoding file> <output file>
+// Compiled with -DTREE_CODEC_NO_MAIN it has only <name>Encode and
+// <name>Decode, for linking into another program or a shared object; -n
+// sets the name, so several trees can be linked together.
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "Tokenizer.h"
+#include "TreeIO.h"
+#include "huffman.h"
+
+struct leafCode {
+    char *token;
+    int tokenLen;
+    char *bits;
+    int numBits;
+};
+
+// The tree with its internal nodes numbered in pre-order. A child is the
+// number of an internal node, or -1 - i for the leaf with code i.
+struct codeSet {
+    int numCodes;
+    struct leafCode *codes;
+    int numInternal;
+    int (*child)[2];
+    int escape;             // code of the escape leaf, or -1
+    bool hasWords;
+    int maxTokenLen;
+    int capacity;           // of the hash table, a power of two
+    int *slots;
+    int byteCodes[256];
+};
+
+struct frame {
+    struct huffmanTree *node;
+    int parent;
+    int side;
+    int depth;
+};
+
+static struct codeSet *buildCodeSet(struct huffmanTree *tree);
+static int addCode(struct codeSet *cs, struct huffmanTree *leaf, char *path, int depth);
+static int countLeaves(struct huffmanTree *tree);
+static bool isWord(char *token);
+static uint32_t hashToken(const char *token, int tokenLen);
+static void freeCodeSet(struct codeSet *cs);
+static void writeSource(struct codeSet *cs, char *treeFilename, char *name, FILE *fp);
+static void writeTables(struct codeSet *cs, FILE *fp);
+static void writeEncode(struct codeSet *cs, char *name, FILE *fp);
+static void writeDecode(struct codeSet *cs, char *name, FILE *fp);
+static void writeChild(struct codeSet *cs, int child, FILE *fp);
+static void writeHelpers(struct codeSet *cs, FILE *fp);
+static void writeMain(char *name, FILE *fp);
+static void writeString(const char *bytes, int len, FILE *fp);
+
+int main(int argc, char *argv[]) {
+    AllocInit("treeCodegen");
+    char *name = "tree";
+    if (argc == 5 && strcmp(argv[1], "-n") == 0) {
+        name = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc != 3 || !isalpha((unsigned char)name[0])) {
+        fprintf(stderr, "usage: %s [-n <name>] <tree file> <output file>\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    struct huffmanTree *tree = TreeIORead(argv[1]);
+    struct codeSet *cs = buildCodeSet(tree);
+    FILE *fp = fopen(argv[2], "w");
+    if (fp == NULL) {
+        fprintf(stderr, "error: failed to open '%s' for writing\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+    writeSource(cs, argv[1], name, fp);
+    if (fclose(fp) != 0) {
+        fprintf(stderr, "error: failed to write '%s'\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+    freeCodeSet(cs);
+    TreeIOFree(tree);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Walks the tree without recursion, numbering internal nodes in pre-order
+// and giving every leaf the code of its path
+static struct codeSet *buildCodeSet(struct huffmanTree *tree) {
+    int numLeaves = countLeaves(tree);
+    struct codeSet *cs = AllocMalloc(ALLOC_CODE, sizeof(struct codeSet));
+    cs->numCodes = 0;
+    cs->codes = AllocMalloc(ALLOC_CODE, numLeaves * sizeof(struct leafCode));
+    cs->numInternal = 0;
+    cs->child = AllocMalloc(ALLOC_CODE, numLeaves * sizeof(int[2]));
+    cs->escape = -1;
+    cs->hasWords = false;
+    cs->maxTokenLen = 4;
+    cs->capacity = 16;
+    while (cs->capacity < 2 * numLeaves) {
+        cs->capacity *= 2;
+    }
+    cs->slots = AllocMalloc(ALLOC_CODE, cs->capacity * sizeof(int));
+    for (int i = 0; i < cs->capacity; i++) {
+        cs->slots[i] = -1;
+    }
+    for (int i = 0; i < 256; i++) {
+        cs->byteCodes[i] = -1;
+    }
+
+    struct frame *stack = AllocMalloc(ALLOC_CODE, 2 * numLeaves * sizeof(struct frame));
+    char *path = AllocMalloc(ALLOC_CODE, numLeaves + 1);
+    int top = 0;
+    stack[top++] = (struct frame){tree, -1, 0, 0};
+    while (top > 0) {
+        struct frame f = stack[--top];
+        if (f.depth > 0) {
+            path[f.depth - 1] = f.side ? '1' : '0';
+        }
+        int id;
+        if (f.node->left == NULL && f.node->right == NULL) {
+            // A lone leaf's code is a single 0, as in the codebook
+            if (f.depth == 0) {
+                path[f.depth++] = '0';
+            }
+            id = -1 - addCode(cs, f.node, path, f.depth);
+        } else {
+            id = cs->numInternal++;
+            stack[top++] = (struct frame){f.node->right, id, 1, f.depth + 1};
+            stack[top++] = (struct frame){f.node->left, id, 0, f.depth + 1};
+        }
+        if (f.parent >= 0) {
+            cs->child[f.parent][f.side] = id;
+        }
+    }
+    AllocFree(ALLOC_CODE, path);
+    AllocFree(ALLOC_CODE, stack);
+    return cs;
+}
+
+// Adds the leaf's code, or returns the code of an earlier leaf with the
+// same token, which keeps the leftmost code as the codebook does
+static int addCode(struct codeSet *cs, struct huffmanTree *leaf, char *path, int depth) {
+    int tokenLen = strlen(leaf->token);
+    uint32_t mask = cs->capacity - 1;
+    uint32_t slot = hashToken(leaf->token, tokenLen) & mask;
+    while (cs->slots[slot] >= 0) {
+        if (strcmp(cs->codes[cs->slots[slot]].token, leaf->token) == 0) {
+            return cs->slots[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    int i = cs->numCodes++;
+    struct leafCode *c = &cs->codes[i];
+    c->token = leaf->token;
+    c->tokenLen = tokenLen;
+    c->bits = AllocMalloc(ALLOC_CODE, depth + 1);
+    memcpy(c->bits, path, depth);
+    c->bits[depth] = '\0';
+    c->numBits = depth;
+    cs->slots[slot] = i;
+
+    // The escape leaf only ever stands for characters outside the tree
+    if (strcmp(leaf->token, ESCAPE_TOKEN) == 0) {
+        cs->escape = i;
+    } else if (tokenLen == 1) {
+        cs->byteCodes[(unsigned char)leaf->token[0]] = i;
+    }
+    if (isWord(leaf->token)) {
+        cs->hasWords = true;
+    }
+    if (tokenLen > cs->maxTokenLen) {
+        cs->maxTokenLen = tokenLen;
+    }
+    return i;
+}
+
+static int countLeaves(struct huffmanTree *tree) {
+    int numLeaves = 0;
+    int capacity = 64;
+    int top = 0;
+    struct huffmanTree **stack = AllocMalloc(ALLOC_CODE, capacity * sizeof(struct huffmanTree *));
+    stack[top++] = tree;
+    while (top > 0) {
+        struct huffmanTree *t = stack[--top];
+        if (t->left == NULL && t->right == NULL) {
+            numLeaves++;
+            continue;
+        }
+        if (top + 2 > capacity) {
+            capacity *= 2;
+            stack = AllocRealloc(ALLOC_CODE, stack, capacity * sizeof(struct huffmanTree *));
+        }
+        stack[top++] = t->right;
+        stack[top++] = t->left;
+    }
+    AllocFree(ALLOC_CODE, stack);
+    return numLeaves;
+}
+
+// Words are the tokens encode tries before spelling a word out
+static bool isWord(char *token) {
+    int len = TokenWordLen(token);
+    return token[len] == '\0' && TokenWordFits(len);
+}
+
+// FNV-1a, as in the generated lookup
+static uint32_t hashToken(const char *token, int tokenLen) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < tokenLen; i++) {
+        hash ^= (unsigned char)token[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void freeCodeSet(struct codeSet *cs) {
+    for (int i = 0; i < cs->numCodes; i++) {
+        AllocFree(ALLOC_CODE, cs->codes[i].bits);
+    }
+    AllocFree(ALLOC_CODE, cs->codes);
+    AllocFree(ALLOC_CODE, cs->child);
+    AllocFree(ALLOC_CODE, cs->slots);
+    AllocFree(ALLOC_CODE, cs);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+static void writeSource(struct codeSet *cs, char *treeFilename, char *name, FILE *fp) {
+    fprintf(fp, "// Generated by treeCodegen from %s; do not edit\n", treeFilename);
+    fprintf(
+        fp,
+        "//\n"
+        "// %sEncode writes the codes of the text as '0' and '1' characters, as\n"
+        "// encode does with the tree, and %sDecode turns them back into text.\n"
+        "// Both return NULL, after an error message, for input they cannot code.\n"
+        "// Define TREE_CODEC_NO_MAIN to leave out main.\n"
+        "\n"
+        "#include <ctype.h>\n"
+        "#include <stdbool.h>\n"
+        "#include <stdint.h>\n"
+        "#include <stdio.h>\n"
+        "#include <stdlib.h>\n"
+        "#include <string.h>\n"
+        "\n",
+        name, name
+    );
+    fprintf(fp, "#define NUM_CODES %d\n", cs->numCodes);
+    fprintf(fp, "#define HASH_CAPACITY %d\n", cs->capacity);
+    fprintf(fp, "#define MAX_TOKEN_LEN %d\n", cs->maxTokenLen);
+    fprintf(fp, "#define MAX_WORD_LEN %d\n", MAX_WORD_LEN);
+    fprintf(
+        fp,
+        "\n"
+        "struct code {\n"
+        "    const char *token;\n"
+        "    const char *bits;\n"
+        "    int tokenLen;\n"
+        "    int numBits;\n"
+        "};\n"
+        "\n"
+        "struct output {\n"
+        "    char *data;\n"
+        "    size_t len;\n"
+        "    size_t cap;\n"
+        "};\n"
+        "\n"
+        "char *%sEncode(const char *text, size_t len, size_t *encodingLen);\n"
+        "char *%sDecode(const char *encoding, size_t len, size_t *textLen);\n"
+        "\n"
+        "static int lookup(const char *token, int tokenLen);\n"
+        "static int charLen(unsigned char byte);\n",
+        name, name
+    );
+    if (cs->escape >= 0) {
+        fprintf(fp, "static bool decodeEscaped(const char **p, const char *end, struct output *out);\n");
+    }
+    fprintf(
+        fp,
+        "static void grow(struct output *out, size_t n);\n"
+        "static inline void append(struct output *out, const char *bytes, size_t n);\n"
+        "\n"
+    );
+
+    writeTables(cs, fp);
+    writeEncode(cs, name, fp);
+    writeDecode(cs, name, fp);
+    writeHelpers(cs, fp);
+    writeMain(name, fp);
+}
+
+static void writeTables(struct codeSet *cs, FILE *fp) {
+    fprintf(fp, "static const struct code codes[NUM_CODES] = {\n");
+    for (int i = 0; i < cs->numCodes; i++) {
+        struct leafCode *c = &cs->codes[i];
+        fprintf(fp, "    {");
+        writeString(c->token, c->tokenLen, fp);
+        fprintf(fp, ", \"%s\", %d, %d},\n", c->bits, c->tokenLen, c->numBits);
+    }
+    fprintf(fp, "};\n\n");
+
+    fprintf(fp, "// Code of every single-byte token, or -1\n");
+    fprintf(fp, "static const int byteCodes[256] = {");
+    for (int i = 0; i < 256; i++) {
+        fprintf(fp, "%s%d,", i % 16 == 0 ? "\n    " : " ", cs->byteCodes[i]);
+    }
+    fprintf(fp, "\n};\n\n");
+
+    fprintf(fp, "// Codes by FNV-1a hash of their tokens, with linear probing, or -1\n");
+    fprintf(fp, "static const int hashSlots[HASH_CAPACITY] = {");
+    for (int i = 0; i < cs->capacity; i++) {
+        fprintf(fp, "%s%d,", i % 16 == 0 ? "\n    " : " ", cs->slots[i]);
+    }
+    fprintf(fp, "\n};\n\n");
+}
+
+// Tokens are chosen as encode chooses them: the whole word when the tree
+// has it, otherwise the character, escaped if the tree has an escape leaf
+static void writeEncode(struct codeSet *cs, char *name, FILE *fp) {
+    fprintf(
+        fp,
+        "char *%sEncode(const char *text, size_t len, size_t *encodingLen) {\n"
+        "    struct output out = {NULL, 0, 0};\n"
+        "    grow(&out, len + 1);\n",
+        name
+    );
+    if (cs->hasWords) {
+        fprintf(fp, "    size_t wordEnd = 0;\n");
+    }
+    fprintf(
+        fp,
+        "    for (size_t i = 0; i < len; ) {\n"
+        "        int k = -1;\n"
+        "        int tokenLen = 0;\n"
+    );
+    if (cs->hasWords) {
+        fprintf(
+            fp,
+            "        if (i >= wordEnd) {\n"
+            "            size_t wordLen = 0;\n"
+            "            while (i + wordLen < len && isalpha((unsigned char)text[i + wordLen])) {\n"
+            "                wordLen++;\n"
+            "            }\n"
+            "            wordEnd = i + wordLen;\n"
+            "            if (wordLen > 1 && wordLen <= MAX_WORD_LEN) {\n"
+            "                tokenLen = wordLen;\n"
+            "                k = lookup(&text[i], tokenLen);\n"
+            "            }\n"
+            "        }\n"
+        );
+    }
+    fprintf(
+        fp,
+        "        if (k < 0) {\n"
+        "            tokenLen = charLen(text[i]);\n"
+        "            if (i + tokenLen > len) {\n"
+        "                tokenLen = len - i;\n"
+        "            }\n"
+        "            k = tokenLen == 1 ? byteCodes[(unsigned char)text[i]] : lookup(&text[i], tokenLen);\n"
+        "        }\n"
+        "        if (k >= 0) {\n"
+        "            append(&out, codes[k].bits, codes[k].numBits);\n"
+    );
+    if (cs->escape >= 0) {
+        fprintf(
+            fp,
+            "        } else {\n"
+            "            append(&out, codes[%d].bits, codes[%d].numBits);\n"
+            "            for (int b = 0; b < tokenLen; b++) {\n"
+            "                char byte[8];\n"
+            "                for (int j = 0; j < 8; j++) {\n"
+            "                    byte[j] = ((unsigned char)text[i + b] >> (7 - j) & 1) ? '1' : '0';\n"
+            "                }\n"
+            "                append(&out, byte, 8);\n"
+            "            }\n"
+            "        }\n",
+            cs->escape, cs->escape
+        );
+    } else {
+        fprintf(
+            fp,
+            "        } else {\n"
+            "            fprintf(stderr, \"error: token '%%.*s' is not in the huffman tree\\n\",\n"
+            "                    tokenLen, &text[i]);\n"
+            "            free(out.data);\n"
+            "            return NULL;\n"
+            "        }\n"
+        );
+    }
+    fprintf(
+        fp,
+        "        i += tokenLen;\n"
+        "    }\n"
+        "    out.data[out.len] = '\\0';\n"
+        "    *encodingLen = out.len;\n"
+        "    return out.data;\n"
+        "}\n"
+        "\n"
+    );
+}
+
+// Every internal node is a label that reads one character and jumps to a
+// child. Characters other than '0' and '1' are skipped, an encoding that
+// stops part way through a code ends the text, and a 1 on a tree with a
+// single leaf is an error, as in decode.
+static void writeDecode(struct codeSet *cs, char *name, FILE *fp) {
+    fprintf(
+        fp,
+        "char *%sDecode(const char *encoding, size_t len, size_t *textLen) {\n"
+        "    struct output out = {NULL, 0, 0};\n"
+        "    grow(&out, len + MAX_TOKEN_LEN + 1);\n"
+        "    const char *p = encoding;\n"
+        "    const char *end = encoding + len;\n",
+        name
+    );
+    fprintf(fp, "    char c;\n");
+    if (cs->numInternal == 0) {
+        // A lone leaf reads a 0 for every token, and no code starts with 1
+        fprintf(fp, "n0:\n");
+        fprintf(fp, "    if (p == end) goto done;\n");
+        fprintf(fp, "    c = *p++;\n");
+        fprintf(fp, "    if (c == '0') ");
+        writeChild(cs, -1, fp);
+        fprintf(
+            fp,
+            "    if (c == '1') {\n"
+            "        fprintf(stderr, \"error: the encoding has bits that start no code of the tree\\n\");\n"
+            "        free(out.data);\n"
+            "        return NULL;\n"
+            "    }\n"
+        );
+        fprintf(fp, "    goto n0;\n");
+    }
+    for (int n = 0; n < cs->numInternal; n++) {
+        fprintf(fp, "n%d:\n", n);
+        fprintf(fp, "    if (p == end) goto done;\n");
+        fprintf(fp, "    c = *p++;\n");
+        fprintf(fp, "    if (c == '0') ");
+        writeChild(cs, cs->child[n][0], fp);
+        fprintf(fp, "    if (c == '1') ");
+        writeChild(cs, cs->child[n][1], fp);
+        fprintf(fp, "    goto n%d;\n", n);
+    }
+    fprintf(
+        fp,
+        "done:\n"
+        "    out.data[out.len] = '\\0';\n"
+        "    *textLen = out.len;\n"
+        "    return out.data;\n"
+        "}\n"
+        "\n"
+    );
+}
+
+static void writeChild(struct codeSet *cs, int child, FILE *fp) {
+    if (child >= 0) {
+        fprintf(fp, "goto n%d;\n", child);
+        return;
+    }
+    int k = -1 - child;
+    if (k == cs->escape) {
+        fprintf(fp, "{ if (!decodeEscaped(&p, end, &out)) goto done; goto n0; }\n");
+        return;
+    }
+    fprintf(fp, "{ append(&out, ");
+    writeString(cs->codes[k].token, cs->codes[k].tokenLen, fp);
+    fprintf(fp, ", %d); goto n0; }\n", cs->codes[k].tokenLen);
+}
+
+static void writeHelpers(struct codeSet *cs, FILE *fp) {
+    fprintf(
+        fp,
+        "static int lookup(const char *token, int tokenLen) {\n"
+        "    uint32_t hash = 2166136261u;\n"
+        "    for (int i = 0; i < tokenLen; i++) {\n"
+        "        hash ^= (unsigned char)token[i];\n"
+        "        hash *= 16777619u;\n"
+        "    }\n"
+        "    for (uint32_t i = hash & (HASH_CAPACITY - 1); ; i = (i + 1) & (HASH_CAPACITY - 1)) {\n"
+        "        int k = hashSlots[i];\n"
+        "        if (k < 0 || (codes[k].tokenLen == tokenLen &&\n"
+        "                memcmp(codes[k].token, token, tokenLen) == 0)) {\n"
+        "            return k;\n"
+        "        }\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "static int charLen(unsigned char byte) {\n"
+        "    if ((byte & 0x80) == 0) {\n"
+        "        return 1;\n"
+        "    } else if ((byte & 0xE0) == 0xC0) {\n"
+        "        return 2;\n"
+        "    } else if ((byte & 0xF0) == 0xE0) {\n"
+        "        return 3;\n"
+        "    } else if ((byte & 0xF8) == 0xF0) {\n"
+        "        return 4;\n"
+        "    }\n"
+        "    return 1;\n"
+        "}\n"
+        "\n"
+    );
+    if (cs->escape >= 0) {
+        fprintf(
+            fp,
+            "// Reads the raw bytes of an escaped character, 8 bits per byte\n"
+            "static bool decodeEscaped(const char **p, const char *end, struct output *out) {\n"
+            "    char token[4];\n"
+            "    int len = 1;\n"
+            "    for (int b = 0; b < len; b++) {\n"
+            "        int byte = 0;\n"
+            "        for (int k = 0; k < 8; k++) {\n"
+            "            if (*p == end || (**p != '0' && **p != '1')) {\n"
+            "                return false;\n"
+            "            }\n"
+            "            byte = (byte << 1) | (*(*p)++ - '0');\n"
+            "        }\n"
+            "        token[b] = (char)byte;\n"
+            "        if (b == 0) {\n"
+            "            len = charLen(byte);\n"
+            "        }\n"
+            "    }\n"
+            "    append(out, token, len);\n"
+            "    return true;\n"
+            "}\n"
+            "\n"
+        );
+    }
+    fprintf(
+        fp,
+        "static void grow(struct output *out, size_t n) {\n"
+        "    out->cap = out->cap > n ? 2 * out->cap : 2 * n;\n"
+        "    out->data = realloc(out->data, out->cap);\n"
+        "    if (out->data == NULL) {\n"
+        "        fprintf(stderr, \"error: out of memory\\n\");\n"
+        "        exit(EXIT_FAILURE);\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "// Leaves room for the longest token and the terminating NUL\n"
+        "static inline void append(struct output *out, const char *bytes, size_t n) {\n"
+        "    if (out->cap - out->len <= n + MAX_TOKEN_LEN) {\n"
+        "        grow(out, n + MAX_TOKEN_LEN + 1);\n"
+        "    }\n"
+        "    memcpy(&out->data[out->len], bytes, n);\n"
+        "    out->len += n;\n"
+        "}\n"
+        "\n"
+    );
+}
+
+static void writeMain(char *name, FILE *fp) {
+    fprintf(
+        fp,
+        "#ifndef TREE_CODEC_NO_MAIN\n"
+        "\n"
+        "static char *readFile(char *filename, size_t *len) {\n"
+        "    FILE *fp = fopen(filename, \"rb\");\n"
+        "    if (fp == NULL) {\n"
+        "        fprintf(stderr, \"error: failed to open '%%s' for reading\\n\", filename);\n"
+        "        exit(EXIT_FAILURE);\n"
+        "    }\n"
+        "    size_t size = 4096;\n"
+        "    char *data = NULL;\n"
+        "    *len = 0;\n"
+        "    do {\n"
+        "        size *= 2;\n"
+        "        data = realloc(data, size);\n"
+        "        if (data == NULL) {\n"
+        "            fprintf(stderr, \"error: out of memory\\n\");\n"
+        "            exit(EXIT_FAILURE);\n"
+        "        }\n"
+        "        *len += fread(&data[*len], 1, size - *len, fp);\n"
+        "    } while (*len == size);\n"
+        "    fclose(fp);\n"
+        "    return data;\n"
+        "}\n"
+        "\n"
+        "int main(int argc, char *argv[]) {\n"
+        "    if (argc != 4 || (strcmp(argv[1], \"-e\") != 0 && strcmp(argv[1], \"-d\") != 0)) {\n"
+        "        fprintf(stderr, \"usage: %%s -e <input filename> <encoding filename>\\n\"\n"
+        "                \"       %%s -d <encoding filename> <output filename>\\n\", argv[0], argv[0]);\n"
+        "        exit(EXIT_FAILURE);\n"
+        "    }\n"
+        "    size_t len;\n"
+        "    char *in = readFile(argv[2], &len);\n"
+        "    size_t outLen;\n"
+        "    char *out;\n"
+        "    if (argv[1][1] == 'e') {\n"
+        "        out = %sEncode(in, len, &outLen);\n"
+        "        if (out == NULL) {\n"
+        "            exit(EXIT_FAILURE);\n"
+        "        }\n"
+        "    } else {\n"
+        "        // The encoding is the first word of the file, as decode reads it\n"
+        "        size_t start = 0;\n"
+        "        while (start < len && isspace((unsigned char)in[start])) {\n"
+        "            start++;\n"
+        "        }\n"
+        "        size_t stop = start;\n"
+        "        while (stop < len && !isspace((unsigned char)in[stop])) {\n"
+        "            stop++;\n"
+        "        }\n"
+        "        out = %sDecode(&in[start], stop - start, &outLen);\n"
+        "        if (out == NULL) {\n"
+        "            exit(EXIT_FAILURE);\n"
+        "        }\n"
+        "    }\n"
+        "\n"
+        "    FILE *fp = fopen(argv[3], \"wb\");\n"
+        "    if (fp == NULL) {\n"
+        "        fprintf(stderr, \"error: failed to open '%%s' for writing\\n\", argv[3]);\n"
+        "        exit(EXIT_FAILURE);\n"
+        "    }\n"
+        "    if (fwrite(out, 1, outLen, fp) != outLen || fclose(fp) != 0) {\n"
+        "        fprintf(stderr, \"error: failed to write '%%s'\\n\", argv[3]);\n"
+        "        exit(EXIT_FAILURE);\n"
+        "    }\n"
+        "    free(out);\n"
+        "    free(in);\n"
+        "}\n"
+        "\n"
+        "#endif\n",
+        name, name
+    );
+}
+
+// Writes bytes as a C string literal, with every byte that is not plainly
+// printable as a three-digit octal escape
+static void writeString(const char *bytes, int len, FILE *fp) {
+    fputc('"', fp);
+    for (int i = 0; i < len; i++) {
+        unsigned char ch = bytes[i];
+        if (ch >= 0x20 && ch < 0x7f && ch != '"' && ch != '\\' && ch != '?') {
+            fputc(ch, fp);
+        } else {
+            fprintf(fp, "\\%03o", ch);
+        }
+    }
+    fputc('"', fp);
+}
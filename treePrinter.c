@@ -1,17 +1,42 @@
 
+#include <math.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "Alloc.h"
 #include "File.h"
+#include "Tokenizer.h"
+#include "TreeIO.h"
 #include "huffman.h"
 
-static struct huffmanTree *readHuffmanTree(char *filename);
-static struct huffmanTree *readTree(FILE *fp, char str[]);
-static struct huffmanTree *newHuffmanNode(char *str, int freq);
-static void freeHuffmanTree(struct huffmanTree *t);
+// Layout of the tree for the JSON viewer, one entry per node in pre-order
+struct layout {
+    int numNodes;
+    int numLeaves;
+    int maxDepth;
+    struct huffmanTree **node;
+    int *left;              // -1 for leaves
+    int *right;             // -1 for leaves
+    int *depth;
+    int *size;              // leaves in the subtree
+    double *x;              // leaves are one apart, parents centred over their children
+    double *p;              // probability of the subtree implied by its code lengths
+};
+
+struct frame {
+    struct huffmanTree *node;
+    int parent;
+    bool isRight;
+};
 
 static void printTreeToHtml(struct huffmanTree *t, char *filename);
+static void printTreeToJson(struct huffmanTree *t, char *filename);
+static struct layout *layoutTree(struct huffmanTree *t);
+static void freeLayout(struct layout *l);
+static void printIntArray(char *name, int *values, int n, FILE *fp);
+static void printJsonToken(char *token, FILE *fp);
 static void printNodes(struct huffmanTree *t, FILE *fp);
 static void doPrintNodes(struct huffmanTree *t, FILE *fp, int *id);
 static void printEdges(struct huffmanTree *t, FILE *fp);
@@ -19,82 +44,25 @@ static void doPrintEdges(struct huffmanTree *t, FILE *fp, int *id);
 static void printEscapedToken(char *token, FILE *fp);
 
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "usage: %s <tree file> <output file>\n", argv[0]);
+    AllocInit("treePrinter");
+    // -j writes layout data for tree-vis/viewer.html instead of a page
+    bool json = argc == 4 && strcmp(argv[1], "-j") == 0;
+    if (argc != 3 && !json) {
+        fprintf(stderr, "usage: %s [-j] <tree file> <output file>\n", argv[0]);
         exit(EXIT_FAILURE);
     }
 
-    struct huffmanTree *tree = readHuffmanTree(argv[1]);
-    printTreeToHtml(tree, argv[2]);
-    freeHuffmanTree(tree);
+    struct huffmanTree *tree = TreeIORead(argv[argc - 2]);
+    if (json) {
+        printTreeToJson(tree, argv[argc - 1]);
+    } else {
+        printTreeToHtml(tree, argv[argc - 1]);
+    }
+    TreeIOFree(tree);
 }
 
 ////////////////////////////////////////////////////////////////////////
 
-static struct huffmanTree *readHuffmanTree(char *filename) {
-	FILE *fp = fopen(filename, "r");
-	if (fp == NULL) {
-		fprintf(stderr, "error: failed to open '%s' for reading\n", filename);
-		exit(EXIT_FAILURE);
-	}
-
-	char str[MAX_TOKEN_LEN + 1];
-	struct huffmanTree *tree = readTree(fp, str);
-	fclose(fp);
-	return tree;
-}
-
-static struct huffmanTree *readTree(FILE *fp, char str[]) {
-	struct huffmanTree *t = newHuffmanNode(NULL, 0);
-
-	int c = fgetc(fp);
-
-	if (c == '(') {
-		t->left = readTree(fp, str);
-		fgetc(fp); // should always be a ','
-		t->right = readTree(fp, str);
-		fgetc(fp); // should always be a ')'
-	} else {
-		int i = 0;
-		while (c != ',' && c != ')') {
-			if (c == '\\') {
-				c = fgetc(fp);
-			}
-			str[i++] = c;
-			c = fgetc(fp);
-		}
-
-		ungetc(c, fp);
-		str[i] = '\0';
-		t->token = strdup(str);
-	}
-
-	return t;
-}
-
-static struct huffmanTree *newHuffmanNode(char *str, int freq) {
-	struct huffmanTree *new = malloc(sizeof(struct huffmanTree));
-	if (new == NULL) {
-		fprintf(stderr, "error: out of memory\n");
-		exit(EXIT_FAILURE);
-	}
-
-	new->token = str;
-	new->freq = freq;
-	new->left = NULL;
-	new->right = NULL;
-	return new;
-}
-
-static void freeHuffmanTree(struct huffmanTree *t) {
-	if (t != NULL) {
-		freeHuffmanTree(t->left);
-		freeHuffmanTree(t->right);
-		free(t->token);
-		free(t);
-	}
-}
-
 ////////////////////////////////////////////////////////////////////////
 
 static void printTreeToHtml(struct huffmanTree *t, char *filename) {
@@ -222,3 +190,168 @@ static void printEscapedToken(char *token, FILE *fp) {
 }
 
 ////////////////////////////////////////////////////////////////////////
+
+// Writes the layout as one JSON object of parallel arrays indexed by node,
+// which is far smaller than an element list and needs no layout in the
+// browser
+static void printTreeToJson(struct huffmanTree *t, char *filename) {
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "error: failed to open '%s' for writing\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    static char buffer[1 << 16];
+    setvbuf(fp, buffer, _IOFBF, sizeof(buffer));
+
+    struct layout *l = layoutTree(t);
+    int escape = -1;
+    fprintf(fp, "{\"version\":1,\"nodes\":%d,\"leaves\":%d,\"maxDepth\":%d,\n",
+            l->numNodes, l->numLeaves, l->maxDepth);
+    printIntArray("left", l->left, l->numNodes, fp);
+    printIntArray("right", l->right, l->numNodes, fp);
+    printIntArray("depth", l->depth, l->numNodes, fp);
+    printIntArray("size", l->size, l->numNodes, fp);
+
+    fprintf(fp, "\"x\":[");
+    for (int i = 0; i < l->numNodes; i++) {
+        fprintf(fp, i == 0 ? "%g" : ",%g", l->x[i]);
+    }
+    fprintf(fp, "],\n\"p\":[");
+    for (int i = 0; i < l->numNodes; i++) {
+        fprintf(fp, i == 0 ? "%.4g" : ",%.4g", l->p[i]);
+    }
+
+    // Internal nodes have empty tokens
+    fprintf(fp, "],\n\"token\":[");
+    for (int i = 0; i < l->numNodes; i++) {
+        char *token = l->left[i] == -1 ? l->node[i]->token : "";
+        if (strcmp(token, ESCAPE_TOKEN) == 0) {
+            escape = i;
+            token = "";
+        }
+        if (i > 0) {
+            fputc(',', fp);
+        }
+        printJsonToken(token, fp);
+    }
+    fprintf(fp, "],\n\"escape\":%d}\n", escape);
+
+    freeLayout(l);
+    fclose(fp);
+}
+
+// Numbers the nodes in pre-order without recursion, so parents come before
+// their children, then fills in the annotations children first
+static struct layout *layoutTree(struct huffmanTree *t) {
+    struct layout *l = AllocMalloc(ALLOC_TREE, sizeof(struct layout));
+    int capacity = 64;
+    l->node = AllocMalloc(ALLOC_TREE, capacity * sizeof(struct huffmanTree *));
+    l->left = AllocMalloc(ALLOC_TREE, capacity * sizeof(int));
+    l->right = AllocMalloc(ALLOC_TREE, capacity * sizeof(int));
+    l->depth = AllocMalloc(ALLOC_TREE, capacity * sizeof(int));
+    l->numNodes = 0;
+    l->numLeaves = 0;
+    l->maxDepth = 0;
+
+    int stackCapacity = 64;
+    struct frame *stack = AllocMalloc(ALLOC_TREE, stackCapacity * sizeof(struct frame));
+    int top = 0;
+    stack[top++] = (struct frame){t, -1, false};
+    while (top > 0) {
+        struct frame f = stack[--top];
+        if (l->numNodes == capacity) {
+            capacity *= 2;
+            l->node = AllocRealloc(ALLOC_TREE, l->node, capacity * sizeof(struct huffmanTree *));
+            l->left = AllocRealloc(ALLOC_TREE, l->left, capacity * sizeof(int));
+            l->right = AllocRealloc(ALLOC_TREE, l->right, capacity * sizeof(int));
+            l->depth = AllocRealloc(ALLOC_TREE, l->depth, capacity * sizeof(int));
+        }
+
+        int i = l->numNodes++;
+        l->node[i] = f.node;
+        l->left[i] = l->right[i] = -1;
+        l->depth[i] = f.parent >= 0 ? l->depth[f.parent] + 1 : 0;
+        if (f.parent >= 0) {
+            if (f.isRight) {
+                l->right[f.parent] = i;
+            } else {
+                l->left[f.parent] = i;
+            }
+        }
+        if (l->depth[i] > l->maxDepth) {
+            l->maxDepth = l->depth[i];
+        }
+
+        if (f.node->left == NULL || f.node->right == NULL) {
+            l->numLeaves++;
+            continue;
+        }
+        if (top + 2 > stackCapacity) {
+            stackCapacity *= 2;
+            stack = AllocRealloc(ALLOC_TREE, stack, stackCapacity * sizeof(struct frame));
+        }
+        stack[top++] = (struct frame){f.node->right, i, true};
+        stack[top++] = (struct frame){f.node->left, i, false};
+    }
+    AllocFree(ALLOC_TREE, stack);
+
+    // Pre-order visits leaves left to right, which gives their columns
+    l->size = AllocMalloc(ALLOC_TREE, l->numNodes * sizeof(int));
+    l->x = AllocMalloc(ALLOC_TREE, l->numNodes * sizeof(double));
+    l->p = AllocMalloc(ALLOC_TREE, l->numNodes * sizeof(double));
+    int column = 0;
+    for (int i = 0; i < l->numNodes; i++) {
+        if (l->left[i] == -1) {
+            l->x[i] = column++;
+        }
+    }
+    for (int i = l->numNodes - 1; i >= 0; i--) {
+        if (l->left[i] == -1) {
+            l->size[i] = 1;
+            l->p[i] = ldexp(1.0, -l->depth[i]);
+        } else {
+            l->size[i] = l->size[l->left[i]] + l->size[l->right[i]];
+            l->x[i] = (l->x[l->left[i]] + l->x[l->right[i]]) / 2;
+            l->p[i] = l->p[l->left[i]] + l->p[l->right[i]];
+        }
+    }
+    return l;
+}
+
+static void freeLayout(struct layout *l) {
+    AllocFree(ALLOC_TREE, l->node);
+    AllocFree(ALLOC_TREE, l->left);
+    AllocFree(ALLOC_TREE, l->right);
+    AllocFree(ALLOC_TREE, l->depth);
+    AllocFree(ALLOC_TREE, l->size);
+    AllocFree(ALLOC_TREE, l->x);
+    AllocFree(ALLOC_TREE, l->p);
+    AllocFree(ALLOC_TREE, l);
+}
+
+static void printIntArray(char *name, int *values, int n, FILE *fp) {
+    fprintf(fp, "\"%s\":[", name);
+    for (int i = 0; i < n; i++) {
+        fprintf(fp, i == 0 ? "%d" : ",%d", values[i]);
+    }
+    fprintf(fp, "],\n");
+}
+
+// Writes the token as a JSON string; bytes from 0x80 up are copied, so
+// UTF-8 tokens stay readable
+static void printJsonToken(char *token, FILE *fp) {
+    fputc('"', fp);
+    for (int i = 0; token[i] != '\0'; i++) {
+        unsigned char c = token[i];
+        if (c == '"' || c == '\\') {
+            fprintf(fp, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+////////////////////////////////////////////////////////////////////////
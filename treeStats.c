@@ -0,0 +1,192 @@
+// Reports how well a huffman tree fits its alphabet and, given an input,
+// the input itself
+//
+// Without an input, prints the shape of the tree: leaves, maximum and mean
+// depth, and the code length of every leaf. With an input, the input is
+// split into tokens exactly as encode would split it, and the report adds
+// the Shannon entropy of those tokens, the average code length, the
+// redundancy of the code and the exact size of the encoding, all computed
+// from token counts and code lengths without encoding anything.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "Codebook.h"
+#include "Counter.h"
+#include "Tokenizer.h"
+#include "TreeIO.h"
+#include "huffman.h"
+
+struct leaf {
+    char *token;
+    int codeLen;
+    int64_t count;
+};
+
+static struct leaf *collectLeaves(struct huffmanTree *tree, Codebook cb, int *numLeaves);
+static void printTreeShape(struct leaf *leaves, int numLeaves);
+static void printInputStats(struct leaf *leaves, int numLeaves, Counter c, int64_t escapedBytes);
+static void printLeaves(struct leaf *leaves, int numLeaves, bool withCounts);
+static void printToken(char *token);
+
+int main(int argc, char *argv[]) {
+    AllocInit("treeStats");
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "usage: %s <tree file> [input file]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    struct huffmanTree *tree = TreeIORead(argv[1]);
+    Codebook cb = CodebookNew(tree);
+    int numLeaves;
+    struct leaf *leaves = collectLeaves(tree, cb, &numLeaves);
+
+    printf("tree: %s\n", argv[1]);
+    printTreeShape(leaves, numLeaves);
+    if (argc == 3) {
+        int64_t escapedBytes;
+        Counter c = countEncodedTokens(cb, argv[2], &escapedBytes);
+        if (c == NULL) {
+            exit(EXIT_FAILURE);
+        }
+        printf("input: %s\n", argv[2]);
+        printInputStats(leaves, numLeaves, c, escapedBytes);
+        CounterFree(c);
+    }
+    printf("\n");
+    printLeaves(leaves, numLeaves, argc == 3);
+
+    AllocFree(ALLOC_CODE, leaves);
+    CodebookFree(cb);
+    TreeIOFree(tree);
+}
+
+// Returns the leaves from left to right with the lengths of their codes,
+// visiting the tree without recursion
+static struct leaf *collectLeaves(struct huffmanTree *tree, Codebook cb, int *numLeaves) {
+    int capacity = 64;
+    struct huffmanTree **stack = AllocMalloc(ALLOC_CODE, capacity * sizeof(struct huffmanTree *));
+    int leafCapacity = 64;
+    struct leaf *leaves = AllocMalloc(ALLOC_CODE, leafCapacity * sizeof(struct leaf));
+    int top = 0;
+    *numLeaves = 0;
+    stack[top++] = tree;
+    while (top > 0) {
+        struct huffmanTree *t = stack[--top];
+        if (t->left == NULL && t->right == NULL) {
+            if (*numLeaves == leafCapacity) {
+                leafCapacity *= 2;
+                leaves = AllocRealloc(ALLOC_CODE, leaves, leafCapacity * sizeof(struct leaf));
+            }
+            struct leaf *l = &leaves[(*numLeaves)++];
+            l->token = t->token;
+            l->codeLen = strlen(CodebookGet(cb, t->token, strlen(t->token)));
+            l->count = 0;
+            continue;
+        }
+        if (top + 2 > capacity) {
+            capacity *= 2;
+            stack = AllocRealloc(ALLOC_CODE, stack, capacity * sizeof(struct huffmanTree *));
+        }
+        stack[top++] = t->right;
+        stack[top++] = t->left;
+    }
+    AllocFree(ALLOC_CODE, stack);
+    return leaves;
+}
+
+static void printTreeShape(struct leaf *leaves, int numLeaves) {
+    int maxDepth = 0;
+    double totalDepth = 0;
+    for (int i = 0; i < numLeaves; i++) {
+        if (leaves[i].codeLen > maxDepth) {
+            maxDepth = leaves[i].codeLen;
+        }
+        totalDepth += leaves[i].codeLen;
+    }
+    printf("leaves: %d\n", numLeaves);
+    printf("max depth: %d\n", maxDepth);
+    printf("mean depth: %.4f\n", totalDepth / numLeaves);
+}
+
+// Entropy and average code length are per token; escaped characters count
+// as escape tokens, and their raw bytes add 8 bits each to the encoding
+static void printInputStats(struct leaf *leaves, int numLeaves, Counter c, int64_t escapedBytes) {
+    int64_t numTokens = 0;
+    int64_t codeBits = 0;
+    int used = 0;
+    for (int i = 0; i < numLeaves; i++) {
+        leaves[i].count = CounterGet(c, leaves[i].token);
+        numTokens += leaves[i].count;
+        codeBits += leaves[i].count * leaves[i].codeLen;
+        used += leaves[i].count > 0;
+    }
+
+    double entropy = 0;
+    for (int i = 0; i < numLeaves; i++) {
+        if (leaves[i].count > 0) {
+            double p = (double)leaves[i].count / numTokens;
+            entropy -= p * log2(p);
+        }
+    }
+    double average = numTokens > 0 ? (double)codeBits / numTokens : 0;
+    int64_t totalBits = codeBits + 8 * escapedBytes;
+
+    printf("tokens: %" PRId64 "\n", numTokens);
+    printf("leaves used: %d\n", used);
+    printf("escaped characters: %" PRId64 " (%" PRId64 " bytes)\n", CounterGet(c, ESCAPE_TOKEN),
+           escapedBytes);
+    printf("entropy: %.4f bits/token\n", entropy);
+    printf("average code length: %.4f bits/token\n", average);
+    printf("redundancy: %.4f bits/token (%.2f%%)\n", average - entropy,
+           entropy > 0 ? (average - entropy) / entropy * 100 : 0);
+    // encode writes one '0' or '1' byte per bit
+    printf("predicted encoding: %" PRId64 " bits\n", totalBits);
+    printf("  as text: %" PRId64 " bytes\n", totalBits);
+    printf("  packed: %" PRId64 " bytes\n", (totalBits + 7) / 8);
+}
+
+// One line per leaf: code length, count (with an input) and token
+static void printLeaves(struct leaf *leaves, int numLeaves, bool withCounts) {
+    printf(withCounts ? "length count token\n" : "length token\n");
+    for (int i = 0; i < numLeaves; i++) {
+        printf("%d ", leaves[i].codeLen);
+        if (withCounts) {
+            printf("%" PRId64 " ", leaves[i].count);
+        }
+        printToken(leaves[i].token);
+        printf("\n");
+    }
+}
+
+// Prints the token quoted, with control characters and the escape leaf
+// spelled out
+static void printToken(char *token) {
+    if (strcmp(token, ESCAPE_TOKEN) == 0) {
+        printf("<escape>");
+        return;
+    }
+    printf("\"");
+    for (int i = 0; token[i] != '\0'; i++) {
+        unsigned char ch = token[i];
+        switch (ch) {
+            case '\n': printf("\\n");     break;
+            case '\r': printf("\\r");     break;
+            case '\t': printf("\\t");     break;
+            case '"':  printf("\\\"");    break;
+            case '\\': printf("\\\\");    break;
+            default:
+                if (ch < 0x20) {
+                    printf("\\x%02x", ch);
+                } else {
+                    putchar(ch);
+                }
+        }
+    }
+    printf("\"");
+}